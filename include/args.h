@@ -21,6 +21,8 @@ obj join_args_shell(struct workspace *wk, obj arr);
 obj join_args_ninja(struct workspace *wk, obj arr);
 obj join_args_shell_ninja(struct workspace *wk, obj arr);
 obj join_args_pkgconf(struct workspace *wk, obj arr);
+void push_args_ninja(struct workspace *wk, struct tstr *sb, obj arr);
+void push_args_shell_ninja(struct workspace *wk, struct tstr *sb, obj arr);
 
 enum arr_to_args_flags {
 	arr_to_args_build_target = 1 << 0,
@@ -9,7 +9,7 @@
 #include "lang/workspace.h"
 
 struct write_tgt_ctx {
-	FILE *out;
+	struct tstr *out;
 	const struct project *proj;
 	bool wrote_default;
 };
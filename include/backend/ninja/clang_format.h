@@ -9,6 +9,6 @@
 #include "lang/workspace.h"
 
 bool ninja_clang_format_is_enabled_and_available(struct workspace *wk);
-void ninja_clang_format_write_targets(struct workspace *wk, FILE *out);
+void ninja_clang_format_write_targets(struct workspace *wk, struct tstr *out);
 
 #endif
@@ -8,5 +8,5 @@
 #include "lang/workspace.h"
 
 bool
-ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bool need_phony, obj compiler_rule_arr);
+ninja_write_rules(struct tstr *out, struct workspace *wk, struct project *main_proj, bool need_phony, obj compiler_rule_arr);
 #endif
@@ -50,8 +50,14 @@ struct output_path {
 extern const struct output_path output_path;
 
 typedef bool((*with_open_callback)(struct workspace *wk, void *ctx, FILE *out));
+typedef bool((*with_open_buffered_callback)(struct workspace *wk, void *ctx, struct tstr *out));
 
 FILE *output_open(struct workspace *wk, const char *dir, const char *name);
 bool with_open(const char *dir, const char *name, struct workspace *wk, void *ctx, with_open_callback cb);
+bool with_open_buffered(const char *dir,
+	const char *name,
+	struct workspace *wk,
+	void *ctx,
+	with_open_buffered_callback cb);
 bool output_clear_caches(struct workspace *wk);
 #endif
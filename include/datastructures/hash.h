@@ -34,6 +34,7 @@ void hash_init_(struct arena *a, struct hash *h, uint32_t cap, uint32_t key_size
 #define hash_init(__a, __h, __cap, __key_type) \
 	hash_init_(__a, __h, __cap, sizeof(__key_type), ar_alignof(__key_type))
 void hash_init_str(struct arena *a, struct hash *h, uint32_t cap);
+void hash_clear(struct hash *h);
 
 uint64_t *hash_get(const struct hash *h, const void *key);
 uint64_t *hash_get_strn(const struct hash *h, const char *str, uint64_t len);
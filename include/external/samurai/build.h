@@ -11,6 +11,10 @@ struct samu_node;
 
 /* reset state, so a new build can be executed */
 void samu_buildreset(struct samu_ctx *ctx);
+/* queue the files needed to check whether a target is dirty to be stat */
+void samu_buildstat(struct samu_ctx *ctx, struct samu_node *n);
+/* stat all queued files, concurrently where possible */
+void samu_buildstatall(struct samu_ctx *ctx);
 /* schedule a particular target to be built */
 void samu_buildadd(struct samu_ctx *ctx, struct samu_node *n);
 /* execute rules to build the scheduled targets */
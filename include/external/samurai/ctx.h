@@ -71,6 +71,10 @@ struct samu_node {
 	/* modification time of file (in nanoseconds) and build log entry (in seconds) */
 	int64_t mtime, logmtime;
 
+	/* start and end of the command that built this output, in milliseconds
+	 * since the start of its build, read from build log */
+	int64_t logstart, logend;
+
 	/* generating edge and dependent edges */
 	struct samu_edge *gen, **use;
 	size_t nuse;
@@ -108,6 +112,10 @@ struct samu_edge {
 	/* how many inputs need to be pruned before all outputs can be pruned */
 	size_t nprune;
 
+	/* estimated duration of this edge plus the longest chain of dependent
+	 * edges in this build, in milliseconds */
+	int64_t weight;
+
 	enum {
 		FLAG_WORK      = 1 << 0,  /* scheduled for build */
 		FLAG_HASH      = 1 << 1,  /* calculated the command hash */
@@ -116,10 +124,10 @@ struct samu_edge {
 		FLAG_DIRTY     = FLAG_DIRTY_IN | FLAG_DIRTY_OUT,
 		FLAG_CYCLE     = 1 << 5,  /* used for cycle detection */
 		FLAG_DEPS      = 1 << 6,  /* dependencies loaded */
+		FLAG_WEIGHT    = 1 << 7,  /* calculated the critical path weight */
+		FLAG_STAT      = 1 << 8,  /* queued nodes for the stat pre-pass */
 	} flags;
 
-	/* used to coordinate ready work in build() */
-	struct samu_edge *worknext;
 	/* used for alledges linked list */
 	struct samu_edge *allnext;
 };
@@ -130,11 +138,24 @@ struct samu_nodearray {
 };
 
 struct samu_entry {
+	/* NULL until needed if the node is not in the graph */
 	struct samu_node *node;
+	/* path of the node in the mapped deps log */
+	const char *path;
+	size_t pathlen;
+	/* latest dependency record for the node in the mapped deps log, cleared
+	 * once it has been resolved into deps */
+	const uint32_t *record;
 	struct samu_nodearray deps;
 	int64_t mtime;
 };
 
+/* a max-heap of ready edges ordered by weight */
+struct samu_edgequeue {
+	struct samu_edge **edges;
+	size_t len, cap;
+};
+
 struct samu_rule {
 	char *name;
 	struct samu_treenode *bindings;
@@ -145,11 +166,29 @@ struct samu_pool {
 	int numjobs, maxjobs;
 
 	/* a queue of ready edges blocked by the pool's capacity */
-	struct samu_edge *work;
+	struct samu_edgequeue work;
+};
+
+/* nodes waiting to be stat'd together before dirty checking */
+struct samu_statqueue {
+	struct fs_mtime_batch_entry *entries;
+	struct samu_node **nodes;
+	size_t len, cap;
+	struct fs_mtime_pool *pool;
+
+	/* visited edges which may have dependencies in .ninja_deps */
+	struct samu_edge **edges;
+	size_t nedges, edgescap;
 };
 
 struct samu_build_ctx {
-	struct samu_edge *work;
+	struct samu_edgequeue work;
+	struct samu_statqueue stat;
+	/* scratch space for splitting commands, reused by every job and freed
+	 * at the end of the build */
+	struct samu_buffer cmdbuf;
+	char **argv;
+	size_t argvcap;
 	size_t nstarted, nfinished, ntotal;
 	bool consoleused;
 	struct timer timer;
@@ -157,6 +196,7 @@ struct samu_build_ctx {
 
 struct samu_deps_ctx {
 	FILE *depsfile;
+	struct fs_mapped_file map;
 	struct samu_entry *entries;
 	size_t entrieslen, entriescap;
 
@@ -17,6 +17,8 @@ enum {
 	SAMU_MTIME_UNKNOWN = 1,
 	/* the file does not exist */
 	SAMU_MTIME_MISSING = 2,
+	/* the file is queued to be stat */
+	SAMU_MTIME_QUEUED = 3,
 };
 
 void samu_graphinit(struct samu_ctx *ctx);
@@ -20,6 +20,7 @@ typedef enum iteration_result (
 	*subprojects_foreach_cb)(struct workspace *wk, struct subprojects_common_ctx *ctx, const char *name);
 
 bool subprojects_foreach(struct workspace *wk, obj list, struct subprojects_common_ctx *usr_ctx, subprojects_foreach_cb cb);
+bool subprojects_prefetch(struct workspace *wk, const char *subprojects_dir, uint32_t job_count);
 
 FUNC_REGISTER(module_subprojects);
 #endif
@@ -42,6 +42,7 @@ enum vm_compile_mode {
 };
 
 void vm_compile_state_reset(struct workspace *wk);
+void vm_compile_state_release(struct workspace *wk);
 struct node;
 struct vm_compile_opts {
 	const struct args_norm *an;
@@ -12,6 +12,7 @@
 #include <stdio.h>
 
 #include "datastructures/bucket_arr.h"
+#include "datastructures/hash.h"
 #include "iterator.h"
 #include "lang/types.h"
 #include "machines.h"
@@ -182,20 +183,52 @@ struct obj_module {
 	obj exports;
 };
 
-struct obj_array_elem {
-	uint32_t next;
-	obj val;
+/*
+ * Array elements are stored contiguously in chunks of
+ * vm.objects.array_chunks.  Small arrays share chunks while arrays that
+ * outgrow obj_array_chunk_size get a chunk of their own.  Chunk memory never
+ * moves, so pointers to elements remain valid until obj_clear(), which keeps
+ * the chunks it drops in vm.objects.array_chunks_free for reuse.
+ */
+struct obj_array_chunk {
+	obj *mem;
+	uint32_t len, cap;
+};
+
+enum {
+	obj_array_chunk_size = 4096,
 };
 
 enum obj_array_flags {
 	obj_array_flag_cow = 1 << 3,
+	// An entry in vm.objects.array_indexes is kept up to date for this array.
+	obj_array_flag_indexed = 1 << 4,
+	// The array has been searched since it was last modified in a way the
+	// index can't follow.
+	obj_array_flag_queried = 1 << 5,
 };
 
 struct obj_array {
-	uint32_t head, tail, len;
+	uint32_t chunk, start, len, cap;
 	enum obj_array_flags flags;
 };
 
+/*
+ * Arrays of at least obj_array_index_min_len elements that are searched
+ * more than once get an index mapping each element to the position of its
+ * first occurrence.  Only numbers and immutable strings are indexed, lookups
+ * of anything else fall back to a linear search.
+ */
+enum {
+	obj_array_index_min_len = 32,
+};
+
+struct obj_array_index {
+	struct hash strs, nums;
+	// Whether any element is a mutable string or an array.
+	bool mutable_strs, arrays;
+};
+
 enum obj_dict_flags {
 	obj_dict_flag_big = 1 << 0,
 	obj_dict_flag_int_key = 1 << 1,
@@ -575,7 +608,10 @@ struct range_params {
 struct obj_iterator {
 	enum obj_iterator_type type;
 	union {
-		struct obj_array_elem *array;
+		struct {
+			const obj *e;
+			uint32_t i, len;
+		} array;
 		struct obj_dict_elem *dict_small;
 		struct {
 			struct hash *h;
@@ -592,7 +628,10 @@ struct obj_iterator {
 /* end of object structs */
 
 struct obj_clear_mark {
-	struct bucket_arr_save objs, chrs, dict_elems, dict_hashes, array_elems;
+	struct bucket_arr_save objs, chrs, dict_elems, dict_hashes;
+	struct {
+		uint32_t chunks, tail_len;
+	} array_chunks;
 	struct bucket_arr_save obj_aos[obj_type_count - _obj_aos_start];
 };
 
@@ -604,12 +643,42 @@ void make_default_objects(struct workspace *wk);
 void obj_set_clear_mark(struct workspace *wk, struct obj_clear_mark *mk);
 void obj_clear(struct workspace *wk, const struct obj_clear_mark *mk);
 
+/*
+ * Objects made after the young mark is set are young.  While the vm is
+ * looping, young objects that are only reachable from the vm stack and the
+ * global scope are reclaimed by obj_young_collect, which copies the
+ * survivors and clears everything else.  Writing to an object made before
+ * the mark may create a reference that those roots don't cover, so such
+ * writes call obj_young_barrier, which sets dirty and prevents the next
+ * collection.
+ */
+struct obj_young {
+	struct obj_clear_mark mark;
+	obj global_scope;
+	obj iter; // outermost loop iterator seen since the mark
+	uint32_t objs, next_collect;
+	bool set, dirty;
+};
+
+void obj_young_set_mark(struct workspace *wk);
+void obj_young_barrier(struct workspace *wk, obj o);
+bool obj_young_collect(struct workspace *wk, struct arr *roots, uint32_t *survivors);
+
 bool get_obj_bool(struct workspace *wk, obj o);
 obj make_obj_bool(struct workspace *wk, bool v);
 obj get_obj_bool_with_default(struct workspace *wk, obj o, bool def);
+/*
+ * Numbers in the range of a signed 31-bit integer are not allocated.  They
+ * are stored directly in the obj with OBJ_NUMBER_IMMEDIATE_TAG set, so they
+ * are immutable and equal numbers have equal ids.
+ */
+#define OBJ_NUMBER_IMMEDIATE_TAG 0x80000000u
+#define OBJ_NUMBER_IMMEDIATE_MAX 0x3fffffff
+#define OBJ_NUMBER_IMMEDIATE_MIN (-OBJ_NUMBER_IMMEDIATE_MAX - 1)
+
 obj make_number(struct workspace *wk, int64_t n);
+obj make_number_boxed(struct workspace *wk, int64_t n);
 int64_t get_obj_number(struct workspace *wk, obj o);
-void set_obj_number(struct workspace *wk, obj o, int64_t v);
 obj *get_obj_file(struct workspace *wk, obj o);
 const char *get_file_path(struct workspace *wk, obj o);
 const struct str *get_str(struct workspace *wk, obj s);
@@ -677,11 +746,13 @@ uint32_t obj_snprintf(struct workspace *wk, char *buf, uint32_t len, const char
 void obj_inspect(struct workspace *wk, obj val);
 
 typedef enum iteration_result (*obj_array_iterator)(struct workspace *wk, void *ctx, obj val);
+obj *obj_array_elems(struct workspace *wk, const struct obj_array *a);
 void obj_array_push(struct workspace *wk, obj arr, obj child);
 void obj_array_prepend(struct workspace *wk, obj *arr, obj val);
 bool obj_array_foreach(struct workspace *wk, obj arr, void *ctx, obj_array_iterator cb);
 bool obj_array_foreach_flat(struct workspace *wk, obj arr, void *usr_ctx, obj_array_iterator cb);
 bool obj_array_in(struct workspace *wk, obj arr, obj val);
+bool obj_array_in_flat(struct workspace *wk, obj arr, obj val);
 bool obj_array_index_of(struct workspace *wk, obj arr, obj val, uint32_t *idx);
 obj *obj_array_index_pointer(struct workspace *wk, obj arr, int64_t i);
 obj obj_array_index(struct workspace *wk, obj arr, int64_t i);
@@ -711,6 +782,7 @@ bool obj_dict_in(struct workspace *wk, obj dict, obj key);
 bool obj_dict_index(struct workspace *wk, obj dict, obj key, obj *res);
 bool obj_dict_index_strn(struct workspace *wk, obj dict, const char *str, uint32_t len, obj *res);
 obj *obj_dict_index_strn_pointer(struct workspace *wk, obj dict, const char *str, uint32_t len);
+void obj_dict_val_pointers(struct workspace *wk, obj dict, struct arena *a, struct arr *res);
 bool obj_dict_index_str(struct workspace *wk, obj dict, const char *str, obj *res);
 void obj_dict_set(struct workspace *wk, obj dict, obj key, obj val);
 void obj_dict_dup(struct workspace *wk, obj dict, obj *res);
@@ -18,7 +18,7 @@
 
 struct obj_array_for_helper {
 	const struct obj_array *a;
-	struct obj_array_elem *e;
+	const obj *e;
 	uint32_t i, len;
 };
 
@@ -27,11 +27,9 @@ struct obj_array_for_helper {
 		.a = __arr,                                          \
 	};                                                                                \
 	__iter.len = __iter.a->len;                                                       \
-	for (__iter.e = __iter.a->len ? (struct obj_array_elem *)bucket_arr_get(&(__wk)->vm.objects.array_elems, __iter.a->head) : 0,\
-			__val = __iter.e ? __iter.e->val : 0; __iter.i < __iter.len;            \
-		__iter.e = __iter.e->next ? (struct obj_array_elem *)bucket_arr_get(&(__wk)->vm.objects.array_elems, __iter.e->next) : 0, \
-	    __val = __iter.e ? __iter.e->val : 0,                                         \
-	    ++__iter.i)
+	__iter.e = obj_array_elems(__wk, __iter.a);                                       \
+	for (__val = __iter.len ? __iter.e[0] : 0; __iter.i < __iter.len;                 \
+		++__iter.i, __val = __iter.i < __iter.len ? __iter.e[__iter.i] : 0)
 
 #define obj_array_for_array(__wk, __arr, __val) \
 	obj_array_for_array_((__wk), __arr, __val, CONCAT(__iter, __LINE__))
@@ -92,8 +90,13 @@ struct obj_dict_for_helper {
  * obj_array_flat_for
  ******************************************************************************/
 
+struct obj_array_flat_iter_pos {
+	const obj *e;
+	uint32_t i, len;
+};
+
 struct obj_array_flat_iter_ctx {
-	struct obj_array_elem *e;
+	struct obj_array_flat_iter_pos pos;
 	uint32_t pushed;
 	bool init;
 };
@@ -86,16 +86,27 @@ enum node_assign_flag {
 	node_assign_flag_force_declaration = 1 << 2,
 };
 
+/* Nodes live in vm.compiler_state.nodes and refer to each other by index.
+ * Index 0 is reserved so that a 0 child means no child. */
 struct node {
 	union literal_data data;
-	struct node *l, *r;
 	struct source_location location;
-	struct {
-		struct node_fmt_ws pre, post;
-	} fmt;
+	uint32_t l, r, id;
 	enum node_type type;
 };
 
+/* Whitespace and comments surrounding a node.  These are only recorded when
+ * parsing with vm_compile_mode_fmt, in a table parallel to the nodes. */
+struct node_fmt {
+	struct node_fmt_ws pre, post;
+};
+
+struct node *node_get(struct workspace *wk, uint32_t id);
+struct node *node_l(struct workspace *wk, const struct node *n);
+struct node *node_r(struct workspace *wk, const struct node *n);
+uint32_t node_id(const struct node *n);
+struct node_fmt *node_fmt(struct workspace *wk, const struct node *n);
+
 void print_ast(struct workspace *wk, struct node *root);
 void print_fmt_ast(struct workspace *wk, struct node *root);
 struct node *parse(struct workspace *wk, const struct source *src, enum vm_compile_mode mode);
@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_LANG_PROFILE_H
+#define MUON_LANG_PROFILE_H
+
+#include "arena.h"
+#include "datastructures/arr.h"
+#include "datastructures/hash.h"
+#include "lang/object.h"
+#include "platform/timer.h"
+
+struct workspace;
+
+enum vm_profile_frame_type {
+	vm_profile_frame_type_root,
+	vm_profile_frame_type_eval,
+	vm_profile_frame_type_func,
+	vm_profile_frame_type_native,
+};
+
+/* A node in the call tree.  Nodes are keyed on their parent, frame type, id
+ * (native function index, function entry, or eval name) and the ip of the
+ * call site, so the same function called from two places gets two nodes. */
+struct vm_profile_node {
+	uint64_t self_ns, calls, objects;
+	int64_t bytes;
+	uint32_t parent, id, call_ip;
+	enum vm_profile_frame_type type;
+	const char *name, *prefix;
+};
+
+struct vm_profile {
+	struct arena a;
+	struct arr nodes;
+	struct hash children;
+	struct timer timer;
+	uint64_t last_ns;
+	int64_t last_bytes;
+	uint64_t objects_by_type[obj_type_count];
+	uint32_t cur;
+	const char *path;
+};
+
+void vm_profile_init(struct workspace *wk, const char *path);
+void vm_profile_push_eval(struct workspace *wk, obj eval_name);
+void vm_profile_push_func(struct workspace *wk, const struct obj_func *func);
+void vm_profile_push_native(struct workspace *wk, uint32_t func_idx, obj self);
+void vm_profile_pop(struct workspace *wk);
+void vm_profile_obj(struct workspace *wk, enum obj_type t);
+bool vm_profile_write(struct workspace *wk);
+#endif
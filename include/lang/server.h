@@ -32,4 +32,5 @@ bool srv_init_pipe(struct workspace *wk, struct server *srv, const char *pipe_pa
 void srv_destroy(struct server *srv);
 void srv_write(struct server *srv, struct workspace *wk, obj msg);
 enum srv_read_result srv_read(struct server *srv, struct workspace *wk, obj *msg);
+bool srv_input_pending(struct server *srv);
 #endif
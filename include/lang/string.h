@@ -41,6 +41,10 @@ struct workspace;
 
 enum tstr_flags {
 	tstr_flag_write = 1 << 1,
+	// Allocate buf on the heap rather than in the scratch arena.  This is
+	// for large buffers that must survive workspace_scratch_end, and must be
+	// released with tstr_free.
+	tstr_flag_heap = 1 << 2,
 };
 
 #define TSTR_CUSTOM(name, static_len, flags)     \
@@ -59,6 +63,7 @@ struct tstr {
 
 void tstr_init(struct tstr *sb, enum tstr_flags flags);
 void tstr_clear(struct tstr *sb);
+void tstr_free(struct tstr *sb);
 void tstr_grow(struct workspace *wk, struct tstr *sb, uint32_t inc);
 void tstr_push(struct workspace *wk, struct tstr *sb, char s);
 void tstr_pushn(struct workspace *wk, struct tstr *sb, const char *s, uint32_t n);
@@ -124,6 +129,17 @@ bool str_contains(const struct str *str, const struct str *substr);
 bool str_containsi(const struct str *str, const struct str *substr);
 obj str_join(struct workspace *wk, obj s1, obj s2);
 
+struct str_builders {
+	struct {
+		obj s;
+		uint32_t cap;
+	} e[4];
+	uint32_t len, next;
+};
+
+obj str_builder_append(struct workspace *wk, obj s, obj val);
+void str_builder_release(struct workspace *wk, obj s);
+
 bool str_to_i(const struct str *ss, int64_t *res, bool strip);
 bool str_to_i_base(const struct str *ss, int64_t *res, bool strip, uint32_t base);
 
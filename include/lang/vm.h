@@ -13,6 +13,7 @@
 #include "lang/eval.h"
 #include "lang/object.h"
 #include "lang/source.h"
+#include "lang/string.h"
 #include "lang/types.h"
 
 enum op {
@@ -82,6 +83,7 @@ extern const uint32_t op_operand_size;
 const char *vm_op_to_s(uint8_t op);
 
 struct workspace;
+struct vm_profile;
 
 enum compile_time_constant_objects {
 	/* obj_null = 0, */
@@ -118,10 +120,14 @@ struct call_frame {
 };
 
 struct vm_compiler_state {
+	// Allocated from a_scratch, see vm_compile_state_reset
 	struct bucket_arr nodes;
+	struct arr node_fmt;
 	struct arr node_stack;
 	struct arr locals, upvalues, call_stack;
 	struct arr loop_jmp_stack, if_jmp_stack;
+	// Maps global variable names to their index + 1 in vm.global_slots
+	struct hash global_slot_names;
 	uint32_t loop_depth;
 	enum vm_compile_mode mode;
 	enum build_language lang;
@@ -180,11 +186,21 @@ struct vm_reflection_registry {
 struct vm_objects {
 	struct bucket_arr chrs;
 	struct bucket_arr objs;
-	struct bucket_arr dict_elems, dict_hashes, array_elems;
+	struct bucket_arr dict_elems, dict_hashes;
+	// hashes of big dicts dropped by obj_clear_mark_restore(), reused before
+	// allocating
+	struct arr dict_hashes_free; // struct hash
+	struct arr array_chunks; // struct obj_array_chunk
+	// chunks dropped by obj_clear_mark_restore(), reused before allocating
+	struct arr array_chunks_free; // struct obj_array_chunk
+	struct bucket_arr array_indexes; // struct obj_array_index
+	struct hash array_index_ids; // array id -> index into array_indexes
 	struct bucket_arr obj_aos[obj_type_count - _obj_aos_start];
 	struct vm_reflection_registry reflected;
 	struct hash str_hash;
 	obj complex_types;
+	struct obj_young young;
+	struct str_builders str_builders;
 	bool obj_clear_mark_set;
 };
 
@@ -193,6 +209,13 @@ struct vm_ops {
 	vm_op_fn ops[op_count];
 };
 
+// Execution counts collected by `muon internal eval -p`.  pairs[a][b] counts
+// how often op b was dispatched directly after op a.
+struct vm_op_profile {
+	uint64_t ops[op_count];
+	uint64_t pairs[op_count][op_count];
+};
+
 struct vm_type_registry {
 	obj structs;
 
@@ -227,10 +250,39 @@ struct vm_type_registry {
 	obj top_level_docs;
 };
 
+/*
+ * Remembers which entry of a native function's args_kw array a keyword
+ * argument at a particular call site resolved to.  key is the args_kw key
+ * pointer, which is compared by identity to validate the entry.
+ */
+struct vm_kwarg_slot {
+	const char *key;
+	uint32_t i;
+};
+
+/*
+ * A global variable access compiled with a known name refers to one of
+ * these.  It caches where that name's value lives in the dict of the global
+ * scope it was last resolved in.  The dict remains the only store of the
+ * value; the entry is only trusted while the scope and its storage are
+ * unchanged.
+ */
+struct vm_global_slot {
+	obj scope;
+	uint32_t data, flags, generation;
+	obj *val;
+};
+
 struct vm {
 	struct object_stack stack;
-	struct arr call_stack, locations, code, src;
+	struct arr call_stack, locations, code, src, kwarg_slots, global_slots;
+	// Incremented whenever a global is unset, since removing a key from a
+	// dict can move other values.
+	uint32_t global_slots_generation;
 	uint32_t ip, nargs, nkwargs, call_stack_base;
+	// Index + 1 into kwarg_slots for the native function that was just
+	// dispatched by op_call_native, or 0.  Consumed by its pop_args.
+	uint32_t call_kwarg_slots;
 	obj global_scope, default_global_scope;
 	obj modules;
 	struct arr open_upvalues;
@@ -241,6 +293,8 @@ struct vm {
 	struct vm_compiler_state compiler_state;
 	struct vm_dbg_state dbg_state;
 	struct vm_type_registry types;
+	struct vm_op_profile *op_profile;
+	struct vm_profile *profile;
 
 	enum language_mode lang_mode;
 
@@ -288,9 +342,14 @@ void vm_reflect_objects(struct workspace *wk);
 struct vm_mem_stats {
 	uint32_t count[obj_type_count];
 	uint32_t bytes[obj_type_count];
+	struct {
+		uint32_t chunks;
+		uint64_t elems, reserved, used, allocated;
+	} array_storage;
 };
 void vm_mem_stat(struct workspace *wk, struct vm_mem_stats *stats);
 void vm_mem_stat_print(struct workspace *wk, struct vm_mem_stats *stats);
+void vm_op_profile_print(struct workspace *wk);
 
 bool pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[]);
 bool vm_pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[]);
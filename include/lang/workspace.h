@@ -56,6 +56,8 @@ enum workspace_init_flag {
 	workspace_init_flag_startup_files = 1 << 3,
 	workspace_init_flag_global_options = 1 << 4,
 	workspace_init_flag_cmake_runtime = 1 << 5,
+	workspace_init_flag_toolchain_runtime = 1 << 6,
+	workspace_init_flag_dependency_runtime = 1 << 7,
 };
 
 struct workspace {
@@ -92,6 +94,15 @@ struct workspace {
 	obj global_opts;
 	/* dict[sha_512 -> [bool, any]] */
 	obj compiler_check_cache;
+	/* the user-level compiler check cache, see toolchains.c */
+	struct {
+		const char *path;
+		/* dict[argv0 and machine -> sha_256 of the tool's identity] */
+		obj idents;
+		/* dict[sha_256 -> [bool, any]], records loaded from the cache file */
+		obj entries;
+		bool initialized;
+	} user_compiler_check_cache;
 	/* dict -> dict[method -> closure] */
 	obj dependency_handlers;
 	/* list[str], used for error reporting */
@@ -121,6 +132,8 @@ void workspace_init_bare(struct workspace *wk, struct arena *a, struct arena *a_
 void workspace_init_runtime(struct workspace *wk);
 void workspace_init_startup_files(struct workspace *wk);
 void workspace_init_cmake_runtime(struct workspace *wk);
+void workspace_init_toolchain_runtime(struct workspace *wk);
+void workspace_init_dependency_runtime(struct workspace *wk);
 void workspace_setup_paths(struct workspace *wk, const char *build, const char *argv0, obj regen_args);
 void workspace_add_exclude_regenerate_dep(struct workspace *wk, obj v);
 void workspace_add_regenerate_dep(struct workspace *wk, obj v);
@@ -27,6 +27,19 @@ struct tstr;
 bool fs_stat(const char *path, struct stat *sb);
 enum fs_mtime_result { fs_mtime_result_ok, fs_mtime_result_not_found, fs_mtime_result_err };
 enum fs_mtime_result fs_mtime(const char *path, int64_t *mtime);
+
+struct fs_mtime_batch_entry {
+	const char *path;
+	int64_t mtime;
+	enum fs_mtime_result res;
+};
+
+// Like fs_mtime for each entry, but the files may be stat'd concurrently by
+// the threads of *pool, which is created the first time it is needed.
+// Errors are not logged, call fs_mtime on failed entries to report them.
+struct fs_mtime_pool;
+void fs_mtime_batch(struct fs_mtime_pool **pool, struct fs_mtime_batch_entry *entries, uint32_t len);
+void fs_mtime_pool_destroy(struct fs_mtime_pool *pool);
 bool fs_exists(const char *path);
 bool fs_file_exists(const char *path);
 bool fs_symlink_exists(const char *path);
@@ -38,6 +51,16 @@ bool fs_mkdir_p_recorded(struct workspace *wk, const char *path, obj record);
 bool fs_rmdir(const char *path, bool force);
 bool fs_rmdir_recursive(struct workspace *wk, const char *path, bool force);
 bool fs_read_entire_file(struct arena *a, const char *path, struct source *src);
+
+struct fs_mapped_file {
+	const char *data; // not NUL terminated
+	uint64_t len;
+	void *handle; // platform specific
+};
+
+// Maps a file read only into memory.  Empty files are not mapped.
+bool fs_map_file(const char *path, struct fs_mapped_file *map);
+void fs_unmap_file(struct fs_mapped_file *map);
 bool fs_fsize(FILE *file, uint64_t *ret);
 bool fs_close(int *fd);
 bool fs_fclose(FILE *file);
@@ -70,10 +93,13 @@ bool fs_is_a_tty(struct workspace *wk, FILE *f);
 bool fs_chmod(const char *path, uint32_t mode);
 bool fs_copy_metadata(const char *src, const char *dest);
 bool fs_remove(const char *path);
+bool fs_rename(const char *old_path, const char *new_path);
 bool fs_has_extension(const char *path, const char *ext);
 FILE *fs_make_tmp_file(const char *name, const char *suffix, char *buf, uint32_t len);
 bool fs_make_writable_if_exists(const char *path);
 bool fs_wait_for_input(int fd, uint32_t *bytes_available);
+bool fs_has_input(int fd);
+bool fs_fd_is_regular_file(int fd);
 
 typedef enum iteration_result((*fs_dir_foreach_cb)(void *_ctx, const char *path));
 bool fs_dir_foreach(struct workspace *wk, const char *path, void *_ctx, fs_dir_foreach_cb cb);
@@ -82,6 +108,7 @@ enum fs_path_xdg_type {
 	fs_path_xdg_type_config,
 	fs_path_xdg_type_data,
 	fs_path_xdg_type_state,
+	fs_path_xdg_type_cache,
 };
 
 enum fs_path_xdg_flag {
@@ -82,6 +82,14 @@ bool run_cmd_determine_interpreter(
 bool run_cmd(struct workspace *wk, struct run_cmd_ctx *ctx, const char *argstr, uint32_t argc, const char *envstr, uint32_t envc);
 bool run_cmd_argv(struct workspace *wk, struct run_cmd_ctx *ctx, char *const *argv, const char *envstr, uint32_t envc);
 enum run_cmd_state run_cmd_collect(struct workspace *wk, struct run_cmd_ctx *ctx);
+/*
+ * Blocks until at least one of the given commands may have made progress,
+ * i.e. it produced output or a child process exited, or until timeout_ms
+ * milliseconds have elapsed.  A negative timeout blocks indefinitely.
+ * Wakeups may be spurious, callers should run_cmd_collect() every ctx
+ * afterwards.
+ */
+void run_cmd_wait_any(struct workspace *wk, struct run_cmd_ctx *const *ctxs, uint32_t len, int32_t timeout_ms);
 void run_cmd_ctx_destroy(struct run_cmd_ctx *ctx);
 bool run_cmd_kill(struct run_cmd_ctx *ctx, bool force);
 
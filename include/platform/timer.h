@@ -31,6 +31,7 @@ struct timer {
 
 void timer_start(struct timer *t);
 float timer_read(struct timer *t);
+uint64_t timer_read_ns(struct timer *t);
 void timer_sleep(uint64_t nanoseconds);
 
 #define SLEEP_TIME 10000000 // 10ms
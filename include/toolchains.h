@@ -256,6 +256,7 @@ struct compiler_check_cache_key {
 	const char *argstr;
 	const char *src;
 	uint32_t argc;
+	bool src_is_path;
 };
 
 struct compiler_check_cache_value {
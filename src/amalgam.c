@@ -104,6 +104,7 @@
 #include "lang/object.c"
 #include "lang/object_iterators.c"
 #include "lang/parser.c"
+#include "lang/profile.c"
 #include "lang/serial.c"
 #include "lang/server.c"
 #include "lang/string.c"
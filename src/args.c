@@ -161,15 +161,21 @@ static void
 simple_escape(struct workspace *wk, struct tstr *sb, const char *str, const char *need_escaping, char esc_char)
 {
 	const char *s = str;
+	uint32_t span;
 
-	for (; *s; ++s) {
-		if (strchr(need_escaping, *s)) {
-			tstr_push(wk, sb, esc_char);
-		} else if (*s == '\n') {
-			assert(false && "newlines cannot be escaped");
+	while (true) {
+		span = strcspn(s, need_escaping);
+		assert(!memchr(s, '\n', span) && "newlines cannot be escaped");
+		tstr_pushn(wk, sb, s, span);
+		s += span;
+
+		if (!*s) {
+			break;
 		}
 
+		tstr_push(wk, sb, esc_char);
 		tstr_push(wk, sb, *s);
+		++s;
 	}
 }
 
@@ -195,24 +201,30 @@ pkgconf_escape(struct workspace *wk, struct tstr *sb, const char *str)
 
 typedef void((*escape_func)(struct workspace *wk, struct tstr *sb, const char *str));
 
-static obj
-join_args(struct workspace *wk, obj arr, escape_func escape)
+static void
+push_args(struct workspace *wk, struct tstr *sb, obj arr, escape_func escape)
 {
-	TracyCZoneAutoS;
-	TSTR(res);
-
 	obj val;
 	obj_array_for_(wk, arr, val, iter) {
 		const struct str *s = get_str(wk, val);
 		if (escape) {
-			escape(wk, &res, s->s);
+			escape(wk, sb, s->s);
 		} else {
-			tstr_pushn(wk, &res, s->s, s->len);
+			tstr_pushn(wk, sb, s->s, s->len);
 		}
 		if (iter.i < iter.len - 1) {
-			tstr_push(wk, &res, ' ');
+			tstr_push(wk, sb, ' ');
 		}
 	}
+}
+
+static obj
+join_args(struct workspace *wk, obj arr, escape_func escape)
+{
+	TracyCZoneAutoS;
+	TSTR(res);
+
+	push_args(wk, &res, arr, escape);
 
 	TracyCZoneAutoE;
 	return tstr_into_str(wk, &res);
@@ -242,6 +254,18 @@ join_args_shell_ninja(struct workspace *wk, obj arr)
 	return join_args(wk, arr, shell_ninja_escape);
 }
 
+void
+push_args_ninja(struct workspace *wk, struct tstr *sb, obj arr)
+{
+	push_args(wk, sb, arr, ninja_escape);
+}
+
+void
+push_args_shell_ninja(struct workspace *wk, struct tstr *sb, obj arr)
+{
+	push_args(wk, sb, arr, shell_ninja_escape);
+}
+
 obj
 join_args_pkgconf(struct workspace *wk, obj arr)
 {
@@ -95,7 +95,7 @@ struct write_build_ctx {
 };
 
 static bool
-ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
+ninja_write_build(struct workspace *wk, void *_ctx, struct tstr *out)
 {
 	struct write_build_ctx *ctx = _ctx;
 	struct check_tgt_ctx check_ctx = { 0 };
@@ -145,7 +145,8 @@ ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
 	}
 
 	{ // Add install target for compatibility with meson
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"build install: phony muon-internal__install\n"
 			"build muon-internal__install: CUSTOM_COMMAND\n"
 			" desc = Installing$ files\n"
@@ -155,7 +156,8 @@ ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
 	}
 
 	if (!wrote_default) {
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"build muon_do_nothing: phony\n"
 			"default muon_do_nothing\n");
 	}
@@ -171,7 +173,7 @@ ninja_write_all(struct workspace *wk)
 
 	obj_array_push(wk, wk->backend_output_stack, make_str(wk, "ninja_write_all"));
 
-	if (!(with_open(wk->build_root, "build.ninja", wk, &ctx, ninja_write_build))) {
+	if (!(with_open_buffered(wk->build_root, "build.ninja", wk, &ctx, ninja_write_build))) {
 		return false;
 	}
 
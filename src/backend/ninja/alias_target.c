@@ -21,9 +21,6 @@ ninja_write_alias_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *ct
 
 	L("writing rules for alias target '%s'", get_cstr(wk, tgt->name));
 
-	TSTR(name_esc);
-	ninja_escape(wk, &name_esc, get_cstr(wk, tgt->name));
-
 	obj depstrs;
 	if (!arr_to_args(wk,
 		    arr_to_args_alias_target | arr_to_args_build_target | arr_to_args_custom_target
@@ -32,11 +29,12 @@ ninja_write_alias_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *ct
 		    &depstrs)) {
 		return false;
 	}
-	obj depstr = join_args_ninja(wk, depstrs);
 
-	if (fprintf(ctx->out, "build %s: phony | %s\n\n", name_esc.buf, get_cstr(wk, depstr)) < 0) {
-		return false;
-	}
+	tstr_pushs(wk, ctx->out, "build ");
+	ninja_escape(wk, ctx->out, get_cstr(wk, tgt->name));
+	tstr_pushs(wk, ctx->out, ": phony | ");
+	push_args_ninja(wk, ctx->out, depstrs);
+	tstr_pushs(wk, ctx->out, "\n\n");
 
 	return true;
 }
@@ -21,7 +21,7 @@
 #include "tracy.h"
 
 struct write_tgt_source_ctx {
-	FILE *out;
+	struct tstr *out;
 	const struct obj_build_target *tgt;
 	const struct project *proj;
 	struct build_dep args;
@@ -80,17 +80,18 @@ write_vala_two_stage_compilation(struct workspace *wk,
 
 	// emit the Vala compilation step
 	// build <c_path>: <vala_rule> <src_path>
-	fprintf(ctx->out, "build %s: %s %s", esc_c_path.buf, get_cstr(wk, vala_rule_name), esc_src_path.buf);
+	tstr_pushf(wk, ctx->out, "build %s: %s %s", esc_c_path.buf, get_cstr(wk, vala_rule_name), esc_src_path.buf);
 
 	// add implicit and order deps
 	if (ctx->implicit_deps) {
-		fputs(" | ", ctx->out);
-		fputs(get_cstr(wk, ctx->implicit_deps), ctx->out);
+		tstr_pushs(wk, ctx->out, " | ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, ctx->implicit_deps));
 	}
 	if (ctx->have_order_deps) {
-		fprintf(ctx->out, " || %s", get_cstr(wk, ctx->order_deps));
+		tstr_pushs(wk, ctx->out, " || ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, ctx->order_deps));
 	}
-	fputc('\n', ctx->out);
+	tstr_push(wk, ctx->out, '\n');
 
 	// emit ARGS for vala compilation if necessary
 	if (!vala_specialized_rule) {
@@ -105,9 +106,9 @@ write_vala_two_stage_compilation(struct workspace *wk,
 		obj_array_extend(wk, vala_args, toolchain_compiler_debug(wk, vala_comp));
 
 		obj vala_args_joined = join_args_ninja(wk, vala_args);
-		fprintf(ctx->out, " ARGS = %s -d %s\n", get_cstr(wk, vala_args_joined), output_dir.buf);
+		tstr_pushf(wk, ctx->out, " ARGS = %s -d %s\n", get_cstr(wk, vala_args_joined), output_dir.buf);
 	} else {
-		fprintf(ctx->out, " ARGS = -d %s\n", output_dir.buf);
+		tstr_pushf(wk, ctx->out, " ARGS = -d %s\n", output_dir.buf);
 	}
 
 	// now emit the C compilation step
@@ -123,16 +124,17 @@ write_vala_two_stage_compilation(struct workspace *wk,
 	ninja_escape(wk, &esc_dest_path, dest_path->buf);
 
 	// build <dest_path>: <c_rule> <c_path>
-	fprintf(ctx->out, "build %s: %s %s", esc_dest_path.buf, get_cstr(wk, c_rule_name), esc_c_path.buf);
+	tstr_pushf(wk, ctx->out, "build %s: %s %s", esc_dest_path.buf, get_cstr(wk, c_rule_name), esc_c_path.buf);
 	// add implicit and order deps
 	if (ctx->implicit_deps) {
-		fputs(" | ", ctx->out);
-		fputs(get_cstr(wk, ctx->implicit_deps), ctx->out);
+		tstr_pushs(wk, ctx->out, " | ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, ctx->implicit_deps));
 	}
 	if (ctx->have_order_deps) {
-		fprintf(ctx->out, " || %s", get_cstr(wk, ctx->order_deps));
+		tstr_pushs(wk, ctx->out, " || ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, ctx->order_deps));
 	}
-	fputc('\n', ctx->out);
+	tstr_push(wk, ctx->out, '\n');
 
 	// emit ARGS for C compilation if necessary
 	if (!c_specialized_rule) {
@@ -146,7 +148,7 @@ write_vala_two_stage_compilation(struct workspace *wk,
 			LOG_E("No compiler defined for language c");
 			return 0;
 		}
-		fprintf(ctx->out, " ARGS = %s\n", get_cstr(wk, c_args));
+		tstr_pushf(wk, ctx->out, " ARGS = %s\n", get_cstr(wk, c_args));
 	}
 
 	return tstr_into_str(wk, dest_path);
@@ -209,21 +211,19 @@ write_tgt_source(struct workspace *wk, struct write_tgt_source_ctx *ctx, enum co
 		specialized_rule = obj_array_index(wk, rule_name_arr, 1);
 	}
 
-	TSTR(esc_dest_path);
-	TSTR(esc_path);
-
-	ninja_escape(wk, &esc_dest_path, dest_path.buf);
-	ninja_escape(wk, &esc_path, src_path.buf);
-
-	fprintf(ctx->out, "build %s: %s %s", esc_dest_path.buf, get_cstr(wk, rule_name), esc_path.buf);
+	tstr_pushs(wk, ctx->out, "build ");
+	ninja_escape(wk, ctx->out, dest_path.buf);
+	tstr_pushf(wk, ctx->out, ": %s ", get_cstr(wk, rule_name));
+	ninja_escape(wk, ctx->out, src_path.buf);
 	if (ctx->implicit_deps) {
-		fputs(" | ", ctx->out);
-		fputs(get_cstr(wk, ctx->implicit_deps), ctx->out);
+		tstr_pushs(wk, ctx->out, " | ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, ctx->implicit_deps));
 	}
 	if (ctx->have_order_deps) {
-		fprintf(ctx->out, " || %s", get_cstr(wk, ctx->order_deps));
+		tstr_pushs(wk, ctx->out, " || ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, ctx->order_deps));
 	}
-	fputc('\n', ctx->out);
+	tstr_push(wk, ctx->out, '\n');
 
 	if (!specialized_rule) {
 		obj *joined_args, processed_args;
@@ -245,7 +245,9 @@ write_tgt_source(struct workspace *wk, struct write_tgt_source_ctx *ctx, enum co
 			goto done;
 		}
 
-		fprintf(ctx->out, " ARGS = %s\n", get_cstr(wk, args));
+		tstr_pushs(wk, ctx->out, " ARGS = ");
+		tstr_pushs(wk, ctx->out, get_cstr(wk, args));
+		tstr_push(wk, ctx->out, '\n');
 	}
 
 	dest_res = dest;
@@ -290,7 +292,8 @@ ninja_write_build_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *wc
 			obj order_deps = join_args_ninja(wk, deduped);
 
 			if (get_obj_array(wk, deduped)->len > 1) {
-				fprintf(wctx->out,
+				tstr_pushf(wk,
+					wctx->out,
 					"build %s-order_deps: phony || %s\n",
 					esc_path.buf,
 					get_cstr(wk, order_deps));
@@ -398,38 +401,37 @@ ninja_write_build_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *wc
 	default: UNREACHABLE_RETURN;
 	}
 
-	fprintf(wctx->out, "build %s", esc_path.buf);
+	tstr_pushf(wk, wctx->out, "build %s", esc_path.buf);
 
 	if (tgt->implib) {
 		obj rel;
 		ca_relativize_path(wk, tgt->implib, true, &rel);
-		fprintf(wctx->out, " | %s", get_cstr(wk, rel));
+		tstr_pushf(wk, wctx->out, " | %s", get_cstr(wk, rel));
 	}
 
-	fprintf(wctx->out, ": %s ", link_rule.buf);
+	tstr_pushf(wk, wctx->out, ": %s ", link_rule.buf);
 
-	fputs(get_cstr(wk, join_args_ninja(wk, ctx.object_names)), wctx->out);
+	push_args_ninja(wk, wctx->out, ctx.object_names);
 
 	if (get_obj_array(wk, implicit_link_deps)->len) {
-		implicit_link_deps = join_args_ninja(wk, implicit_link_deps);
-		fputs(" | ", wctx->out);
-		fputs(get_cstr(wk, implicit_link_deps), wctx->out);
+		tstr_pushs(wk, wctx->out, " | ");
+		push_args_ninja(wk, wctx->out, implicit_link_deps);
 	}
 	if (ctx.have_order_deps) {
-		fputs(" || ", wctx->out);
-		fputs(get_cstr(wk, ctx.order_deps), wctx->out);
+		tstr_pushs(wk, wctx->out, " || ");
+		tstr_pushs(wk, wctx->out, get_cstr(wk, ctx.order_deps));
 	}
 	if (link_args) {
-		fprintf(wctx->out, "\n LINK_ARGS = %s", link_args);
+		tstr_pushf(wk, wctx->out, "\n LINK_ARGS = %s", link_args);
 	}
 
 	if (tgt->flags & build_tgt_flag_build_by_default) {
 		wctx->wrote_default = true;
-		fprintf(wctx->out, "\ndefault %s\n", esc_path.buf);
+		tstr_pushf(wk, wctx->out, "\ndefault %s\n", esc_path.buf);
 	}
 
 done:
-	fprintf(wctx->out, "\n");
+	tstr_pushs(wk, wctx->out, "\n");
 	TracyCZoneAutoE;
 	return true;
 }
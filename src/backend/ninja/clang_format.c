@@ -182,7 +182,7 @@ clang_format_write_file_list(struct workspace *wk, void *_ctx, FILE *out)
 
 static void
 ninja_create_phony_clang_format_target(struct workspace *wk,
-	FILE *out,
+	struct tstr *out,
 	const struct str *target_name,
 	const struct str *command,
 	const struct str *description)
@@ -190,7 +190,7 @@ ninja_create_phony_clang_format_target(struct workspace *wk,
 	TSTR(desc_escaped);
 	ninja_escape(wk, &desc_escaped, description->s);
 
-	obj_fprintf(wk,
+	tstr_pushf(wk,
 		out,
 		"build %s: CUSTOM_COMMAND build_always_stale\n"
 		" command = %s\n"
@@ -202,7 +202,7 @@ ninja_create_phony_clang_format_target(struct workspace *wk,
 }
 
 void
-ninja_clang_format_write_targets(struct workspace *wk, FILE *out)
+ninja_clang_format_write_targets(struct workspace *wk, struct tstr *out)
 {
 	struct clang_format_collect_sources_ctx ctx[1] = { {
 		.file_list = make_obj(wk, obj_array),
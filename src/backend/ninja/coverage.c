@@ -34,7 +34,7 @@ cleanup:
 }
 
 static void
-ninja_coverage_write_phony_clean_target(struct workspace *wk, FILE *out)
+ninja_coverage_write_phony_clean_target(struct workspace *wk, struct tstr *out)
 {
 	obj cmdline;
 	cmdline = make_obj(wk, obj_array);
@@ -52,10 +52,10 @@ ninja_coverage_write_phony_clean_target(struct workspace *wk, FILE *out)
 		}
 	);
 
-	fprintf(out, "build clean: phony muon-internal__clean\n");
+	tstr_pushs(wk, out, "build clean: phony muon-internal__clean\n");
 
 	cmdline = join_args_shell_ninja(wk, cmdline);
-	fprintf(out, "build muon-internal__clean: CUSTOM_COMMAND build_always_stale | clean-gcda clean-gcno\n"
+	tstr_pushf(wk, out, "build muon-internal__clean: CUSTOM_COMMAND build_always_stale | clean-gcda clean-gcno\n"
 		" command = %s\n"
 		" description = Cleaning\n\n",
 		get_cstr(wk, cmdline));
@@ -92,19 +92,19 @@ ninja_coverage_base_cmdline(struct workspace *wk)
 }
 
 static void
-ninja_create_phony_target(struct workspace *wk, FILE *out,
+ninja_create_phony_target(struct workspace *wk, struct tstr *out,
 						  const char *target_name, const char *command,
 						  const char *description)
 {
-	fprintf(out, "build %s: phony muon-internal__%s\n\n", target_name, target_name);
-	fprintf(out, "build muon-internal__%s: CUSTOM_COMMAND build_always_stale\n"
+	tstr_pushf(wk, out, "build %s: phony muon-internal__%s\n\n", target_name, target_name);
+	tstr_pushf(wk, out, "build muon-internal__%s: CUSTOM_COMMAND build_always_stale\n"
 		" command = %s\n"
 		" description = %s\n\n",
 		target_name, command, description);
 }
 
 static void
-ninja_coverage_write_coverage_target(struct workspace *wk, FILE *out,
+ninja_coverage_write_coverage_target(struct workspace *wk, struct tstr *out,
 									 const char *target_name,
 									 const char *script_arg,
 									 const char *target_description)
@@ -127,7 +127,7 @@ ninja_coverage_write_coverage_target(struct workspace *wk, FILE *out,
 }
 
 static void
-ninja_coverage_write_coverage_targets(struct workspace *wk, FILE *out)
+ninja_coverage_write_coverage_targets(struct workspace *wk, struct tstr *out)
 {
 	ninja_coverage_write_coverage_target(wk, out,
 		"coverage", NULL, "Generating coverage reports");
@@ -142,7 +142,7 @@ ninja_coverage_write_coverage_targets(struct workspace *wk, FILE *out)
 }
 
 static void
-ninja_write_recursive_delete_target(struct workspace *wk, FILE *out,
+ninja_write_recursive_delete_target(struct workspace *wk, struct tstr *out,
 									const char *target_name, const char *suffix)
 {
 	obj cmdline;
@@ -162,10 +162,10 @@ ninja_write_recursive_delete_target(struct workspace *wk, FILE *out,
 		}
 	);
 
-	fprintf(out, "build %s: phony muon-internal__%s\n", target_name, target_name);
+	tstr_pushf(wk, out, "build %s: phony muon-internal__%s\n", target_name, target_name);
 
 	cmdline = join_args_shell_ninja(wk, cmdline);
-	fprintf(out, "build muon-internal__%s: CUSTOM_COMMAND build_always_stale\n"
+	tstr_pushf(wk, out, "build muon-internal__%s: CUSTOM_COMMAND build_always_stale\n"
 		" command = %s\n"
 		" description = Deleting$ %s$ files\n\n",
 		target_name,
@@ -174,14 +174,14 @@ ninja_write_recursive_delete_target(struct workspace *wk, FILE *out,
 }
 
 static void
-ninja_coverage_write_cleanup_targets(struct workspace *wk, FILE *out)
+ninja_coverage_write_cleanup_targets(struct workspace *wk, struct tstr *out)
 {
 	ninja_write_recursive_delete_target(wk, out, "clean-gcda", ".gcda");
 	ninja_write_recursive_delete_target(wk, out, "clean-gcno", ".gcno");
 }
 
 void
-ninja_coverage_write_targets(struct workspace *wk, FILE *out)
+ninja_coverage_write_targets(struct workspace *wk, struct tstr *out)
 {
 	ninja_coverage_write_coverage_targets(wk, out);
 	ninja_coverage_write_phony_clean_target(wk, out);
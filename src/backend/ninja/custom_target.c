@@ -165,11 +165,6 @@ ninja_write_custom_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *c
 		obj_array_push(wk, depends_rel, make_str(wk, "build_always_stale"));
 	}
 
-	obj depends = join_args_ninja(wk, depends_rel);
-	outputs = join_args_ninja(wk, outputs);
-	inputs = inputs ? join_args_ninja(wk, inputs) : make_str(wk, "");
-	cmdline = join_args_shell_ninja(wk, cmdline);
-
 	const char *rule;
 	if (tgt->depfile) {
 		rule = "CUSTOM_COMMAND_DEP";
@@ -177,30 +172,35 @@ ninja_write_custom_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *c
 		rule = "CUSTOM_COMMAND";
 	}
 
-	fprintf(ctx->out,
-		"build %s: %s %s | %s\n"
-		" COMMAND = %s\n",
-		get_cstr(wk, outputs),
-		rule,
-		get_cstr(wk, inputs),
-		get_cstr(wk, depends),
-		get_cstr(wk, cmdline));
+	tstr_pushs(wk, ctx->out, "build ");
+	push_args_ninja(wk, ctx->out, outputs);
+	tstr_pushf(wk, ctx->out, ": %s ", rule);
+	if (inputs) {
+		push_args_ninja(wk, ctx->out, inputs);
+	}
+	tstr_pushs(wk, ctx->out, " | ");
+	push_args_ninja(wk, ctx->out, depends_rel);
+	tstr_pushs(wk, ctx->out, "\n COMMAND = ");
+	push_args_shell_ninja(wk, ctx->out, cmdline);
+	tstr_push(wk, ctx->out, '\n');
 
 	if (tgt->depfile) {
 		obj depfile_rel;
 		ca_relativize_path(wk, tgt->depfile, false, &depfile_rel);
-		fprintf(ctx->out, " DEPFILE = %s\n", get_cstr(wk, depfile_rel));
+		tstr_pushf(wk, ctx->out, " DEPFILE = %s\n", get_cstr(wk, depfile_rel));
 	}
 
 	if (tgt->flags & custom_target_console) {
-		fprintf(ctx->out, " pool = console\n");
+		tstr_pushs(wk, ctx->out, " pool = console\n");
 	}
 
 	if (tgt->flags & custom_target_build_by_default) {
 		ctx->wrote_default = true;
-		fprintf(ctx->out, "default %s\n", get_cstr(wk, outputs));
+		tstr_pushs(wk, ctx->out, "default ");
+		push_args_ninja(wk, ctx->out, outputs);
+		tstr_push(wk, ctx->out, '\n');
 	}
 
-	fprintf(ctx->out, "\n");
+	tstr_push(wk, ctx->out, '\n');
 	return ir_cont;
 }
@@ -19,7 +19,7 @@
 #include "tracy.h"
 
 struct write_compiler_rule_ctx {
-	FILE *out;
+	struct tstr *out;
 	struct project *proj;
 	struct obj_build_target *tgt;
 	obj args[machine_kind_count];
@@ -54,7 +54,7 @@ escape_rule(struct tstr *buf)
 
 static void
 write_linker_rule(struct workspace *wk,
-	FILE *out,
+	struct tstr *out,
 	struct project *proj,
 	enum machine_kind machine,
 	enum compiler_language l,
@@ -89,7 +89,8 @@ write_linker_rule(struct workspace *wk,
 	get_option_value(wk, current_project(wk), "backend_max_links", &backend_max_links);
 	const char *linker_pool = get_obj_number(wk, backend_max_links) ? " pool = linker_pool\n" : "";
 
-	fprintf(out,
+	tstr_pushf(wk,
+		out,
 		"rule %s_%s_%s_linker\n"
 		" command = %s\n"
 		" description = linking $out\n"
@@ -103,7 +104,7 @@ write_linker_rule(struct workspace *wk,
 }
 
 static void
-write_archiver_rule(struct workspace *wk, FILE *out, struct project *proj, enum machine_kind machine)
+write_archiver_rule(struct workspace *wk, struct tstr *out, struct project *proj, enum machine_kind machine)
 {
 	enum compiler_language archiver_precedence[] = {
 		compiler_language_c,
@@ -141,7 +142,8 @@ write_archiver_rule(struct workspace *wk, FILE *out, struct project *proj, enum
 		obj_array_extend(wk, static_link_args, toolchain_archiver_base(wk, comp_id));
 		obj_array_extend(wk, static_link_args, toolchain_archiver_input_output(wk, comp_id, "$in", "$out"));
 
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"rule %s_%s_archiver\n"
 			" command = %s\n"
 			" description = linking static $out\n"
@@ -153,7 +155,7 @@ write_archiver_rule(struct workspace *wk, FILE *out, struct project *proj, enum
 }
 
 static void
-write_compiler_rule(struct workspace *wk, FILE *out, obj rule_args, obj rule_name, enum compiler_language l, obj comp_id)
+write_compiler_rule(struct workspace *wk, struct tstr *out, obj rule_args, obj rule_name, enum compiler_language l, obj comp_id)
 {
 	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
 
@@ -176,18 +178,20 @@ write_compiler_rule(struct workspace *wk, FILE *out, obj rule_args, obj rule_nam
 
 	obj compile_command = join_args_plain(wk, args);
 
-	fprintf(out,
+	tstr_pushf(wk,
+		out,
 		"rule %s\n"
 		" command = %s\n",
 		get_cstr(wk, rule_name),
 		get_cstr(wk, compile_command));
 	if (deps) {
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			" deps = %s\n"
 			" depfile = ${out}.d\n",
 			deps);
 	}
-	fprintf(out, " description = compiling %s $out\n\n", compiler_language_to_s(l));
+	tstr_pushf(wk, out, " description = compiling %s $out\n\n", compiler_language_to_s(l));
 }
 
 static enum iteration_result
@@ -249,14 +253,15 @@ ret:
 }
 
 bool
-ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bool need_phony, obj compiler_rule_arr)
+ninja_write_rules(struct tstr *out, struct workspace *wk, struct project *main_proj, bool need_phony, obj compiler_rule_arr)
 {
 	TracyCZoneAutoS;
 	obj_array_push(wk, wk->backend_output_stack, make_str(wk, "ninja_write_rules"));
 
 	bool res = false;
 
-	fprintf(out,
+	tstr_pushf(wk,
+		out,
 		"# This is the build file for project \"%s\"\n"
 		"# It is autogenerated by the muon build system.\n"
 		"ninja_required_version = 1.7.1\n"
@@ -267,7 +272,8 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bo
 	get_option_value(wk, main_proj, "backend_max_links", &backend_max_links);
 	int64_t linker_pool_depth = get_obj_number(wk, backend_max_links);
 	if (linker_pool_depth) {
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"pool linker_pool\n"
 			" depth = %lld\n\n",
 			(long long int)linker_pool_depth);
@@ -276,15 +282,18 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bo
 	{ // Build file regeneration
 		obj regen_cmd = join_args_shell(wk, ca_regenerate_build_command(wk, false));
 
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"rule REGENERATE_BUILD\n"
 			" command = %s",
 			get_cstr(wk, regen_cmd));
 
-		fputs("\n description = Regenerating build files.\n"
-		      " generator = 1\n"
-		      "\n",
-			out);
+		tstr_pushs(wk,
+			out,
+			"\n description = Regenerating build files.\n"
+			" generator = 1\n"
+			" restat = 1\n"
+			"\n");
 
 		obj regenerate_deps_rel;
 		{
@@ -305,18 +314,21 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bo
 			ninja_escape(wk, &build_ninja, abs.buf);
 		}
 
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"build %s: REGENERATE_BUILD %s\n"
 			" pool = console\n\n",
 			build_ninja.buf,
 			regenerate_deps);
 
-		fprintf(out,
+		tstr_pushf(wk,
+			out,
 			"build %s: phony\n\n",
 			regenerate_deps);
 	}
 
-	fprintf(out,
+	tstr_pushf(wk,
+		out,
 		"rule CUSTOM_COMMAND\n"
 		" command = $COMMAND\n"
 		" description = $DESC\n"
@@ -331,7 +343,7 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bo
 		"\n");
 
 	if (need_phony) {
-		fprintf(out, "build build_always_stale: phony\n\n");
+		tstr_pushs(wk, out, "build build_always_stale: phony\n\n");
 	}
 
 	obj rule_prefix_arr;
@@ -457,7 +469,7 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj, bo
 		}
 	}
 
-	fprintf(out, "# targets\n\n");
+	tstr_pushs(wk, out, "# targets\n\n");
 
 	res = true;
 ret:
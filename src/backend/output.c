@@ -88,6 +88,86 @@ ret:
 	return ret;
 }
 
+/*
+ * Replace path with buf, unless it already has exactly that content.  Leaving
+ * an unchanged file alone preserves its mtime, which lets ninja skip reloading
+ * a regenerated build.ninja.  The new content is written to a temporary file
+ * and renamed into place so a partially written file is never observed.
+ */
+static bool
+output_write_if_changed(struct workspace *wk, const char *path, const struct tstr *buf)
+{
+	TracyCZoneAutoS;
+	bool ret = false;
+
+	struct stat sb;
+	if (fs_file_exists(path) && fs_stat(path, &sb) && (uint64_t)sb.st_size == buf->len) {
+		struct source existing;
+		if (fs_read_entire_file(wk->a_scratch, path, &existing) && existing.len == buf->len
+			&& memcmp(existing.src, buf->buf, buf->len) == 0) {
+			ret = true;
+			goto ret;
+		}
+	}
+
+	TSTR(tmp);
+	tstr_pushf(wk, &tmp, "%s.tmp", path);
+
+	if (!fs_write_entire_file(tmp.buf, (const uint8_t *)buf->buf, buf->len)) {
+		goto ret;
+	} else if (!fs_rename(tmp.buf, path)) {
+		goto ret;
+	}
+
+	ret = true;
+ret:
+	TracyCZoneAutoE;
+	return ret;
+}
+
+/*
+ * Like with_open, but the callback writes into a single heap allocated buffer
+ * which is written out at once when the callback is done.
+ */
+bool
+with_open_buffered(const char *dir, const char *name, struct workspace *wk, void *ctx, with_open_buffered_callback cb)
+{
+	TracyCZone(tctx_func, true);
+#ifdef TRACY_ENABLE
+	char buf[4096] = { 0 };
+	snprintf(buf, 4096, "with_open_buffered('%s')", name);
+	TracyCZoneName(tctx_func, buf, strlen(buf));
+#endif
+
+	if (wk->backend_output_stack) {
+		obj_array_push(wk, wk->backend_output_stack, make_strf(wk, "writing %s", name));
+	}
+	workspace_scratch_begin(wk);
+
+	bool ret = false;
+	TSTR_CUSTOM(out, 0, tstr_flag_heap);
+
+	if (!cb(wk, ctx, &out)) {
+		goto ret;
+	}
+
+	TSTR(path);
+	path_join(wk, &path, dir, name);
+	if (!output_write_if_changed(wk, path.buf, &out)) {
+		goto ret;
+	}
+
+	ret = true;
+ret:
+	tstr_free(&out);
+	workspace_scratch_end(wk);
+	if (wk->backend_output_stack) {
+		obj_array_pop(wk, wk->backend_output_stack);
+	}
+	TracyCZoneEnd(tctx_func);
+	return ret;
+}
+
 bool
 output_clear_caches(struct workspace *wk)
 {
@@ -80,6 +80,7 @@ struct run_test_ctx {
 	struct arr jobs_sorted;
 
 	struct test_result *jobs;
+	struct run_cmd_ctx **running;
 	uint32_t busy_jobs;
 	bool serial;
 };
@@ -737,6 +738,23 @@ free_slot:
 	}
 }
 
+static void
+wait_for_tests(struct workspace *wk, struct run_test_ctx *ctx)
+{
+	uint32_t i, len = 0;
+
+	for (i = 0; i < ctx->opts->jobs; ++i) {
+		if (ctx->jobs[i].busy) {
+			ctx->running[len++] = &ctx->jobs[i].cmd_ctx;
+		}
+	}
+
+	// Wake up at least every SLEEP_TIME to enforce timeouts and refresh
+	// the progress display.
+	run_cmd_wait_any(wk, ctx->running, len, SLEEP_TIME / 1000000);
+	collect_tests(wk, ctx);
+}
+
 static void
 push_test(struct workspace *wk,
 	struct run_test_ctx *ctx,
@@ -767,8 +785,7 @@ push_test(struct workspace *wk,
 		}
 
 cont:
-		timer_sleep(SLEEP_TIME);
-		collect_tests(wk, ctx);
+		wait_for_tests(wk, ctx);
 	}
 found_slot:
 	++ctx->busy_jobs;
@@ -1015,8 +1032,7 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	}
 
 	while (ctx->busy_jobs) {
-		timer_sleep(SLEEP_TIME);
-		collect_tests(wk, ctx);
+		wait_for_tests(wk, ctx);
 	}
 
 	log_raw("\n");
@@ -1203,6 +1219,7 @@ tests_run(struct workspace *wk, struct test_options *opts, const char *argv0)
 		arr_push(wk->a, &ctx.jobs_sorted, &i);
 	}
 	ctx.jobs = ar_maken(wk->a, struct test_result, ctx.opts->jobs);
+	ctx.running = ar_maken(wk->a, struct run_cmd_ctx *, ctx.opts->jobs);
 
 	{ // load options
 		workspace_init_runtime(wk);
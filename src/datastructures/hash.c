@@ -8,6 +8,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_GROUP_SSE2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define HASH_GROUP_NEON
+#endif
+
 #include "arena.h"
 #include "datastructures/hash.h"
 #include "datastructures/seg_list.h"
@@ -28,34 +36,88 @@ struct strkey {
 	uint64_t len;
 };
 
+/*
+ * A word-at-a-time hash.  Each 8 byte word is mixed with a multiply and
+ * the result is run through the murmur3 finalizer so that the low 7 bits,
+ * which are used as the control byte, are well distributed.  Tails are
+ * read with overlapping loads rather than a variable length copy.
+ */
+
+static const uint64_t hash_k1 = 0x9e3779b97f4a7c15u, hash_k2 = 0xbf58476d1ce4e5b9u;
+
 static uint64_t
-fnv_1a_64_str(const struct hash *hash, const void *_key)
+hash_load_u64(const uint8_t *p)
 {
-	const struct strkey *key = _key;
-	uint64_t h = 14695981039346656037u;
-	uint16_t i;
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
 
-	for (i = 0; i < key->len; i++) {
-		h ^= key->str[i];
-		h *= 1099511628211u;
-	}
+static uint64_t
+hash_load_u32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
 
+static uint64_t
+hash_fmix64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdu;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53u;
+	h ^= h >> 33;
 	return h;
 }
 
 static uint64_t
-fnv_1a_64(const struct hash *hash, const void *_key)
+hash_mix_word(uint64_t h, uint64_t w)
 {
-	const uint8_t *key = _key;
-	uint64_t h = 14695981039346656037u;
-	uint16_t i;
+	w *= hash_k2;
+	return (h ^ (w ^ (w >> 31))) * hash_k1;
+}
+
+static uint64_t
+hash_bytes(const void *key, uint64_t len)
+{
+	const uint8_t *p = key;
+	uint64_t h = len * hash_k1, w;
+
+	if (len >= 8) {
+		const uint8_t *end = p + len - 8;
+		for (; p < end; p += 8) {
+			h = hash_mix_word(h, hash_load_u64(p));
+		}
 
-	for (i = 0; i < hash->key_size; i++) {
-		h ^= key[i];
-		h *= 1099511628211u;
+		w = hash_load_u64(end);
+	} else if (len >= 4) {
+		w = hash_load_u32(p) | (hash_load_u32(p + len - 4) << 32);
+	} else if (len) {
+		w = (uint64_t)p[0] | ((uint64_t)p[len >> 1] << 8) | ((uint64_t)p[len - 1] << 16);
+	} else {
+		w = 0;
 	}
 
-	return h;
+	return hash_fmix64(hash_mix_word(h, w));
+}
+
+static uint64_t
+hash_str(const struct hash *hash, const void *_key)
+{
+	const struct strkey *key = _key;
+	return hash_bytes(key->str, key->len);
+}
+
+static uint64_t
+hash_mem(const struct hash *hash, const void *key)
+{
+	switch (hash->key_size) {
+	case 4: return hash_fmix64(hash_load_u32(key) ^ hash_k1);
+	case 8: return hash_fmix64(hash_load_u64(key) ^ hash_k1);
+	default: return hash_bytes(key, hash->key_size);
+	}
 }
 
 static void
@@ -106,7 +168,7 @@ hash_init_(struct arena *a, struct hash *h, uint32_t cap, uint32_t key_size, uin
 	bucket_arr_init(a, &h->vals, 16, uint64_t);
 
 	h->keycmp = hash_keycmp_memcmp;
-	h->hash_func = fnv_1a_64;
+	h->hash_func = hash_mem;
 
 	TracyCZoneAutoE;
 }
@@ -115,7 +177,28 @@ static bool
 hash_keycmp_strcmp(const struct hash *_h, const void *_a, const void *_b)
 {
 	const struct strkey *a = _a, *b = _b;
-	return a->len == b->len ? strncmp(a->str, b->str, a->len) == 0 : false;
+	return a->len == b->len ? memcmp(a->str, b->str, a->len) == 0 : false;
+}
+
+/*
+ * Compare keys, calling the comparison functions defined above directly
+ * rather than through h->keycmp.
+ */
+static bool
+hash_keycmp_inline(const struct hash *h, const void *a, const void *b)
+{
+	if (h->keycmp == hash_keycmp_strcmp) {
+		const struct strkey *sa = a, *sb = b;
+		return sa->len == sb->len && memcmp(sa->str, sb->str, sa->len) == 0;
+	} else if (h->keycmp == hash_keycmp_memcmp) {
+		switch (h->key_size) {
+		case 4: return *(const uint32_t *)a == *(const uint32_t *)b;
+		case 8: return *(const uint64_t *)a == *(const uint64_t *)b;
+		default: return memcmp(a, b, h->key_size) == 0;
+		}
+	}
+
+	return h->keycmp(h, a, b);
 }
 
 void
@@ -123,36 +206,136 @@ hash_init_str(struct arena *a, struct hash *h, uint32_t cap)
 {
 	hash_init(a, h, cap, struct strkey);
 	h->keycmp = hash_keycmp_strcmp;
-	h->hash_func = fnv_1a_64_str;
+	h->hash_func = hash_str;
+}
+
+/*
+ * Remove all entries while keeping the memory of h for reuse.
+ */
+void
+hash_clear(struct hash *h)
+{
+	fill_meta_with_empty(h);
+	bucket_arr_clear(&h->keys);
+	bucket_arr_clear(&h->vals);
+	h->load = 0;
+}
+
+/*
+ * Control bytes are matched 16 at a time.  Groups are aligned to 16 slots,
+ * which never straddle a segment of h->meta since segments are multiples
+ * of 64 slots and start at multiples of 64.
+ */
+enum {
+	hash_group_size = 16,
+};
+
+static uint32_t
+hash_ctz(uint32_t v)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(v);
+#else
+	uint32_t i = 0;
+	while (!(v & 1)) {
+		v >>= 1;
+		++i;
+	}
+	return i;
+#endif
 }
 
+/*
+ * Returns a bitmask of the bytes in group that are equal to h2 in *match,
+ * and of the bytes that are k_empty in *empty.
+ */
 static void
-probe(const struct hash *h, const void *key, uint32_t **ret_he, uint8_t **ret_meta, uint64_t *hv)
+hash_group_match(const uint8_t *group, uint8_t h2, uint32_t *match, uint32_t *empty)
 {
-#define match ((meta & 0x7f) == h2 && h->keycmp(h, bucket_arr_get(&h->keys, *he), key))
+#if defined(HASH_GROUP_SSE2)
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	*match = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+	*empty = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)k_empty)));
+#elif defined(HASH_GROUP_NEON)
+	static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	const uint8x16_t ctrl = vld1q_u8(group), b = vld1q_u8(bits);
+	uint8x16_t m = vandq_u8(vceqq_u8(ctrl, vdupq_n_u8(h2)), b);
+	uint8x16_t e = vandq_u8(vceqq_u8(ctrl, vdupq_n_u8(k_empty)), b);
+	*match = vaddv_u8(vget_low_u8(m)) | (vaddv_u8(vget_high_u8(m)) << 8);
+	*empty = vaddv_u8(vget_low_u8(e)) | (vaddv_u8(vget_high_u8(e)) << 8);
+#else
+	uint32_t i;
+	*match = *empty = 0;
+	for (i = 0; i < hash_group_size; ++i) {
+		*match |= (uint32_t)(group[i] == h2) << i;
+		*empty |= (uint32_t)(group[i] == k_empty) << i;
+	}
+#endif
+}
 
-	uint32_t *he;
+/*
+ * Find the slot for key.  Slots are probed linearly starting at the slot
+ * selected by the hash, and the first slot that is either empty or holds
+ * key is returned.
+ */
+static void
+probe(const struct hash *h, const void *key, uint32_t **ret_he, uint8_t **ret_meta, uint64_t *hv)
+{
 	*hv = h->hash_func(h, key);
-	const uint64_t h1 = *hv >> 7, h2 = *hv & 0x7f;
-	uint8_t meta;
-	uint64_t hvi = h1 & (h->cap - 1);
-
-	meta = *sl_get(&h->meta, hvi, uint8_t);
-	he = sl_get(&h->elems, hvi, uint32_t);
+	const uint64_t h1 = *hv >> 7;
+	const uint8_t h2 = *hv & 0x7f;
+	uint32_t hvi = h1 & (h->cap - 1);
 
-	// printf("probed to %d, 0x%02x, %d, %d\n", (int)hvi, meta, (int)he->keyi, (int)he->val);
+	if (h->cap < hash_group_size) {
+		uint8_t meta;
+		uint32_t *he;
 
-	while (meta == k_deleted || (k_full(meta) && !match)) {
-		hvi = (hvi + 1) & (h->cap - 1);
 		meta = *sl_get(&h->meta, hvi, uint8_t);
 		he = sl_get(&h->elems, hvi, uint32_t);
-		// printf("--> probed to %d, 0x%02x, %d, %d\n", (int)hvi, meta, (int)he->keyi, (int)he->val);
+
+		while (meta == k_deleted
+			|| (k_full(meta)
+				&& !(meta == h2 && hash_keycmp_inline(h, bucket_arr_get(&h->keys, *he), key)))) {
+			hvi = (hvi + 1) & (h->cap - 1);
+			meta = *sl_get(&h->meta, hvi, uint8_t);
+			he = sl_get(&h->elems, hvi, uint32_t);
+		}
+
+		*ret_meta = sl_get(&h->meta, hvi, uint8_t);
+		*ret_he = he;
+		return;
 	}
 
-	*ret_meta = sl_get(&h->meta, hvi, uint8_t);
-	*ret_he = he;
+	uint32_t group_start = hvi & ~(uint32_t)(hash_group_size - 1);
+	// ignore slots before hvi in the first group
+	uint32_t window = ~(uint32_t)0 << (hvi - group_start);
+
+	while (true) {
+		uint8_t *group = sl_get(&h->meta, group_start, uint8_t);
+		uint32_t match, empty, candidates;
+		hash_group_match(group, h2, &match, &empty);
+
+		candidates = (match | empty) & window & 0xffff;
+		while (candidates) {
+			uint32_t i = hash_ctz(candidates);
+			uint32_t *he = sl_get(&h->elems, group_start + i, uint32_t);
+
+			if ((empty >> i) & 1) {
+				*ret_meta = &group[i];
+				*ret_he = he;
+				return;
+			} else if (hash_keycmp_inline(h, bucket_arr_get(&h->keys, *he), key)) {
+				*ret_meta = &group[i];
+				*ret_he = he;
+				return;
+			}
+
+			candidates &= candidates - 1;
+		}
 
-#undef match
+		group_start = (group_start + hash_group_size) & (h->cap - 1);
+		window = ~(uint32_t)0;
+	}
 }
 
 static void
@@ -233,8 +233,21 @@ get_detailed_source_location(const struct source *src,
 		return;
 	}
 
-	uint32_t i, line = 1, end = loc.off + loc.len;
-	for (i = 0; i < src->len; ++i) {
+	uint32_t i = 0, line = 1, end = loc.off + loc.len;
+
+	// Skip to the line containing loc.off using memchr.  The newline just
+	// before loc.off is left to the loop below as it is a special case for
+	// empty locations.
+	const char *nl;
+	const uint32_t skip_end = loc.off ? loc.off - 1 : 0;
+	while (i < skip_end && (nl = memchr(&src->src[i], '\n', skip_end - i))) {
+		i = (nl - src->src) + 1;
+		++line;
+		dloc->line = line;
+		dloc->start_of_line = i;
+	}
+
+	for (i = skip_end; i < src->len; ++i) {
 		if (i == loc.off) {
 			dloc->col = (i - dloc->start_of_line) + 1;
 		} else if (i == end) {
@@ -7,10 +7,13 @@
 #include "compat.h"
 
 #include <inttypes.h>
+#include <string.h>
 
+#include "buf_size.h"
 #include "external/samurai/ctx.h"
 #include "log.h"
 #include "machines.h"
+#include "platform/mem.h"
 #include "platform/os.h"
 #include "platform/run_cmd.h"
 
@@ -25,6 +28,8 @@ struct samu_job {
 	struct samu_string *cmd;
 	struct samu_edge *edge;
 	size_t next;
+	/* start of the command in milliseconds since the start of the build */
+	int64_t start;
 	struct run_cmd_ctx cmd_ctx;
 	bool failed, running;
 };
@@ -35,7 +40,7 @@ samu_buildreset(struct samu_ctx *ctx)
 	struct samu_edge *e;
 
 	for (e = ctx->graph.alledges; e; e = e->allnext)
-		e->flags &= ~FLAG_WORK;
+		e->flags &= ~(FLAG_WORK | FLAG_WEIGHT | FLAG_STAT);
 }
 
 /* returns whether n1 is newer than n2, or false if n1 is NULL */
@@ -105,20 +110,161 @@ samu_isdirty(struct samu_ctx *ctx, struct samu_node *n, struct samu_node *newest
 	return true;
 }
 
+static void
+samu_edgequeue_push(struct samu_ctx *ctx, struct samu_edgequeue *q, struct samu_edge *e)
+{
+	size_t i, parent;
+
+	if (q->len == q->cap) {
+		size_t cap = q->cap ? q->cap * 2 : 64;
+		q->edges = samu_xreallocarray(ctx->a, q->edges, q->cap, cap, sizeof(q->edges[0]));
+		q->cap = cap;
+	}
+
+	for (i = q->len++; i > 0; i = parent) {
+		parent = (i - 1) / 2;
+		if (q->edges[parent]->weight >= e->weight)
+			break;
+		q->edges[i] = q->edges[parent];
+	}
+	q->edges[i] = e;
+}
+
+static void
+samu_edgequeue_siftdown(struct samu_edgequeue *q, size_t i)
+{
+	struct samu_edge *e = q->edges[i];
+	size_t child;
+
+	for (; (child = 2 * i + 1) < q->len; i = child) {
+		if (child + 1 < q->len && q->edges[child + 1]->weight > q->edges[child]->weight)
+			++child;
+		if (e->weight >= q->edges[child]->weight)
+			break;
+		q->edges[i] = q->edges[child];
+	}
+	q->edges[i] = e;
+}
+
+static struct samu_edge *
+samu_edgequeue_pop(struct samu_edgequeue *q)
+{
+	struct samu_edge *e = q->edges[0];
+
+	if (--q->len) {
+		q->edges[0] = q->edges[q->len];
+		samu_edgequeue_siftdown(q, 0);
+	}
+	return e;
+}
+
+/* restore heap order after the weights of queued edges changed */
+static void
+samu_edgequeue_heapify(struct samu_edgequeue *q)
+{
+	size_t i;
+
+	for (i = q->len / 2; i > 0; --i)
+		samu_edgequeue_siftdown(q, i - 1);
+}
+
 /* add an edge to the work queue */
 static void
 samu_queue(struct samu_ctx *ctx, struct samu_edge *e)
 {
-	struct samu_edge **front = &ctx->build.work;
+	samu_edgequeue_push(ctx, &ctx->build.work, e);
+}
 
-	if (e->pool && e->rule != &ctx->phonyrule) {
-		if (e->pool->numjobs == e->pool->maxjobs)
-			front = &e->pool->work;
-		else
-			++e->pool->numjobs;
+static void
+samu_statqueue_push(struct samu_ctx *ctx, struct samu_node *n)
+{
+	struct samu_statqueue *q = &ctx->build.stat;
+
+	if (n->mtime != SAMU_MTIME_UNKNOWN)
+		return;
+	n->mtime = SAMU_MTIME_QUEUED;
+	if (q->len == q->cap) {
+		size_t cap = q->cap ? q->cap * 2 : 1024;
+		q->entries = samu_xreallocarray(ctx->a, q->entries, q->cap, cap, sizeof(q->entries[0]));
+		q->nodes = samu_xreallocarray(ctx->a, q->nodes, q->cap, cap, sizeof(q->nodes[0]));
+		q->cap = cap;
+	}
+	q->entries[q->len] = (struct fs_mtime_batch_entry){ .path = n->path->s };
+	q->nodes[q->len] = n;
+	++q->len;
+}
+
+void
+samu_buildstat(struct samu_ctx *ctx, struct samu_node *n)
+{
+	struct samu_statqueue *q = &ctx->build.stat;
+	struct samu_edge *e;
+	size_t i;
+
+	samu_statqueue_push(ctx, n);
+	e = n->gen;
+	if (!e || e->flags & (FLAG_STAT | FLAG_WORK))
+		return;
+	e->flags |= FLAG_STAT;
+	for (i = 0; i < e->nout; ++i)
+		samu_statqueue_push(ctx, e->out[i]);
+	for (i = 0; i < e->nin; ++i)
+		samu_buildstat(ctx, e->in[i]);
+	if (!(e->flags & FLAG_DEPS) && samu_edgevar(ctx, e, "deps", true)) {
+		if (q->nedges == q->edgescap) {
+			size_t cap = q->edgescap ? q->edgescap * 2 : 256;
+			q->edges = samu_xreallocarray(ctx->a, q->edges, q->edgescap, cap, sizeof(q->edges[0]));
+			q->edgescap = cap;
+		}
+		q->edges[q->nedges++] = e;
+	}
+}
+
+void
+samu_buildstatall(struct samu_ctx *ctx)
+{
+	struct samu_statqueue *q = &ctx->build.stat;
+	struct samu_nodearray *deps;
+	struct samu_node *n;
+	size_t i, j, nedges;
+
+	while (q->len) {
+		fs_mtime_batch(&q->pool, q->entries, q->len);
+		for (i = 0; i < q->len; ++i) {
+			n = q->nodes[i];
+			switch (q->entries[i].res) {
+			case fs_mtime_result_ok:
+				n->mtime = q->entries[i].mtime;
+				break;
+			case fs_mtime_result_not_found:
+				n->mtime = SAMU_MTIME_MISSING;
+				break;
+			case fs_mtime_result_err:
+				/* stat it again in samu_buildadd to report the error */
+				n->mtime = SAMU_MTIME_UNKNOWN;
+				break;
+			}
+		}
+		q->len = 0;
+
+		/* now that the outputs have been stat, queue the dependencies
+		 * recorded in .ninja_deps, along with anything needed to build them.
+		 * If no pool was started the files are cached, and walking the
+		 * dependencies here as well as in samu_buildadd would cost more
+		 * than it saves */
+		nedges = q->pool ? q->nedges : 0;
+		q->nedges = 0;
+		for (i = 0; i < nedges; ++i) {
+			if (!(deps = samu_depslogged(ctx, q->edges[i])))
+				continue;
+			for (j = 0; j < deps->len; ++j)
+				samu_buildstat(ctx, deps->node[j]);
+		}
 	}
-	e->worknext = *front;
-	*front = e;
+
+	/* the pool is only kept for the batches of this build */
+	fs_mtime_pool_destroy(q->pool);
+	q->pool = NULL;
 }
 
 void
@@ -197,6 +343,95 @@ samu_buildadd(struct samu_ctx *ctx, struct samu_node *n)
 	e->flags &= ~FLAG_CYCLE;
 }
 
+/* returns the duration of the edge's last run from the build log, or -1 */
+static int64_t
+samu_edgelogduration(struct samu_edge *e)
+{
+	struct samu_node *n;
+	int64_t duration = -1;
+	size_t i;
+
+	for (i = 0; i < e->nout; ++i) {
+		n = e->out[i];
+		/* older logs recorded 0 for both times */
+		if (n->logmtime != SAMU_MTIME_MISSING && n->logend > n->logstart && n->logend - n->logstart > duration)
+			duration = n->logend - n->logstart;
+	}
+	return duration;
+}
+
+static int64_t
+samu_edgeweight(struct samu_ctx *ctx, struct samu_edge *e, int64_t estimate)
+{
+	struct samu_node *n;
+	struct samu_edge *u;
+	int64_t weight, max = 0;
+	size_t i, j;
+
+	if (e->flags & FLAG_WEIGHT)
+		return e->weight;
+	e->flags |= FLAG_WEIGHT;
+
+	for (i = 0; i < e->nout; ++i) {
+		n = e->out[i];
+		for (j = 0; j < n->nuse; ++j) {
+			u = n->use[j];
+			if (!(u->flags & FLAG_WORK))
+				continue;
+			weight = samu_edgeweight(ctx, u, estimate);
+			if (weight > max)
+				max = weight;
+		}
+	}
+
+	if (e->rule == &ctx->phonyrule)
+		weight = 0;
+	else if ((weight = samu_edgelogduration(e)) < 0)
+		weight = estimate;
+
+	e->weight = weight + max;
+	return e->weight;
+}
+
+/*
+ * Compute the critical path weight of every edge in this build, so that
+ * ready edges which gate the longest chains of work are started first.
+ * Edges without a duration in the build log are assumed to take as long as
+ * the average edge that has one.
+ */
+static void
+samu_computeweights(struct samu_ctx *ctx)
+{
+	struct samu_edge *e;
+	int64_t duration, total = 0, estimate = 1;
+	size_t known = 0;
+
+	for (e = ctx->graph.alledges; e; e = e->allnext) {
+		e->flags &= ~FLAG_WEIGHT;
+		if (!(e->flags & FLAG_WORK) || e->rule == &ctx->phonyrule)
+			continue;
+		if ((duration = samu_edgelogduration(e)) >= 0) {
+			total += duration;
+			++known;
+		}
+	}
+	if (known && total >= (int64_t)known)
+		estimate = total / (int64_t)known;
+
+	for (e = ctx->graph.alledges; e; e = e->allnext) {
+		if (e->flags & FLAG_WORK)
+			samu_edgeweight(ctx, e, estimate);
+	}
+
+	samu_edgequeue_heapify(&ctx->build.work);
+}
+
+static int64_t
+samu_buildtime(struct samu_ctx *ctx)
+{
+	return timer_read_ns(&ctx->build.timer) / 1000000;
+}
+
 static size_t
 samu_formatstatus(struct samu_ctx *ctx, char *buf, size_t len)
 {
@@ -256,6 +491,70 @@ samu_printstatus(struct samu_ctx *ctx, struct samu_edge *e, struct samu_string *
 	samu_puts(ctx, description->s);
 }
 
+/*
+ * Split a command into arguments if it can run without a shell, i.e. it is a
+ * plain list of words with no quoting, expansion, redirection or other
+ * shell syntax, and doesn't start with a shell builtin.
+ */
+static bool
+samu_splitcmd(struct samu_ctx *ctx, const struct samu_string *cmd, char ***res)
+{
+	static const char *const builtins[] = {
+		".", ":", "alias", "break", "case", "cd", "command", "continue", "do", "done", "elif", "else", "esac",
+		"eval", "exec", "exit", "export", "fi", "for", "getopts", "hash", "if", "in", "read", "readonly",
+		"return", "set", "shift", "then", "times", "trap", "type", "ulimit", "umask", "unalias", "unset",
+		"until", "wait", "while",
+	};
+	char **argv, *p, *buf;
+	size_t i, argc = 0;
+	bool word = false, first = true;
+
+	for (i = 0; i < cmd->n; ++i) {
+		char c = cmd->s[i];
+		if (c == ' ' || c == '\t') {
+			if (word)
+				first = false;
+			word = false;
+			continue;
+		}
+		if (!(('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || strchr("+,-./:@_%", c))
+			&& !(c == '=' && !first))
+			return false;
+		if (!word)
+			++argc;
+		word = true;
+	}
+	if (!argc)
+		return false;
+
+	if (cmd->n + 1 > ctx->build.cmdbuf.cap) {
+		ctx->build.cmdbuf.cap = cmd->n + 1;
+		ctx->build.cmdbuf.data = z_realloc(ctx->build.cmdbuf.data, ctx->build.cmdbuf.cap);
+	}
+	if (argc + 1 > ctx->build.argvcap) {
+		ctx->build.argvcap = argc + 1;
+		ctx->build.argv = z_realloc(ctx->build.argv, ctx->build.argvcap * sizeof(ctx->build.argv[0]));
+	}
+	buf = memcpy(ctx->build.cmdbuf.data, cmd->s, cmd->n + 1);
+	argv = ctx->build.argv;
+	for (i = 0, p = buf; i < argc; ++i) {
+		p += strspn(p, " \t");
+		argv[i] = p;
+		p += strcspn(p, " \t");
+		if (*p)
+			*p++ = '\0';
+	}
+	argv[argc] = NULL;
+
+	for (i = 0; i < ARRAY_LEN(builtins); ++i) {
+		if (strcmp(argv[0], builtins[i]) == 0)
+			return false;
+	}
+
+	*res = argv;
+	return true;
+}
+
 static bool
 samu_jobstart(struct samu_ctx *ctx, struct samu_job *j, struct samu_edge *e)
 {
@@ -280,6 +579,7 @@ samu_jobstart(struct samu_ctx *ctx, struct samu_job *j, struct samu_edge *e)
 	}
 
 	j->edge = e;
+	j->start = samu_buildtime(ctx);
 	j->cmd = samu_edgevar(ctx, e, "command", true);
 	j->cmd_ctx = (struct run_cmd_ctx){
 		.flags = run_cmd_ctx_flag_async,
@@ -296,7 +596,8 @@ samu_jobstart(struct samu_ctx *ctx, struct samu_job *j, struct samu_edge *e)
 	if (build_machine.is_windows) {
 		cmd_started = run_cmd_unsplit(ctx->wk, &j->cmd_ctx, j->cmd->s, 0, 0);
 	} else {
-		char *argv[] = { "/bin/sh", "-c", j->cmd->s, NULL };
+		char *shargv[] = { "/bin/sh", "-c", j->cmd->s, NULL }, **argv = shargv;
+		samu_splitcmd(ctx, j->cmd, &argv);
 		cmd_started = run_cmd_argv(ctx->wk, &j->cmd_ctx, argv, 0, 0);
 	}
 
@@ -367,9 +668,10 @@ samu_edgedone(struct samu_ctx *ctx, const char **filtered_output, struct samu_jo
 	size_t i;
 	struct samu_string *rspfile;
 	bool restat;
-	int64_t old;
+	int64_t old, end;
 
 	e = j->edge;
+	end = samu_buildtime(ctx);
 
 	restat = samu_edgevar(ctx, e, "restat", true);
 	for (i = 0; i < e->nout; ++i) {
@@ -389,6 +691,8 @@ samu_edgedone(struct samu_ctx *ctx, const char **filtered_output, struct samu_jo
 	for (i = 0; i < e->nout; ++i) {
 		n = e->out[i];
 		n->hash = e->hash;
+		n->logstart = j->start;
+		n->logend = end;
 		samu_logrecord(ctx, n);
 	}
 }
@@ -396,7 +700,7 @@ samu_edgedone(struct samu_ctx *ctx, const char **filtered_output, struct samu_jo
 static void
 samu_jobdone(struct samu_ctx *ctx, struct samu_job *j)
 {
-	struct samu_edge *e, *new;
+	struct samu_edge *e;
 	struct samu_pool *p;
 
 	const char *filtered_output = 0;
@@ -427,15 +731,10 @@ samu_jobdone(struct samu_ctx *ctx, struct samu_job *j)
 
 		if (p == &ctx->consolepool)
 			ctx->build.consoleused = false;
-		/* move edge from pool queue to main work queue */
-		if (p->work) {
-			new = p->work;
-			p->work = p->work->worknext;
-			new->worknext = ctx->build.work;
-			ctx->build.work = new;
-		} else {
-			--p->numjobs;
-		}
+		--p->numjobs;
+		/* move the heaviest edge from pool queue to main work queue */
+		if (p->work.len)
+			samu_edgequeue_push(ctx, &ctx->build.work, samu_edgequeue_pop(&p->work));
 	}
 }
 
@@ -443,7 +742,10 @@ void
 samu_build(struct samu_ctx *ctx)
 {
 	struct samu_job *jobs = NULL;
+	struct run_cmd_ctx **running = NULL;
 	size_t i, next = 0, jobslen = 0, maxjobs = ctx->buildopts.maxjobs, numjobs = 0, numfail = 0;
+	uint32_t numrunning;
+	bool collected;
 	struct samu_edge *e;
 
 	if (ctx->build.ntotal == 0) {
@@ -451,6 +753,7 @@ samu_build(struct samu_ctx *ctx)
 	}
 
 	jobs = samu_xreallocarray(ctx->a, jobs, jobslen, maxjobs, sizeof(jobs[0]));
+	running = samu_xreallocarray(ctx->a, running, 0, maxjobs, sizeof(running[0]));
 	jobslen = maxjobs;
 	for (i = next; i < jobslen; ++i) {
 		jobs[i].next = i + 1;
@@ -458,13 +761,13 @@ samu_build(struct samu_ctx *ctx)
 
 	timer_start(&ctx->build.timer);
 	samu_formatstatus(ctx, NULL, 0);
+	samu_computeweights(ctx);
 
 	ctx->build.nstarted = 0;
 	while (true) {
 		/* start ready edges */
-		while (ctx->build.work && numjobs < maxjobs && numfail < ctx->buildopts.maxfail) {
-			e = ctx->build.work;
-			ctx->build.work = ctx->build.work->worknext;
+		while (ctx->build.work.len && numjobs < maxjobs && numfail < ctx->buildopts.maxfail) {
+			e = samu_edgequeue_pop(&ctx->build.work);
 			if (e->rule != &ctx->phonyrule && ctx->buildopts.dryrun) {
 				++ctx->build.nstarted;
 				samu_printstatus(ctx, e, samu_edgevar(ctx, e, "command", true));
@@ -476,8 +779,19 @@ samu_build(struct samu_ctx *ctx)
 				continue;
 			}
 
+			/* wait for a job of the pool to finish */
+			if (e->pool) {
+				if (e->pool->numjobs == e->pool->maxjobs) {
+					samu_edgequeue_push(ctx, &e->pool->work, e);
+					continue;
+				}
+				++e->pool->numjobs;
+			}
+
 			if (!samu_jobstart(ctx, &jobs[next], e)) {
 				samu_warn("job failed to start");
+				if (e->pool)
+					--e->pool->numjobs;
 				++numfail;
 			} else {
 				jobs[next].running = true;
@@ -488,6 +802,8 @@ samu_build(struct samu_ctx *ctx)
 		if (numjobs == 0)
 			break;
 
+		collected = false;
+		numrunning = 0;
 		for (i = 0; i < jobslen; ++i) {
 			if (!jobs[i].running) {
 				continue;
@@ -495,9 +811,11 @@ samu_build(struct samu_ctx *ctx)
 
 			enum run_cmd_state state = run_cmd_collect(ctx->wk, &jobs[i].cmd_ctx);
 			if (state == run_cmd_running) {
+				running[numrunning++] = &jobs[i].cmd_ctx;
 				continue;
 			}
 
+			collected = true;
 			jobs[i].running = false;
 			if (state == run_cmd_error || jobs[i].cmd_ctx.status != 0) {
 				jobs[i].failed = true;
@@ -512,6 +830,10 @@ samu_build(struct samu_ctx *ctx)
 			if (jobs[i].failed)
 				++numfail;
 		}
+
+		/* nothing finished, sleep until a job produces output or exits */
+		if (!collected)
+			run_cmd_wait_any(ctx->wk, running, numrunning, -1);
 	}
 	if (numfail > 0) {
 		if (numfail < ctx->buildopts.maxfail)
@@ -522,4 +844,13 @@ samu_build(struct samu_ctx *ctx)
 			samu_fatal("subcommand failed");
 	}
 	ctx->build.ntotal = 0; /* reset in case we just rebuilt the manifest */
+
+	/* commands run through the shell are never split */
+	if (ctx->build.cmdbuf.data)
+		z_free(ctx->build.cmdbuf.data);
+	if (ctx->build.argv)
+		z_free(ctx->build.argv);
+	ctx->build.cmdbuf = (struct samu_buffer){ 0 };
+	ctx->build.argv = NULL;
+	ctx->build.argvcap = 0;
 }
@@ -117,25 +117,6 @@ struct seekable_source {
 	uint64_t i;
 };
 
-static size_t
-src_fread(void *buf, size_t sz, size_t n, struct seekable_source *src)
-{
-	if (!sz || !n) {
-		return 0;
-	}
-
-	if (src->i >= src->src.len) {
-		return 0;
-	}
-
-	size_t l = n, r = (src->src.len - src->i) / sz;
-	r = r < l ? r : l;
-
-	memcpy(buf, &src->src.src[src->i], r * sz);
-	src->i += r * sz;
-	return r;
-}
-
 static int
 src_getc(struct seekable_source *src)
 {
@@ -152,18 +133,87 @@ src_getc(struct seekable_source *src)
 	}
 }
 
+/* return the node with the given ID, creating it if it is not in the graph */
+static struct samu_node *
+samu_depsnode(struct samu_ctx *ctx, uint32_t id)
+{
+	struct samu_entry *entry = &ctx->deps.entries[id];
+	struct samu_string *path;
+
+	if (!entry->node) {
+		path = samu_mkstr(ctx->a, entry->pathlen);
+		memcpy(path->s, entry->path, entry->pathlen);
+		path->s[entry->pathlen] = '\0';
+		entry->node = samu_mknode(ctx, path);
+		if (entry->node->id == -1)
+			entry->node->id = id;
+	}
+	return entry->node;
+}
+
+/* read the dependencies of an entry from its record in the mapped deps log */
+static bool
+samu_depsresolve(struct samu_ctx *ctx, struct samu_entry *entry)
+{
+	const uint32_t *record = entry->record;
+	uint32_t sz, id;
+	size_t i;
+
+	if (!record)
+		return true;
+	entry->record = NULL;
+
+	sz = ((record[-1] & 0x7fffffff) - 12) / 4;
+	entry->deps.node = samu_xreallocarray(ctx->a, NULL, 0, sz, sizeof(entry->deps.node[0]));
+	for (i = 0; i < sz; ++i) {
+		id = record[3 + i];
+		if (id >= ctx->deps.entrieslen) {
+			samu_warn("invalid node ID: %" PRIu32, id);
+			entry->mtime = 0;
+			return false;
+		}
+		entry->deps.node[i] = samu_depsnode(ctx, id);
+	}
+	entry->deps.len = sz;
+	return true;
+}
+
+static bool
+samu_depsentries_grow(struct samu_ctx *ctx)
+{
+	if (ctx->deps.entrieslen == INT32_MAX) {
+		samu_warn("too many nodes in deps log");
+		return false;
+	}
+	if (ctx->deps.entrieslen >= ctx->deps.entriescap) {
+		size_t newcap = ctx->deps.entriescap ? ctx->deps.entriescap * 2 : 1024;
+		ctx->deps.entries = samu_xreallocarray(
+			ctx->a, ctx->deps.entries, ctx->deps.entriescap, newcap, sizeof(ctx->deps.entries[0]));
+		ctx->deps.entriescap = newcap;
+	}
+	return true;
+}
+
+/*
+ * The deps log is mapped and only the record headers are read here.  Node
+ * records are matched to nodes in the graph, and each node remembers its
+ * latest dependency record.  Dependencies are read from the mapping when
+ * samu_depsload needs them.
+ *
+ * New records are appended to the log.  The log is only rewritten when it
+ * is invalid, or when most dependency records have been superseded.
+ */
 void
 samu_depsinit(struct samu_ctx *ctx, const char *builddir)
 {
 	char *depspath = (char *)ninja_depsname;
-	uint32_t *buf, cap, ver, sz, id;
-	size_t len, i, j;
-	bool isdep;
-	struct samu_string *path;
+	const char *p, *end;
+	uint32_t ver, sz, id;
+	size_t len, i, j, nrecord = 0, nunique = 0;
+	bool isdep, rewrite = true;
 	struct samu_node *n;
 	struct samu_edge *e;
 	struct samu_entry *entry, *oldentries;
-	struct seekable_source src = { 0 };
 
 	/* XXX: when ninja hits a bad record, it truncates the log to the last
 	 * good record. perhaps we should do the same. */
@@ -172,9 +222,8 @@ samu_depsinit(struct samu_ctx *ctx, const char *builddir)
 		fclose(ctx->deps.depsfile);
 		ctx->deps.depsfile = NULL;
 	}
+	fs_unmap_file(&ctx->deps.map);
 	ctx->deps.entrieslen = 0;
-	cap = BUFSIZ;
-	buf = samu_xmalloc(ctx->a, cap);
 	if (builddir) {
 		samu_xasprintf(ctx->a, &depspath, "%s/%s", builddir, ninja_depsname);
 	}
@@ -182,42 +231,40 @@ samu_depsinit(struct samu_ctx *ctx, const char *builddir)
 		goto rewrite;
 	}
 
-	if (!fs_read_entire_file(ctx->a, depspath, &src.src)) {
+	if (!fs_map_file(depspath, &ctx->deps.map)) {
 		samu_warn("failed to read deps file");
 		goto rewrite;
 	}
+	p = ctx->deps.map.data;
+	end = p + ctx->deps.map.len;
 
-	if (strncmp(src.src.src, ninja_depsheader, strlen(ninja_depsheader)) != 0) {
+	if (ctx->deps.map.len < strlen(ninja_depsheader) + sizeof(ver)
+		|| strncmp(p, ninja_depsheader, strlen(ninja_depsheader)) != 0) {
 		samu_warn("invalid deps log header");
 		goto rewrite;
 	}
-	src.i += strlen(ninja_depsheader);
+	p += strlen(ninja_depsheader);
 
-	if (src_fread(&ver, sizeof(ver), 1, &src) != 1) {
-		samu_warn("deps log truncated");
-		goto rewrite;
-	}
+	memcpy(&ver, p, sizeof(ver));
+	p += sizeof(ver);
 	if (ver != ninja_depsver) {
 		samu_warn("unknown deps log version");
 		goto rewrite;
 	}
-	while (true) {
-		if (src_fread(&sz, sizeof(sz), 1, &src) != 1) {
-			break;
+	while (p < end) {
+		if ((size_t)(end - p) < sizeof(sz)) {
+			samu_warn("deps log truncated");
+			goto rewrite;
 		}
+		memcpy(&sz, p, sizeof(sz));
+		p += sizeof(sz);
 		isdep = sz & 0x80000000;
 		sz &= 0x7fffffff;
 		if (sz > SAMU_MAX_RECORD_SIZE) {
 			samu_warn("deps record too large");
 			goto rewrite;
 		}
-		if (sz > cap) {
-			do {
-				cap *= 2;
-			} while (sz > cap);
-			buf = samu_xmalloc(ctx->a, cap);
-		}
-		if (src_fread(buf, sz, 1, &src) != 1) {
+		if ((size_t)(end - p) < sz) {
 			samu_warn("deps log truncated");
 			goto rewrite;
 		}
@@ -225,34 +272,25 @@ samu_depsinit(struct samu_ctx *ctx, const char *builddir)
 			samu_warn("invalid size, must be multiple of 4: %" PRIu32, sz);
 			goto rewrite;
 		}
+		/* records are 4-byte aligned since the header and all sizes are */
+		const uint32_t *buf = (const uint32_t *)p;
+		p += sz;
 		if (isdep) {
 			if (sz < 12) {
 				samu_warn("invalid size, must be at least 12: %" PRIu32, sz);
 				goto rewrite;
 			}
-			sz -= 12;
 			id = buf[0];
 			if (id >= ctx->deps.entrieslen) {
 				samu_warn("invalid node ID: %" PRIu32, id);
 				goto rewrite;
 			}
 			entry = &ctx->deps.entries[id];
+			if (!entry->record)
+				++nunique;
+			++nrecord;
+			entry->record = buf;
 			entry->mtime = (int64_t)buf[2] << 32 | buf[1];
-			e = entry->node->gen;
-			if (!e || !samu_edgevar(ctx, e, "deps", true)) {
-				continue;
-			}
-			sz /= 4;
-			entry->deps.len = sz;
-			entry->deps.node = samu_xreallocarray(ctx->a, NULL, 0, sz, sizeof(n));
-			for (i = 0; i < sz; ++i) {
-				id = buf[3 + i];
-				if (id >= ctx->deps.entrieslen) {
-					samu_warn("invalid node ID: %" PRIu32, id);
-					goto rewrite;
-				}
-				entry->deps.node[i] = ctx->deps.entries[id].node;
-			}
 		} else {
 			if (sz <= 4) {
 				samu_warn("invalid size, must be greater than 4: %" PRIu32, sz);
@@ -262,39 +300,56 @@ samu_depsinit(struct samu_ctx *ctx, const char *builddir)
 				samu_warn("corrupt deps log, bad checksum");
 				goto rewrite;
 			}
-			if (ctx->deps.entrieslen == INT32_MAX) {
-				samu_warn("too many nodes in deps log");
+			if (!samu_depsentries_grow(ctx)) {
 				goto rewrite;
 			}
 			len = sz - 4;
-			while (((char *)buf)[len - 1] == '\0') {
+			while (len && ((const char *)buf)[len - 1] == '\0') {
 				--len;
 			}
-			path = samu_mkstr(ctx->a, len);
-			memcpy(path->s, buf, len);
-			path->s[len] = '\0';
-
-			n = samu_mknode(ctx, path);
-			if (ctx->deps.entrieslen >= ctx->deps.entriescap) {
-				size_t newcap = ctx->deps.entriescap ? ctx->deps.entriescap * 2 : 1024;
-				ctx->deps.entries = samu_xreallocarray(ctx->a,
-					ctx->deps.entries,
-					ctx->deps.entriescap,
-					newcap,
-					sizeof(ctx->deps.entries[0]));
-				ctx->deps.entriescap = newcap;
+			if (!len) {
+				samu_warn("corrupt deps log, empty path");
+				goto rewrite;
 			}
-			n->id = ctx->deps.entrieslen;
-			ctx->deps.entries[ctx->deps.entrieslen++] = (struct samu_entry){ .node = n };
+
+			n = samu_nodeget(ctx, (const char *)buf, len);
+			if (n) {
+				n->id = ctx->deps.entrieslen;
+			}
+			ctx->deps.entries[ctx->deps.entrieslen++] = (struct samu_entry){
+				.node = n,
+				.path = (const char *)buf,
+				.pathlen = len,
+			};
 		}
 	}
 
+	if (nrecord <= 1000 || nrecord <= 3 * nunique) {
+		rewrite = false;
+	}
+
 rewrite:
-	if (ctx->deps.depsfile) {
-		fclose(ctx->deps.depsfile);
-		ctx->deps.depsfile = NULL;
+	if (!rewrite) {
+		ctx->deps.depsfile = fs_fopen(depspath, "ab");
+		if (!ctx->deps.depsfile) {
+			samu_fatal("open %s:", depspath);
+		}
+		return;
+	}
+
+	/* read the dependencies of all outputs whose deps are kept before the
+	 * mapping goes away */
+	for (i = 0; i < ctx->deps.entrieslen; ++i) {
+		entry = &ctx->deps.entries[i];
+		e = entry->node ? entry->node->gen : NULL;
+		if (!e || !samu_edgevar(ctx, e, "deps", true) || !samu_depsresolve(ctx, entry)) {
+			entry->record = NULL;
+			entry->deps.len = 0;
+		}
 	}
-	ctx->deps.depsfile = fopen(depspath, "wb");
+	fs_unmap_file(&ctx->deps.map);
+
+	ctx->deps.depsfile = fs_fopen(depspath, "wb");
 	if (!ctx->deps.depsfile) {
 		samu_fatal("open %s:", depspath);
 	}
@@ -303,7 +358,8 @@ rewrite:
 
 	/* reset ID for all current entries */
 	for (i = 0; i < ctx->deps.entrieslen; ++i) {
-		ctx->deps.entries[i].node->id = -1;
+		if (ctx->deps.entries[i].node)
+			ctx->deps.entries[i].node->id = -1;
 	}
 	/* save a temporary copy of the old entries */
 	oldentries = samu_xreallocarray(ctx->a, NULL, 0, ctx->deps.entrieslen, sizeof(ctx->deps.entries[0]));
@@ -317,9 +373,15 @@ rewrite:
 			continue;
 		}
 		samu_recordid(ctx, entry->node);
-		ctx->deps.entries[entry->node->id] = *entry;
+		ctx->deps.entries[entry->node->id] = (struct samu_entry){
+			.node = entry->node,
+			.deps = entry->deps,
+			.mtime = entry->mtime,
+		};
 		for (j = 0; j < entry->deps.len; ++j) {
-			samu_recordid(ctx, entry->deps.node[j]);
+			n = entry->deps.node[j];
+			if (samu_recordid(ctx, n))
+				ctx->deps.entries[n->id] = (struct samu_entry){ .node = n };
 		}
 		samu_recorddeps(ctx, entry->node, &entry->deps, entry->mtime);
 	}
@@ -338,6 +400,7 @@ samu_depsclose(struct samu_ctx *ctx)
 	}
 	fclose(ctx->deps.depsfile);
 	ctx->deps.depsfile = NULL;
+	fs_unmap_file(&ctx->deps.map);
 }
 
 static void
@@ -577,6 +640,22 @@ cont:
 	return &ctx->deps.deps;
 }
 
+/* return the dependencies recorded for the edge's output, if they are up to date */
+struct samu_nodearray *
+samu_depslogged(struct samu_ctx *ctx, struct samu_edge *e)
+{
+	struct samu_node *n;
+	struct samu_entry *entry;
+
+	n = e->out[0];
+	if (n->id == -1)
+		return NULL;
+	entry = &ctx->deps.entries[n->id];
+	if (n->mtime > entry->mtime || !samu_depsresolve(ctx, entry))
+		return NULL;
+	return &entry->deps;
+}
+
 void
 samu_depsload(struct samu_ctx *ctx, struct samu_edge *e)
 {
@@ -591,9 +670,8 @@ samu_depsload(struct samu_ctx *ctx, struct samu_edge *e)
 	n = e->out[0];
 	deptype = samu_edgevar(ctx, e, "deps", true);
 	if (deptype) {
-		if (n->id != -1 && n->mtime <= ctx->deps.entries[n->id].mtime) {
-			deps = &ctx->deps.entries[n->id].deps;
-		} else if (ctx->buildopts.explain) {
+		deps = samu_depslogged(ctx, e);
+		if (!deps && ctx->buildopts.explain) {
 			samu_warn("explain %s: missing or outdated record in .ninja_deps", n->path->s);
 		}
 	} else {
@@ -673,6 +751,7 @@ samu_depsrecord(struct samu_ctx *ctx, struct tstr *output, const char **filtered
 		update = true;
 	} else {
 		entry = &ctx->deps.entries[out->id];
+		samu_depsresolve(ctx, entry);
 		if (entry->mtime != out->mtime || entry->deps.len != deps->len) {
 			update = true;
 		}
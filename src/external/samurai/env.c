@@ -239,7 +239,7 @@ samu_mkpool(struct samu_ctx *ctx, char *name)
 	p->name = name;
 	p->numjobs = 0;
 	p->maxjobs = 0;
-	p->work = NULL;
+	p->work = (struct samu_edgequeue){ 0 };
 	samu_addpool(ctx, p);
 
 	return p;
@@ -52,6 +52,8 @@ samu_mknode(struct samu_ctx *ctx, struct samu_string *path)
 	n->nuse = 0;
 	n->mtime = SAMU_MTIME_UNKNOWN;
 	n->logmtime = SAMU_MTIME_MISSING;
+	n->logstart = 0;
+	n->logend = 0;
 	n->hash = 0;
 	n->id = -1;
 	*v = n;
@@ -11,7 +11,7 @@
 #include <string.h>
 
 #include "external/samurai/ctx.h"
-#include "formats/lines.h"
+#include "platform/filesystem.h"
 
 #include "external/samurai/graph.h"
 #include "external/samurai/log.h"
@@ -21,6 +21,13 @@ static const char *samu_logname = ".ninja_log";
 static const char *samu_log_version_fmt = "# ninja log v%d\n";
 static const int samu_logver = 6;
 
+enum {
+	/* rewrite the log if it has more than samu_log_compact_ratio entries
+	 * for each live one, unless it is tiny */
+	samu_log_compact_min_entries = 100,
+	samu_log_compact_ratio = 3,
+};
+
 enum samu_log_field {
 	samu_log_field_start_time,
 	samu_log_field_end_time,
@@ -34,47 +41,93 @@ struct samu_log_parse_ctx {
 	uint32_t line_no;
 	size_t nentry;
 	struct samu_ctx *samu_ctx;
+	/* whether the log can't be appended to and must be rewritten */
+	bool rewrite;
 };
 
-static enum iteration_result
-samu_log_parse_cb(void *_ctx, char *line, size_t len)
+/* parse a number that makes up all of s, which need not be NUL terminated */
+static bool
+samu_log_parse_num(const char *s, size_t len, uint32_t base, uint64_t *res)
 {
-	struct samu_log_parse_ctx *ctx = _ctx;
-	char *fields[samu_log_field_count] = { 0 };
-	struct samu_node *n;
+	uint64_t v = 0;
+	uint32_t d;
+	size_t i;
+	bool neg = false;
+
+	if (len && s[0] == '-') {
+		neg = true;
+		++s;
+		--len;
+	}
 
-	if (ctx->line_no == 1) {
-		int ver;
-		if (sscanf(line, samu_log_version_fmt, &ver) < 1 || ver != samu_logver) {
-			return ir_done;
+	if (!len) {
+		return false;
+	}
+
+	for (i = 0; i < len; ++i) {
+		if ('0' <= s[i] && s[i] <= '9') {
+			d = s[i] - '0';
+		} else if (base == 16 && 'a' <= s[i] && s[i] <= 'f') {
+			d = s[i] - 'a' + 10;
+		} else if (base == 16 && 'A' <= s[i] && s[i] <= 'F') {
+			d = s[i] - 'A' + 10;
+		} else {
+			return false;
 		}
 
-		goto cont;
+		v = v * base + d;
+	}
+
+	*res = neg ? -v : v;
+	return true;
+}
+
+static bool
+samu_log_parse_int(const char *s, size_t len, int64_t *res)
+{
+	uint64_t v;
+	if (!samu_log_parse_num(s, len, 10, &v)) {
+		return false;
 	}
 
+	*res = (int64_t)v;
+	return true;
+}
+
+static void
+samu_log_parse_line(struct samu_log_parse_ctx *ctx, const char *line, size_t len)
+{
+	struct {
+		const char *s;
+		size_t len;
+	} fields[samu_log_field_count] = { 0 };
+	struct samu_node *n;
+	uint32_t i, nfields = 0;
+
 	{
-		char *p = line;
-		uint32_t i;
+		const char *p = line, *end = line + len, *tab;
 		for (i = 0; i < samu_log_field_count; ++i) {
-			fields[i] = p;
-			if (!(p = strchr(p, '\t'))) {
+			tab = memchr(p, '\t', end - p);
+			fields[i].s = p;
+			fields[i].len = (tab ? tab : end) - p;
+			++nfields;
+
+			if (!tab) {
 				break;
 			}
-
-			*p = 0;
-			++p;
+			p = tab + 1;
 		}
 	}
 
 	{ // get node
-		if (!fields[samu_log_field_output_path]) {
+		if (nfields <= samu_log_field_output_path || !fields[samu_log_field_output_path].len) {
 			samu_warn("missing output path");
 			goto corrupt_line;
 		}
 
-		n = samu_nodeget(ctx->samu_ctx, fields[samu_log_field_output_path], 0);
+		n = samu_nodeget(ctx->samu_ctx, fields[samu_log_field_output_path].s, fields[samu_log_field_output_path].len);
 		if (!n || !n->gen) {
-			goto cont;
+			return;
 		}
 		if (n->logmtime == SAMU_MTIME_MISSING) {
 			++ctx->nentry;
@@ -82,43 +135,73 @@ samu_log_parse_cb(void *_ctx, char *line, size_t len)
 	}
 
 	{ // get mtime
-		if (!fields[samu_log_field_mtime]) {
-			samu_warn("missing mtime");
+		if (!samu_log_parse_int(fields[samu_log_field_mtime].s, fields[samu_log_field_mtime].len, &n->logmtime)) {
+			samu_warn("invalid mtime: %.*s", (int)fields[samu_log_field_mtime].len, fields[samu_log_field_mtime].s);
 			goto corrupt_line;
 		}
+	}
 
-		char *endptr;
-		n->logmtime = strtoll(fields[samu_log_field_mtime], &endptr, 10);
-		if (*endptr) {
-			samu_warn("invalid mtime: %s", fields[samu_log_field_mtime]);
+	{ // get start and end time
+		if (!samu_log_parse_int(
+			    fields[samu_log_field_start_time].s, fields[samu_log_field_start_time].len, &n->logstart)
+			|| !samu_log_parse_int(
+				fields[samu_log_field_end_time].s, fields[samu_log_field_end_time].len, &n->logend)) {
+			samu_warn("invalid start or end time");
 			goto corrupt_line;
 		}
 	}
 
 	{ // get output hash
-		if (!fields[samu_log_field_command_hash]) {
-			samu_warn("missing command hash");
-			goto corrupt_line;
-		}
-
-		char *endptr;
-		n->hash = strtoull(fields[samu_log_field_command_hash], &endptr, 16);
-		if (*endptr) {
+		if (nfields <= samu_log_field_command_hash
+			|| !samu_log_parse_num(
+				fields[samu_log_field_command_hash].s, fields[samu_log_field_command_hash].len, 16, &n->hash)) {
 			samu_warn("invalid hash for '%s'", n->path->s);
 			goto corrupt_line;
 		}
 	}
 
-cont:
-	++ctx->line_no;
-	return ir_cont;
+	return;
 corrupt_line:
 	samu_warn("corrupt build log @ line %d", ctx->line_no);
-	goto cont;
+	ctx->rewrite = true;
+}
+
+static void
+samu_log_parse(struct samu_log_parse_ctx *ctx, const char *buf, size_t len)
+{
+	const char *line = buf, *end = buf + len, *nl;
+
+	for (; line < end; line = nl + 1, ++ctx->line_no) {
+		if (!(nl = memchr(line, '\n', end - line))) {
+			/* an incomplete last line, e.g. from an interrupted build,
+			 * which would corrupt the next entry appended to the log */
+			ctx->rewrite = true;
+			return;
+		}
+
+		if (ctx->line_no == 1) {
+			char header[32];
+			int ver;
+			size_t header_len = nl - line < (ptrdiff_t)sizeof(header) ? (size_t)(nl - line) : sizeof(header) - 1;
+			memcpy(header, line, header_len);
+			header[header_len] = 0;
+			if (sscanf(header, samu_log_version_fmt, &ver) < 1 || ver != samu_logver) {
+				ctx->rewrite = true;
+				return;
+			}
+			continue;
+		}
+
+		samu_log_parse_line(ctx, line, nl - line);
+	}
+
+	if (ctx->line_no == 1) {
+		ctx->rewrite = true;
+	}
 }
 
 static void
-samu_log_open_and_write(struct samu_ctx *ctx, const char *builddir, bool write_graph)
+samu_log_open_and_write(struct samu_ctx *ctx, const char *builddir, bool append)
 {
 	const struct samu_edge *e;
 	struct samu_node *n;
@@ -133,22 +216,24 @@ samu_log_open_and_write(struct samu_ctx *ctx, const char *builddir, bool write_g
 		logpath = samu_logname;
 	}
 
-	if (!(ctx->log.logfile = fs_fopen(logpath, "wb"))) {
+	if (!(ctx->log.logfile = fs_fopen(logpath, append ? "ab" : "wb"))) {
 		samu_fatal("open %s", logpath);
 		return;
 	}
 
+	if (append) {
+		return;
+	}
+
 	fprintf(ctx->log.logfile, samu_log_version_fmt, samu_logver);
 
-	if (write_graph) {
-		for (e = ctx->graph.alledges; e; e = e->allnext) {
-			for (i = 0; i < e->nout; ++i) {
-				n = e->out[i];
-				if (!n->hash) {
-					continue;
-				}
-				samu_logrecord(ctx, n);
+	for (e = ctx->graph.alledges; e; e = e->allnext) {
+		for (i = 0; i < e->nout; ++i) {
+			n = e->out[i];
+			if (!n->hash) {
+				continue;
 			}
+			samu_logrecord(ctx, n);
 		}
 	}
 }
@@ -171,8 +256,8 @@ samu_loginit(struct samu_ctx *ctx, const char *builddir)
 		return;
 	}
 
-	struct source src = { 0 };
-	if (!fs_read_entire_file(ctx->a, logpath, &src)) {
+	struct fs_mapped_file map;
+	if (!fs_map_file(logpath, &map)) {
 		samu_fatal("failed to read log file at %s", logpath);
 	}
 
@@ -181,13 +266,18 @@ samu_loginit(struct samu_ctx *ctx, const char *builddir)
 		.samu_ctx = ctx,
 	};
 
-	each_line((char *)src.src, src.len, &samu_log_parse_ctx, samu_log_parse_cb);
+	samu_log_parse(&samu_log_parse_ctx, map.data, map.len);
+	fs_unmap_file(&map);
 
-	/* if (samu_log_parse_ctx.line_no <= 100 || samu_log_parse_ctx.line_no <= 3 * samu_log_parse_ctx.nentry) { */
-	/* 	return; */
-	/* } */
+	/* Entries are appended for every command that runs, so the log keeps
+	 * growing with stale entries for outputs that were rebuilt or no longer
+	 * exist.  Only rewrite it once most of it is stale. */
+	uint32_t nline = samu_log_parse_ctx.line_no - 1;
+	bool append = !samu_log_parse_ctx.rewrite
+		      && (nline <= samu_log_compact_min_entries
+			      || nline <= samu_log_compact_ratio * samu_log_parse_ctx.nentry);
 
-	samu_log_open_and_write(ctx, builddir, true);
+	samu_log_open_and_write(ctx, builddir, append);
 }
 
 void
@@ -200,5 +290,11 @@ samu_logclose(struct samu_ctx *ctx)
 void
 samu_logrecord(struct samu_ctx *ctx, struct samu_node *n)
 {
-	fprintf(ctx->log.logfile, "0\t0\t%" PRId64 "\t%s\t%" PRIx64 "\n", n->logmtime, n->path->s, n->hash);
+	fprintf(ctx->log.logfile,
+		"%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%s\t%" PRIx64 "\n",
+		n->logstart,
+		n->logend,
+		n->logmtime,
+		n->path->s,
+		n->hash);
 }
@@ -148,7 +148,7 @@ samu_main(struct workspace *wk, int argc, char *argv[], struct samu_opts *opts)
 	const struct samu_tool *tool = NULL;
 	struct samu_node *n;
 	long num;
-	int tries;
+	int tries, i;
 
 	struct samu_ctx _ctx, *ctx = &_ctx;
 	samu_init_ctx(wk, ctx, opts);
@@ -252,13 +252,18 @@ retry:
 
 	/* finally, build any specified targets or the default targets */
 	if (argc) {
-		for (; *argv; ++argv) {
-			n = samu_nodeget(ctx, *argv, 0);
+		for (i = 0; i < argc; ++i) {
+			n = samu_nodeget(ctx, argv[i], 0);
 			if (!n)
-				samu_fatal("unknown target '%s'", *argv);
-			samu_buildadd(ctx, n);
+				samu_fatal("unknown target '%s'", argv[i]);
+			samu_buildstat(ctx, n);
 		}
+		samu_buildstatall(ctx);
+		for (i = 0; i < argc; ++i)
+			samu_buildadd(ctx, samu_nodeget(ctx, argv[i], 0));
 	} else {
+		samu_defaultnodes(ctx, samu_buildstat);
+		samu_buildstatall(ctx);
 		samu_defaultnodes(ctx, samu_buildadd);
 	}
 	samu_build(ctx);
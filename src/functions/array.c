@@ -17,8 +17,7 @@ FUNC_IMPL(array, length, tc_number)
 		return false;
 	}
 
-	*res = make_obj(wk, obj_number);
-	set_obj_number(wk, *res, get_obj_array(wk, self)->len);
+	*res = make_number(wk, get_obj_array(wk, self)->len);
 	return true;
 }
 
@@ -45,31 +44,6 @@ FUNC_IMPL(array, get, tc_any)
 	return true;
 }
 
-struct array_contains_ctx {
-	obj item;
-	bool found;
-};
-
-static enum iteration_result
-array_contains_iter(struct workspace *wk, void *_ctx, obj val)
-{
-	struct array_contains_ctx *ctx = _ctx;
-
-	if (get_obj_type(wk, val) == obj_array) {
-		obj_array_foreach(wk, val, ctx, array_contains_iter);
-		if (ctx->found) {
-			return ir_done;
-		}
-	}
-
-	if (obj_equal(wk, val, ctx->item)) {
-		ctx->found = true;
-		return ir_done;
-	}
-
-	return ir_cont;
-}
-
 FUNC_IMPL(array, contains, tc_bool)
 {
 	struct args_norm an[] = { { tc_any }, ARG_TYPE_NULL };
@@ -77,10 +51,7 @@ FUNC_IMPL(array, contains, tc_bool)
 		return false;
 	}
 
-	struct array_contains_ctx ctx = { .item = an[0].val };
-	obj_array_foreach(wk, self, &ctx, array_contains_iter);
-
-	*res = make_obj_bool(wk, ctx.found);
+	*res = make_obj_bool(wk, obj_array_in_flat(wk, self, an[0].val));
 	return true;
 }
 
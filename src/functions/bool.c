@@ -33,8 +33,7 @@ FUNC_IMPL(bool, to_int, tc_number)
 	}
 
 	int32_t val = get_obj_bool(wk, self) ? 1 : 0;
-	*res = make_obj(wk, obj_number);
-	set_obj_number(wk, *res, val);
+	*res = make_number(wk, val);
 	return true;
 }
 
@@ -30,9 +30,12 @@
 #include "options.h"
 #include "platform/assert.h"
 #include "platform/filesystem.h"
+#include "platform/os.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
 #include "toolchains.h"
+#include "tracy.h"
+#include "util.h"
 
 MUON_ATTR_FORMAT(printf, 3, 4)
 static void
@@ -95,24 +98,32 @@ add_include_directory_args(struct workspace *wk,
 	return true;
 }
 
-bool
-compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const char *src, uint32_t err_node, bool *res)
-{
-	enum requirement_type req = requirement_auto;
-	if (opts->required && opts->required->set) {
-		if (!coerce_requirement(wk, opts->required, &req)) {
-			return false;
-		}
-	}
-
-	if (req == requirement_skip) {
-		*res = false;
-		return true;
-	}
+struct compiler_check_cmd {
+	obj source_path;
+	const char *output_path;
+	const char *argstr;
+	uint32_t argc;
+	struct build_dep dep;
+	bool have_dep;
+};
 
+/*
+ * Builds the command line for a compiler check.  If slot is negative the
+ * shared scratch paths test.<ext> are used, otherwise the paths are suffixed
+ * with the slot number so that multiple checks may run concurrently.
+ */
+static bool
+compiler_check_setup_cmd(struct workspace *wk,
+	struct compiler_check_opts *opts,
+	const char *src,
+	int32_t slot,
+	struct compiler_check_cmd *cmd)
+{
 	obj comp = opts->comp_id;
 	struct obj_compiler *compiler = get_obj_compiler(wk, comp);
 
+	*cmd = (struct compiler_check_cmd){ 0 };
+
 	// Set up compiler arguments
 
 	obj compiler_args;
@@ -144,30 +155,32 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const cha
 		break;
 	}
 
-	bool have_dep = false;
-	struct build_dep dep = { 0 };
 	if (opts->deps && opts->deps->set) {
-		have_dep = true;
-		dep_process_deps(wk, opts->deps->val, &dep);
+		cmd->have_dep = true;
+		dep_process_deps(wk, opts->deps->val, &cmd->dep);
 
-		obj_array_extend_nodup(wk, compiler_args, dep.compile_args);
+		obj_array_extend_nodup(wk, compiler_args, cmd->dep.compile_args);
 	}
 
-	if (!add_include_directory_args(wk, opts->inc, have_dep ? &dep : NULL, opts->comp_id, compiler_args)) {
+	if (!add_include_directory_args(wk, opts->inc, cmd->have_dep ? &cmd->dep : NULL, opts->comp_id, compiler_args)) {
 		return false;
 	}
 
-	obj source_path;
+	TSTR(scratch_base);
+	path_join(wk, &scratch_base, wk->muon_private, "test");
+	if (slot >= 0) {
+		tstr_pushf(wk, &scratch_base, "_%d", slot);
+	}
+	tstr_push(wk, &scratch_base, '.');
+	tstr_pushs(wk, &scratch_base, compiler_language_extension(compiler->lang));
+
 	if (opts->src_is_path) {
-		source_path = make_str(wk, src);
+		cmd->source_path = make_str(wk, src);
 	} else {
-		TSTR(test_source_path);
-		path_join(wk, &test_source_path, wk->muon_private, "test.");
-		tstr_pushs(wk, &test_source_path, compiler_language_extension(compiler->lang));
-		source_path = tstr_into_str(wk, &test_source_path);
+		cmd->source_path = make_strn(wk, scratch_base.buf, scratch_base.len);
 	}
 
-	obj_array_push(wk, compiler_args, source_path);
+	obj_array_push(wk, compiler_args, cmd->source_path);
 
 	if (opts->mode == compiler_check_mode_preprocess) {
 		obj_array_extend(wk, compiler_args, toolchain_compiler_preprocess_only(wk, comp));
@@ -175,30 +188,27 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const cha
 		obj_array_extend(wk, compiler_args, toolchain_compiler_compile_only(wk, comp));
 	}
 
-	TSTR(test_output_path);
-	const char *output_path = 0;
 	if (!opts->output_is_stdout) {
 		if (opts->output_path) {
-			output_path = opts->output_path;
+			cmd->output_path = opts->output_path;
 		} else if (opts->mode == compiler_check_mode_run) {
+			TSTR(test_output_path);
 			path_join(wk, &test_output_path, wk->muon_private, "compiler_check_exe");
 			if (machine_definitions[compiler->machine]->is_windows) {
 				tstr_pushs(wk, &test_output_path, ".exe");
 			}
-			output_path = test_output_path.buf;
+			cmd->output_path = get_cstr(wk, tstr_into_str(wk, &test_output_path));
 		} else {
-			path_join(wk, &test_output_path, wk->muon_private, "test.");
-			tstr_pushs(wk, &test_output_path, compiler_language_extension(compiler->lang));
 			const char *ext
 				= toolchain_compiler_flatten_one(wk, comp, toolchain_compiler_object_ext(wk, comp));
 			if (!ext) {
 				return false;
 			}
-			tstr_pushs(wk, &test_output_path, ext);
-			output_path = test_output_path.buf;
+			tstr_pushs(wk, &scratch_base, ext);
+			cmd->output_path = get_cstr(wk, tstr_into_str(wk, &scratch_base));
 		}
 
-		obj_array_extend(wk, compiler_args, toolchain_compiler_output(wk, comp, output_path));
+		obj_array_extend(wk, compiler_args, toolchain_compiler_output(wk, comp, cmd->output_path));
 	}
 
 	// Set up linker arguments
@@ -209,12 +219,12 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const cha
 			compiler_args,
 			toolchain_compiler_linker_passthrough(wk, comp, toolchain_linker_fatal_warnings(wk, comp)));
 
-		if (have_dep) {
+		if (cmd->have_dep) {
 			struct obj_build_target tgt = {
-				.dep_internal = dep,
+				.dep_internal = cmd->dep,
 			};
 			ca_prepare_target_linker_args(wk, comp, 0, &tgt, false);
-			obj_array_extend_nodup(wk, compiler_args, dep.link_args);
+			obj_array_extend_nodup(wk, compiler_args, cmd->dep.link_args);
 		}
 	}
 
@@ -225,19 +235,24 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const cha
 		obj_array_extend(wk, compiler_args, opts->args);
 	}
 
-	bool ret = false;
-	struct run_cmd_ctx cmd_ctx = { 0 };
-
-	const char *argstr;
-	uint32_t argc;
-	join_args_argstr(wk, &argstr, &argc, compiler_args);
+	join_args_argstr(wk, &cmd->argstr, &cmd->argc, compiler_args);
+	return true;
+}
 
+static bool
+compiler_check_cache_lookup(struct workspace *wk,
+	struct compiler_check_opts *opts,
+	const struct compiler_check_cmd *cmd,
+	const char *src,
+	bool *res)
+{
 	opts->cache_key = compiler_check_cache_key(wk,
 		&(struct compiler_check_cache_key){
-			.comp = compiler,
-			.argstr = argstr,
-			.argc = argc,
+			.comp = get_obj_compiler(wk, opts->comp_id),
+			.argstr = cmd->argstr,
+			.argc = cmd->argc,
 			.src = src,
+			.src_is_path = opts->src_is_path,
 		});
 
 	struct compiler_check_cache_value cache_value = { 0 };
@@ -249,33 +264,88 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const cha
 		return true;
 	}
 
+	return false;
+}
+
+static bool
+compiler_check_write_source(struct workspace *wk,
+	struct compiler_check_opts *opts,
+	const struct compiler_check_cmd *cmd,
+	const char *src)
+{
 	if (!opts->src_is_path) {
 		L("compiling: '%s'", src);
 
-		if (!fs_write_entire_file(get_cstr(wk, source_path), (const uint8_t *)src, strlen(src))) {
+		if (!fs_write_entire_file(get_cstr(wk, cmd->source_path), (const uint8_t *)src, strlen(src))) {
 			return false;
 		}
 	} else {
-		L("compiling: '%s'", get_cstr(wk, source_path));
+		L("compiling: '%s'", get_cstr(wk, cmd->source_path));
 	}
 
-	if (!run_cmd(wk, &cmd_ctx, argstr, argc, NULL, 0)) {
-		vm_error_at(wk, err_node, "error: %s", cmd_ctx.err_msg);
-		goto ret;
+	return true;
+}
+
+static void
+compiler_check_log_output(struct compiler_check_opts *opts, struct run_cmd_ctx *cmd_ctx)
+{
+	if (opts->dont_log_compiler_output) {
+		return;
 	}
 
-	if (!opts->dont_log_compiler_output) {
-		const uint32_t truncate_limit = BUF_SIZE_4k;
-		const struct str truncated_sep = STR("'\n" CLR(c_cyan) "[truncated]" CLR(0) "\n'");
-		LL("compiler stdout: '");
-		log_print_middle_truncated(log_debug, &TSTR_STR(&cmd_ctx.out), &truncated_sep, truncate_limit);
-		log_printn(log_debug, "'\n", 2);
+	const uint32_t truncate_limit = BUF_SIZE_4k;
+	const struct str truncated_sep = STR("'\n" CLR(c_cyan) "[truncated]" CLR(0) "\n'");
+	LL("compiler stdout: '");
+	log_print_middle_truncated(log_debug, &TSTR_STR(&cmd_ctx->out), &truncated_sep, truncate_limit);
+	log_printn(log_debug, "'\n", 2);
+
+	LL("compiler stderr: '");
+	log_print_middle_truncated(log_debug, &TSTR_STR(&cmd_ctx->err), &truncated_sep, truncate_limit);
+	log_printn(log_debug, "'\n", 2);
+}
+
+bool
+compiler_check(struct workspace *wk, struct compiler_check_opts *opts, const char *src, uint32_t err_node, bool *res)
+{
+	enum requirement_type req = requirement_auto;
+	if (opts->required && opts->required->set) {
+		if (!coerce_requirement(wk, opts->required, &req)) {
+			return false;
+		}
+	}
 
-		LL("compiler stderr: '");
-		log_print_middle_truncated(log_debug, &TSTR_STR(&cmd_ctx.err), &truncated_sep, truncate_limit);
-		log_printn(log_debug, "'\n", 2);
+	if (req == requirement_skip) {
+		*res = false;
+		return true;
+	}
+
+	struct obj_compiler *compiler = get_obj_compiler(wk, opts->comp_id);
+
+	struct compiler_check_cmd cmd;
+	if (!compiler_check_setup_cmd(wk, opts, src, -1, &cmd)) {
+		return false;
+	}
+
+	const char *output_path = cmd.output_path;
+
+	bool ret = false;
+	struct run_cmd_ctx cmd_ctx = { 0 };
+
+	if (compiler_check_cache_lookup(wk, opts, &cmd, src, res)) {
+		return true;
+	}
+
+	if (!compiler_check_write_source(wk, opts, &cmd, src)) {
+		return false;
+	}
+
+	if (!run_cmd(wk, &cmd_ctx, cmd.argstr, cmd.argc, NULL, 0)) {
+		vm_error_at(wk, err_node, "error: %s", cmd_ctx.err_msg);
+		goto ret;
 	}
 
+	compiler_check_log_output(opts, &cmd_ctx);
+
 	if (opts->mode == compiler_check_mode_run) {
 		if (cmd_ctx.status != 0) {
 			if (opts->skip_run_check) {
@@ -343,6 +413,219 @@ ret:
 	return ret;
 }
 
+/*
+ * Batched compiler checks.  Every element is checked as if by
+ * compiler_check(), but cache misses are fanned out across parallel jobs,
+ * each using its own scratch source and output paths.  Results are stored
+ * back in each element so callers can process them in order.  Only compile
+ * and link checks without a required keyword may be batched.
+ *
+ * With stop_on_failure, no further elements are started once an element
+ * fails, and only the elements before the first failure are guaranteed to
+ * have a result.
+ */
+struct compiler_check_batch_elem {
+	struct compiler_check_opts opts;
+	const char *src;
+	obj arg; // not used by the batch, available to the caller
+	bool res;
+};
+
+struct compiler_check_batch_job {
+	struct run_cmd_ctx cmd_ctx;
+	struct compiler_check_batch_elem *elem;
+	bool busy;
+};
+
+static bool
+compiler_check_batch_start(struct workspace *wk,
+	struct compiler_check_batch_job *job,
+	int32_t slot,
+	struct compiler_check_batch_elem *elem,
+	uint32_t err_node)
+{
+	struct compiler_check_cmd cmd;
+	if (!compiler_check_setup_cmd(wk, &elem->opts, elem->src, slot, &cmd)) {
+		return false;
+	} else if (!compiler_check_write_source(wk, &elem->opts, &cmd, elem->src)) {
+		return false;
+	}
+
+	*job = (struct compiler_check_batch_job){
+		.cmd_ctx = { .flags = run_cmd_ctx_flag_async },
+		.elem = elem,
+	};
+
+	if (!run_cmd(wk, &job->cmd_ctx, cmd.argstr, cmd.argc, NULL, 0)) {
+		vm_error_at(wk, err_node, "error: %s", job->cmd_ctx.err_msg);
+		run_cmd_ctx_destroy(&job->cmd_ctx);
+		return false;
+	}
+
+	job->busy = true;
+	return true;
+}
+
+static void
+compiler_check_batch_finish(struct workspace *wk, struct compiler_check_batch_job *job)
+{
+	struct compiler_check_batch_elem *elem = job->elem;
+
+	compiler_check_log_output(&elem->opts, &job->cmd_ctx);
+
+	elem->res = job->cmd_ctx.status == 0;
+	compiler_check_cache_set(wk, elem->opts.cache_key, &(struct compiler_check_cache_value){ .success = elem->res });
+
+	if (elem->opts.keep_cmd_ctx) {
+		elem->opts.cmd_ctx = job->cmd_ctx;
+	} else {
+		run_cmd_ctx_destroy(&job->cmd_ctx);
+	}
+
+	job->busy = false;
+}
+
+/*
+ * Releases the command contexts kept for the caller when a batch fails
+ * part way through.
+ */
+static void
+compiler_check_batch_release(struct compiler_check_batch_elem *elems, uint32_t len)
+{
+	uint32_t i;
+	for (i = 0; i < len; ++i) {
+		if (elems[i].opts.keep_cmd_ctx && !elems[i].opts.from_cache) {
+			run_cmd_ctx_destroy(&elems[i].opts.cmd_ctx);
+		}
+	}
+}
+
+static bool
+compiler_check_batch(struct workspace *wk, struct arr *batch, uint32_t err_node, bool stop_on_failure)
+{
+	TracyCZoneAutoS;
+	struct compiler_check_batch_elem *elems = (struct compiler_check_batch_elem *)batch->e;
+	uint32_t len = batch->len;
+	uint32_t i, pending = 0;
+
+	for (i = 0; i < len; ++i) {
+		struct compiler_check_batch_elem *elem = &elems[i];
+		assert(elem->opts.mode == compiler_check_mode_compile || elem->opts.mode == compiler_check_mode_link);
+		assert(!elem->opts.required && !elem->opts.src_is_path && !elem->opts.output_path);
+
+		struct compiler_check_cmd cmd;
+		if (!compiler_check_setup_cmd(wk, &elem->opts, elem->src, -1, &cmd)) {
+			TracyCZoneAutoE;
+			return false;
+		}
+
+		// The cache key is always computed from the shared scratch
+		// paths so that batched and unbatched checks share cache
+		// entries.
+		if (!compiler_check_cache_lookup(wk, &elem->opts, &cmd, elem->src, &elem->res)) {
+			++pending;
+		} else if (stop_on_failure && !elem->res) {
+			len = i + 1;
+			break;
+		}
+	}
+
+	if (pending <= 1) {
+		for (i = 0; i < len; ++i) {
+			struct compiler_check_batch_elem *elem = &elems[i];
+			if (elem->opts.from_cache) {
+				continue;
+			}
+
+			if (!compiler_check(wk, &elem->opts, elem->src, err_node, &elem->res)) {
+				compiler_check_batch_release(elems, i);
+				TracyCZoneAutoE;
+				return false;
+			}
+
+			if (stop_on_failure && !elem->res) {
+				break;
+			}
+		}
+
+		TracyCZoneAutoE;
+		return true;
+	}
+
+	const uint32_t job_count = MIN(pending, os_parallel_job_count());
+	struct compiler_check_batch_job *jobs = ar_maken(wk->a_scratch, struct compiler_check_batch_job, job_count);
+	struct run_cmd_ctx **running = ar_maken(wk->a_scratch, struct run_cmd_ctx *, job_count);
+	uint32_t next = 0, busy = 0, running_len;
+	bool ok = true;
+
+	while (true) {
+		for (i = 0; ok && i < job_count && next < len; ++i) {
+			if (jobs[i].busy) {
+				continue;
+			}
+
+			while (next < len && elems[next].opts.from_cache) {
+				++next;
+			}
+
+			if (next >= len) {
+				break;
+			}
+
+			if (!compiler_check_batch_start(wk, &jobs[i], i, &elems[next], err_node)) {
+				ok = false;
+				break;
+			}
+
+			++next;
+			++busy;
+		}
+
+		if (!busy) {
+			break;
+		}
+
+		bool collected = false;
+		running_len = 0;
+		for (i = 0; i < job_count; ++i) {
+			if (!jobs[i].busy) {
+				continue;
+			}
+
+			switch (run_cmd_collect(wk, &jobs[i].cmd_ctx)) {
+			case run_cmd_running: running[running_len++] = &jobs[i].cmd_ctx; continue;
+			case run_cmd_error:
+				vm_error_at(wk, err_node, "error: %s", jobs[i].cmd_ctx.err_msg);
+				run_cmd_ctx_destroy(&jobs[i].cmd_ctx);
+				jobs[i].busy = false;
+				ok = false;
+				break;
+			case run_cmd_finished:
+				compiler_check_batch_finish(wk, &jobs[i]);
+				if (stop_on_failure && !jobs[i].elem->res) {
+					// Elements past this one no longer matter.
+					len = MIN(len, (uint32_t)(jobs[i].elem - elems) + 1);
+				}
+				break;
+			}
+
+			collected = true;
+			--busy;
+		}
+
+		if (!collected) {
+			run_cmd_wait_any(wk, running, running_len, -1);
+		}
+	}
+
+	if (!ok) {
+		compiler_check_batch_release(elems, next);
+	}
+
+	TracyCZoneAutoE;
+	return ok;
+}
+
 static int64_t
 compiler_check_parse_output_int(struct compiler_check_opts *opts)
 {
@@ -525,13 +808,11 @@ FUNC_IMPL(compiler, sizeof, tc_number, func_impl_flag_impure)
 	bool ok;
 	if (compiler_check(wk, &opts, src, an[0].node, &ok) && ok) {
 		if (!opts.from_cache) {
-			*res = make_obj(wk, obj_number);
-			set_obj_number(wk, *res, compiler_check_parse_output_int(&opts));
+			*res = make_number(wk, compiler_check_parse_output_int(&opts));
 		}
 	} else {
 		if (!opts.from_cache) {
-			*res = make_obj(wk, obj_number);
-			set_obj_number(wk, *res, -1);
+			*res = make_number(wk, -1);
 		}
 	}
 
@@ -581,8 +862,7 @@ FUNC_IMPL(compiler, alignment, tc_number, func_impl_flag_impure)
 	if (opts.from_cache) {
 		*res = opts.cache_val;
 	} else {
-		*res = make_obj(wk, obj_number);
-		set_obj_number(wk, *res, compiler_check_parse_output_int(&opts));
+		*res = make_number(wk, compiler_check_parse_output_int(&opts));
 		run_cmd_ctx_destroy(&opts.cmd_ctx);
 		compiler_check_cache_set(
 			wk, opts.cache_key, &(struct compiler_check_cache_value){ .success = true, .value = *res });
@@ -630,8 +910,7 @@ FUNC_IMPL(compiler, compute_int, tc_number, func_impl_flag_impure)
 	if (opts.from_cache) {
 		*res = opts.cache_val;
 	} else {
-		*res = make_obj(wk, obj_number);
-		set_obj_number(wk, *res, compiler_check_parse_output_int(&opts));
+		*res = make_number(wk, compiler_check_parse_output_int(&opts));
 		run_cmd_ctx_destroy(&opts.cmd_ctx);
 		compiler_check_cache_set(
 			wk, opts.cache_key, &(struct compiler_check_cache_value){ .success = true, .value = *res });
@@ -749,24 +1028,41 @@ get_has_function_attribute_test(const struct str *name, const char **res)
 }
 
 static bool
-compiler_has_function_attribute(struct workspace *wk, obj comp_id, uint32_t err_node, obj arg, bool *has_fattr)
+compiler_has_function_attribute_setup(struct workspace *wk,
+	obj comp_id,
+	uint32_t err_node,
+	obj arg,
+	struct compiler_check_batch_elem *elem)
 {
-	struct compiler_check_opts opts = {
-		.mode = compiler_check_mode_compile,
-		.comp_id = comp_id,
+	*elem = (struct compiler_check_batch_elem){
+		.opts = {
+			.mode = compiler_check_mode_compile,
+			.comp_id = comp_id,
+		},
+		.arg = arg,
 	};
 
-	const char *src;
-	if (!get_has_function_attribute_test(get_str(wk, arg), &src)) {
+	if (!get_has_function_attribute_test(get_str(wk, arg), &elem->src)) {
 		vm_error_at(wk, err_node, "unknown attribute '%s'", get_cstr(wk, arg));
 		return false;
 	}
 
-	if (!compiler_check(wk, &opts, src, err_node, has_fattr)) {
+	return true;
+}
+
+static bool
+compiler_has_function_attribute(struct workspace *wk, obj comp_id, uint32_t err_node, obj arg, bool *has_fattr)
+{
+	struct compiler_check_batch_elem elem;
+	if (!compiler_has_function_attribute_setup(wk, comp_id, err_node, arg, &elem)) {
+		return false;
+	}
+
+	if (!compiler_check(wk, &elem.opts, elem.src, err_node, has_fattr)) {
 		return false;
 	}
 
-	compiler_check_log(wk, &opts, "has attribute %s: %s", get_cstr(wk, arg), bool_to_yn(*has_fattr));
+	compiler_check_log(wk, &elem.opts, "has attribute %s: %s", get_cstr(wk, arg), bool_to_yn(*has_fattr));
 
 	return true;
 }
@@ -795,23 +1091,21 @@ FUNC_IMPL(compiler, has_function_attribute, tc_bool, func_impl_flag_impure)
 
 struct func_compiler_get_supported_function_attributes_iter_ctx {
 	uint32_t node;
-	obj arr, compiler;
+	obj compiler;
+	struct arr batch;
 };
 
 static enum iteration_result
 func_compiler_get_supported_function_attributes_iter(struct workspace *wk, void *_ctx, obj val_id)
 {
 	struct func_compiler_get_supported_function_attributes_iter_ctx *ctx = _ctx;
-	bool has_fattr;
+	struct compiler_check_batch_elem elem;
 
-	if (!compiler_has_function_attribute(wk, ctx->compiler, ctx->node, val_id, &has_fattr)) {
+	if (!compiler_has_function_attribute_setup(wk, ctx->compiler, ctx->node, val_id, &elem)) {
 		return ir_err;
 	}
 
-	if (has_fattr) {
-		obj_array_push(wk, ctx->arr, val_id);
-	}
-
+	arr_push(wk->a_scratch, &ctx->batch, &elem);
 	return ir_cont;
 }
 
@@ -823,16 +1117,35 @@ FUNC_IMPL(compiler, get_supported_function_attributes, tc_array, func_impl_flag_
 		return false;
 	}
 
+	struct func_compiler_get_supported_function_attributes_iter_ctx ctx = {
+		.compiler = self,
+		.node = an[0].node,
+	};
+	arr_init(wk->a_scratch, &ctx.batch, 8, struct compiler_check_batch_elem);
+
+	if (!obj_array_foreach_flat(wk, an[0].val, &ctx, func_compiler_get_supported_function_attributes_iter)) {
+		return false;
+	}
+
+	if (!compiler_check_batch(wk, &ctx.batch, an[0].node, false)) {
+		return false;
+	}
+
 	*res = make_obj(wk, obj_array);
 
-	return obj_array_foreach_flat(wk,
-		an[0].val,
-		&(struct func_compiler_get_supported_function_attributes_iter_ctx){
-			.compiler = self,
-			.arr = *res,
-			.node = an[0].node,
-		},
-		func_compiler_get_supported_function_attributes_iter);
+	uint32_t i;
+	for (i = 0; i < ctx.batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = arr_get(&ctx.batch, i);
+
+		compiler_check_log(
+			wk, &elem->opts, "has attribute %s: %s", get_cstr(wk, elem->arg), bool_to_yn(elem->res));
+
+		if (elem->res) {
+			obj_array_push(wk, *res, elem->arg);
+		}
+	}
+
+	return true;
 }
 
 FUNC_IMPL(compiler, has_function, tc_bool, func_impl_flag_impure)
@@ -1500,6 +1813,21 @@ FUNC_IMPL(compiler, has_type, tc_bool, func_impl_flag_impure)
 	return true;
 }
 
+static const char *
+compiler_has_member_src(struct workspace *wk, const char *prefix, obj target, obj member)
+{
+	return get_cstr(wk,
+		make_strf(wk,
+			"%s\n"
+			"void bar(void) {\n"
+			"%s foo;\n"
+			"foo.%s;\n"
+			"}\n",
+			prefix,
+			get_cstr(wk, target),
+			get_cstr(wk, member)));
+}
+
 static bool
 compiler_has_member(struct workspace *wk,
 	struct compiler_check_opts *opts,
@@ -1511,19 +1839,7 @@ compiler_has_member(struct workspace *wk,
 {
 	opts->mode = compiler_check_mode_compile;
 
-	char src[BUF_SIZE_4k];
-	snprintf(src,
-		BUF_SIZE_4k,
-		"%s\n"
-		"void bar(void) {\n"
-		"%s foo;\n"
-		"foo.%s;\n"
-		"}\n",
-		prefix,
-		get_cstr(wk, target),
-		get_cstr(wk, member));
-
-	if (!compiler_check(wk, opts, src, err_node, res)) {
+	if (!compiler_check(wk, opts, compiler_has_member_src(wk, prefix, target, member), err_node, res)) {
 		return false;
 	}
 
@@ -1566,7 +1882,7 @@ struct compiler_has_members_ctx {
 	uint32_t node;
 	const char *prefix;
 	obj target;
-	bool ok;
+	struct arr batch;
 };
 
 static enum iteration_result
@@ -1578,16 +1894,16 @@ compiler_has_members_iter(struct workspace *wk, void *_ctx, obj val)
 		return ir_err;
 	}
 
-	bool ok;
-	if (!compiler_has_member(wk, ctx->opts, ctx->node, ctx->prefix, ctx->target, val, &ok)) {
-		return ir_err;
-	}
-
-	if (!ok) {
-		ctx->ok = false;
-		return ir_done;
-	}
+	struct compiler_check_batch_elem elem = {
+		.opts = *ctx->opts,
+		.src = compiler_has_member_src(wk, ctx->prefix, ctx->target, val),
+		.arg = val,
+	};
+	elem.opts.mode = compiler_check_mode_compile;
+	// required is handled once for all members by the caller
+	elem.opts.required = 0;
 
+	arr_push(wk->a_scratch, &ctx->batch, &elem);
 	return ir_cont;
 }
 
@@ -1618,16 +1934,39 @@ FUNC_IMPL(compiler, has_members, tc_bool, func_impl_flag_impure)
 		.node = an[0].node,
 		.prefix = compiler_check_prefix(wk, akw),
 		.target = an[0].val,
-		.ok = true,
 	};
+	arr_init(wk->a_scratch, &ctx.batch, 8, struct compiler_check_batch_elem);
 
 	if (!obj_array_foreach_flat(wk, an[1].val, &ctx, compiler_has_members_iter)) {
 		return false;
 	}
 
-	compiler_handle_has_required_kw(required, ctx.ok);
+	// Like checking each member in turn, stop at the first missing one.
+	if (!compiler_check_batch(wk, &ctx.batch, an[0].node, true)) {
+		return false;
+	}
 
-	*res = make_obj_bool(wk, ctx.ok);
+	bool ok = true;
+	uint32_t i;
+	for (i = 0; i < ctx.batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = arr_get(&ctx.batch, i);
+
+		compiler_check_log(wk,
+			&elem->opts,
+			"struct %s has member %s: %s",
+			get_cstr(wk, ctx.target),
+			get_cstr(wk, elem->arg),
+			bool_to_yn(elem->res));
+
+		if (!elem->res) {
+			ok = false;
+			break;
+		}
+	}
+
+	compiler_handle_has_required_kw(required, ok);
+
+	*res = make_obj_bool(wk, ok);
 	return true;
 }
 
@@ -1715,13 +2054,12 @@ FUNC_IMPL(compiler, run, tc_run_result, func_impl_flag_impure)
 	return true;
 }
 
-static bool
-compiler_has_argument(struct workspace *wk,
+static void
+compiler_has_argument_setup(struct workspace *wk,
 	obj comp_id,
-	uint32_t err_node,
 	obj arg,
-	bool *has_argument,
-	enum compiler_check_mode mode)
+	enum compiler_check_mode mode,
+	struct compiler_check_batch_elem *elem)
 {
 	obj args;
 	args = make_obj(wk, obj_array);
@@ -1754,71 +2092,124 @@ compiler_has_argument(struct workspace *wk,
 		arg = str;
 	}
 
-	struct compiler_check_opts opts = {
-		.mode = mode,
-		.comp_id = comp_id,
-		.args = args,
-		.keep_cmd_ctx = true,
+	*elem = (struct compiler_check_batch_elem){
+		.opts = {
+			.mode = mode,
+			.comp_id = comp_id,
+			.args = args,
+			.keep_cmd_ctx = true,
+		},
+		.src = "int main(void){}\n",
+		.arg = arg,
 	};
+}
 
-	const char *src = "int main(void){}\n";
-	if (!compiler_check(wk, &opts, src, err_node, has_argument)) {
-		return false;
-	}
+/*
+ * Corrects the result (and its cache entry) of an argument check when the
+ * compiler only warned that it ignored the argument.
+ */
+static void
+compiler_has_argument_check_ignored(struct workspace *wk, struct compiler_check_batch_elem *elem)
+{
+	struct compiler_check_opts *opts = &elem->opts;
 
-	if (!opts.from_cache) {
+	if (!opts->from_cache) {
 		bool option_ignored = false;
-		struct tstr *outs[] = { &opts.cmd_ctx.out, &opts.cmd_ctx.err };
+		struct tstr *outs[] = { &opts->cmd_ctx.out, &opts->cmd_ctx.err };
 		for (uint32_t i = 0; i < ARRAY_LEN(outs); ++i) {
 			if (!outs[i]->len) {
 				continue;
 			}
 
-			if (toolchain_compiler_check_ignored_option(wk, comp_id, outs[i]->buf)) {
+			if (toolchain_compiler_check_ignored_option(wk, opts->comp_id, outs[i]->buf)) {
 				option_ignored = true;
 				break;
-			} else if (toolchain_linker_check_ignored_option(wk, comp_id, outs[i]->buf)) {
+			} else if (toolchain_linker_check_ignored_option(wk, opts->comp_id, outs[i]->buf)) {
 				option_ignored = true;
 				break;
 			}
 		}
 
 		if (option_ignored) {
-			*has_argument = false;
+			elem->res = false;
 
 			compiler_check_cache_set(
-				wk, opts.cache_key, &(struct compiler_check_cache_value){ .success = *has_argument });
+				wk, opts->cache_key, &(struct compiler_check_cache_value){ .success = elem->res });
 		}
 
-		run_cmd_ctx_destroy(&opts.cmd_ctx);
+		run_cmd_ctx_destroy(&opts->cmd_ctx);
 	}
+}
+
+static void
+compiler_has_argument_finish(struct workspace *wk, struct compiler_check_batch_elem *elem)
+{
+	compiler_has_argument_check_ignored(wk, elem);
+
+	compiler_check_log(
+		wk, &elem->opts, "supports argument '%s': %s", get_cstr(wk, elem->arg), bool_to_yn(elem->res));
+}
+
+static bool
+compiler_has_argument(struct workspace *wk,
+	obj comp_id,
+	uint32_t err_node,
+	obj arg,
+	bool *has_argument,
+	enum compiler_check_mode mode)
+{
+	struct compiler_check_batch_elem elem;
+	compiler_has_argument_setup(wk, comp_id, arg, mode, &elem);
 
-	compiler_check_log(wk, &opts, "supports argument '%s': %s", get_cstr(wk, arg), bool_to_yn(*has_argument));
+	if (!compiler_check(wk, &elem.opts, elem.src, err_node, &elem.res)) {
+		return false;
+	}
 
+	compiler_has_argument_finish(wk, &elem);
+	*has_argument = elem.res;
 	return true;
 }
 
 struct func_compiler_get_supported_arguments_iter_ctx {
-	uint32_t node;
-	obj arr, compiler;
+	obj compiler;
 	enum compiler_check_mode mode;
+	struct arr batch;
 };
 
 static enum iteration_result
 func_compiler_get_supported_arguments_iter(struct workspace *wk, void *_ctx, obj val_id)
 {
 	struct func_compiler_get_supported_arguments_iter_ctx *ctx = _ctx;
-	bool has_argument;
+	struct compiler_check_batch_elem elem;
 
-	if (!compiler_has_argument(wk, ctx->compiler, ctx->node, val_id, &has_argument, ctx->mode)) {
-		return false;
-	}
+	compiler_has_argument_setup(wk, ctx->compiler, val_id, ctx->mode, &elem);
+	arr_push(wk->a_scratch, &ctx->batch, &elem);
+	return ir_cont;
+}
 
-	if (has_argument) {
-		obj_array_push(wk, ctx->arr, val_id);
+/*
+ * Checks every argument in an[0] as a batch.  The results are left in
+ * ctx->batch and must be passed through compiler_has_argument_finish in
+ * order.
+ */
+static bool
+compiler_has_arguments_batch(struct workspace *wk,
+	obj self,
+	struct args_norm *an,
+	enum compiler_check_mode mode,
+	struct func_compiler_get_supported_arguments_iter_ctx *ctx)
+{
+	*ctx = (struct func_compiler_get_supported_arguments_iter_ctx){
+		.compiler = self,
+		.mode = mode,
+	};
+	arr_init(wk->a_scratch, &ctx->batch, 8, struct compiler_check_batch_elem);
+
+	if (!obj_array_foreach_flat(wk, an[0].val, ctx, func_compiler_get_supported_arguments_iter)) {
+		return false;
 	}
 
-	return ir_cont;
+	return compiler_check_batch(wk, &ctx->batch, an[0].node, false);
 }
 
 static bool
@@ -1873,17 +2264,24 @@ compiler_get_supported_arguments(struct workspace *wk, obj self, obj *res, enum
 		return false;
 	}
 
+	struct func_compiler_get_supported_arguments_iter_ctx ctx;
+	if (!compiler_has_arguments_batch(wk, self, an, mode, &ctx)) {
+		return false;
+	}
+
 	*res = make_obj(wk, obj_array);
 
-	return obj_array_foreach_flat(wk,
-		an[0].val,
-		&(struct func_compiler_get_supported_arguments_iter_ctx){
-			.compiler = self,
-			.arr = *res,
-			.node = an[0].node,
-			.mode = mode,
-		},
-		func_compiler_get_supported_arguments_iter);
+	uint32_t i;
+	for (i = 0; i < ctx.batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = arr_get(&ctx.batch, i);
+		compiler_has_argument_finish(wk, elem);
+
+		if (elem->res) {
+			obj_array_push(wk, *res, elem->arg);
+		}
+	}
+
+	return true;
 }
 
 FUNC_IMPL(compiler, get_supported_arguments, tc_array, func_impl_flag_impure)
@@ -1896,25 +2294,6 @@ FUNC_IMPL(compiler, get_supported_link_arguments, tc_array, func_impl_flag_impur
 	return compiler_get_supported_arguments(wk, self, res, compiler_check_mode_link);
 }
 
-static enum iteration_result
-func_compiler_first_supported_argument_iter(struct workspace *wk, void *_ctx, obj val_id)
-{
-	struct func_compiler_get_supported_arguments_iter_ctx *ctx = _ctx;
-	bool has_argument;
-
-	if (!compiler_has_argument(wk, ctx->compiler, ctx->node, val_id, &has_argument, ctx->mode)) {
-		return false;
-	}
-
-	if (has_argument) {
-		compiler_log(wk, ctx->compiler, "first supported argument: '%s'", get_cstr(wk, val_id));
-		obj_array_push(wk, ctx->arr, val_id);
-		return ir_done;
-	}
-
-	return ir_cont;
-}
-
 static bool
 compiler_first_supported_argument(struct workspace *wk, obj self, obj *res, enum compiler_check_mode mode)
 {
@@ -1924,17 +2303,36 @@ compiler_first_supported_argument(struct workspace *wk, obj self, obj *res, enum
 		return false;
 	}
 
+	struct func_compiler_get_supported_arguments_iter_ctx ctx;
+	if (!compiler_has_arguments_batch(wk, self, an, mode, &ctx)) {
+		return false;
+	}
+
 	*res = make_obj(wk, obj_array);
 
-	return obj_array_foreach_flat(wk,
-		an[0].val,
-		&(struct func_compiler_get_supported_arguments_iter_ctx){
-			.compiler = self,
-			.arr = *res,
-			.node = an[0].node,
-			.mode = mode,
-		},
-		func_compiler_first_supported_argument_iter);
+	// All arguments were checked speculatively, but only report up to
+	// the first supported one.
+	bool found = false;
+	uint32_t i;
+	for (i = 0; i < ctx.batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = arr_get(&ctx.batch, i);
+
+		if (found) {
+			// Still correct the cached result of the remaining checks.
+			compiler_has_argument_check_ignored(wk, elem);
+			continue;
+		}
+
+		compiler_has_argument_finish(wk, elem);
+
+		if (elem->res) {
+			compiler_log(wk, self, "first supported argument: '%s'", get_cstr(wk, elem->arg));
+			obj_array_push(wk, *res, elem->arg);
+			found = true;
+		}
+	}
+
+	return true;
 }
 
 FUNC_IMPL(compiler, first_supported_argument, tc_array, func_impl_flag_impure)
@@ -84,8 +84,7 @@ FUNC_IMPL(configuration_data, set10, 0, func_impl_flag_impure)
 	obj dict = get_obj_configuration_data(wk, self)->dict;
 
 	obj n;
-	n = make_obj(wk, obj_number);
-	set_obj_number(wk, n, get_obj_bool(wk, an[1].val) ? 1 : 0);
+	n = make_number(wk, get_obj_bool(wk, an[1].val) ? 1 : 0);
 	obj_dict_set(wk, dict, an[0].val, n);
 
 	return true;
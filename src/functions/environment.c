@@ -153,8 +153,7 @@ environment_set(struct workspace *wk, obj env, enum environment_set_mode mode, o
 	}
 
 	obj elem, mode_num;
-	mode_num = make_obj(wk, obj_number);
-	set_obj_number(wk, mode_num, mode);
+	mode_num = make_number(wk, mode);
 	elem = make_obj(wk, obj_array);
 	obj_array_push(wk, elem, mode_num);
 	obj_array_push(wk, elem, key);
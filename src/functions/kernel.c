@@ -26,6 +26,7 @@
 #include "functions/kernel/options.h"
 #include "functions/kernel/subproject.h"
 #include "functions/modules.h"
+#include "functions/modules/subprojects.h"
 #include "functions/string.h"
 #include "lang/func_lookup.h"
 #include "lang/object_iterators.h"
@@ -287,6 +288,16 @@ FUNC_IMPL(kernel, project, 0)
 			LOG_E("failed loading wrap provides");
 			return false;
 		}
+
+		obj fetch_jobs;
+		if (wk->cur_project == 0 && !wk->vm.in_analyzer && get_option_wrap_mode(wk) != wrap_mode_nodownload) {
+			get_option_value(wk, current_project(wk), "muon.wrap_fetch_jobs", &fetch_jobs);
+			if (get_obj_number(wk, fetch_jobs) > 0
+				&& !subprojects_prefetch(wk, subprojects_path.buf, get_obj_number(wk, fetch_jobs))) {
+				// Errors are reported again if the subproject is used.
+				LOG_W("failed to fetch some wraps");
+			}
+		}
 	}
 
 	LLOG_I(CLR(c_bold, c_magenta) "%s" CLR(0), get_cstr(wk, current_project(wk)->cfg.name));
@@ -727,6 +727,8 @@ static bool dependency_is_resolving_from_closure = false;
 static bool
 build_lookup_handler_list(struct workspace *wk, struct dep_lookup_ctx *ctx, struct dependency_lookup_handlers *handlers)
 {
+	workspace_init_dependency_runtime(wk);
+
 	obj handler_dict = 0;
 	if (!dependency_is_resolving_from_closure
 		&& obj_dict_index(wk, wk->dependency_handlers, ctx->name, &handler_dict)) {
@@ -1778,23 +1780,82 @@ build_dep_merge(struct workspace *wk,
 	}
 }
 
+/*
+ * Arguments are filtered into a new array only once one is dropped.  An
+ * argument list without duplicates is replaced by a light copy, which is
+ * a distinct array but keeps sharing storage with the dependencies it was
+ * merged from.  The arguments kept so far are either res or the first i
+ * elements of src.
+ */
+struct dedup_args {
+	obj src, res;
+	uint32_t i;
+};
+
+static obj
+dedup_args_kept(struct workspace *wk, const struct dedup_args *d, uint32_t *len)
+{
+	if (d->res) {
+		*len = get_obj_array(wk, d->res)->len;
+		return d->res;
+	}
+
+	*len = d->i;
+	return d->src;
+}
+
 static bool
-obj_array_pair_in(struct workspace *wk, obj arr, obj a, obj b)
+dedup_args_in(struct workspace *wk, const struct dedup_args *d, obj arg)
 {
-	obj prev = 0, v;
-	obj_array_for(wk, arr, v) {
-		if (prev) {
-			if (obj_equal(wk, a, prev) && obj_equal(wk, b, v)) {
-				return true;
-			}
-		}
+	uint32_t len, idx;
+	obj kept = dedup_args_kept(wk, d, &len);
+	return obj_array_index_of(wk, kept, arg, &idx) && idx < len;
+}
+
+static bool
+dedup_args_pair_in(struct workspace *wk, const struct dedup_args *d, obj a, obj b)
+{
+	uint32_t len, idx;
+	obj kept = dedup_args_kept(wk, d, &len);
+
+	// Usually answered by the index of kept.
+	if (!obj_array_index_of(wk, kept, b, &idx) || idx >= len) {
+		return false;
+	}
 
-		prev = v;
+	const obj *e = obj_array_elems(wk, get_obj_array(wk, kept));
+	for (uint32_t i = idx; i < len; ++i) {
+		if (i && obj_equal(wk, a, e[i - 1]) && obj_equal(wk, b, e[i])) {
+			return true;
+		}
 	}
 
 	return false;
 }
 
+static void
+dedup_args_push(struct workspace *wk, struct dedup_args *d, obj arg)
+{
+	if (d->res) {
+		obj_array_push(wk, d->res, arg);
+	}
+	++d->i;
+}
+
+// Drop the current argument, and with pop also the last one kept.
+static void
+dedup_args_drop(struct workspace *wk, struct dedup_args *d, bool pop)
+{
+	if (!d->res) {
+		d->res = obj_array_slice(wk, d->src, 0, d->i);
+	}
+
+	if (pop) {
+		obj_array_pop(wk, d->res);
+	}
+	++d->i;
+}
+
 static bool
 is_joined_arg(const struct str *s, const struct str *prefix)
 {
@@ -1844,37 +1905,30 @@ dedup_build_dep(struct workspace *wk, struct build_dep *dep)
 	obj_array_dedup_in_place(wk, &dep->objects);
 
 	{
-		obj arg, new_args = make_obj(wk, obj_array);
-		obj prev = 0;
+		struct dedup_args d = { .src = dep->link_args };
+		obj arg, prev = 0;
 		const struct str *prev_s = 0;
 
 		obj_array_for(wk, dep->link_args, arg) {
-			bool add = true;
 			const struct str *s = get_str(wk, arg);
-			if (str_eql(s, &STR("-pthread"))) {
-				if (obj_array_in(wk, new_args, arg)) {
-					add = false;
-				}
-			} else if (prev_s && str_eql(prev_s, &STR("-framework"))) {
-				if (obj_array_pair_in(wk, new_args, prev, arg)) {
-					obj_array_pop(wk, new_args);
-					add = false;
-				}
-			}
-
-			if (add) {
-				obj_array_push(wk, new_args, arg);
+			if (str_eql(s, &STR("-pthread")) && dedup_args_in(wk, &d, arg)) {
+				dedup_args_drop(wk, &d, false);
+			} else if (prev_s && str_eql(prev_s, &STR("-framework")) && dedup_args_pair_in(wk, &d, prev, arg)) {
+				dedup_args_drop(wk, &d, true);
+			} else {
+				dedup_args_push(wk, &d, arg);
 			}
 
 			prev = arg;
 			prev_s = s;
 		}
-		dep->link_args = new_args;
+
+		dep->link_args = d.res ? d.res : obj_array_dup_light(wk, d.src);
 	}
 
 	{
-		obj arg, new_args = make_obj(wk, obj_array);
-		obj prev = 0;
+		struct dedup_args d = { .src = dep->compile_args };
+		obj arg, prev = 0;
 		const struct str *prev_s = 0;
 
 		const struct str to_dedup[] = {
@@ -1884,27 +1938,25 @@ dedup_build_dep(struct workspace *wk, struct build_dep *dep)
 		};
 
 		obj_array_for(wk, dep->compile_args, arg) {
-			bool add = true;
 			const struct str *s = get_str(wk, arg);
 			if (str_eql(s, &STR("-pthread")) || is_any_joined_arg(s, to_dedup, ARRAY_LEN(to_dedup))) {
-				if (obj_array_in(wk, new_args, arg)) {
-					add = false;
+				if (dedup_args_in(wk, &d, arg)) {
+					dedup_args_drop(wk, &d, false);
+				} else {
+					dedup_args_push(wk, &d, arg);
 				}
-			} else if (prev_s && is_any_str(s, to_dedup, ARRAY_LEN(to_dedup))) {
-				if (obj_array_pair_in(wk, new_args, prev, arg)) {
-					obj_array_pop(wk, new_args);
-					add = false;
-				}
-			}
-
-			if (add) {
-				obj_array_push(wk, new_args, arg);
+			} else if (prev_s && is_any_str(s, to_dedup, ARRAY_LEN(to_dedup))
+				   && dedup_args_pair_in(wk, &d, prev, arg)) {
+				dedup_args_drop(wk, &d, true);
+			} else {
+				dedup_args_push(wk, &d, arg);
 			}
 
 			prev = arg;
 			prev_s = s;
 		}
-		dep->compile_args = new_args;
+
+		dep->compile_args = d.res ? d.res : obj_array_dup_light(wk, d.src);
 	}
 
 	TracyCZoneAutoE;
@@ -745,6 +745,8 @@ FUNC_IMPL(meson,
 		vm_error(wk, "No handlers defined.");
 	}
 
+	// Load the builtin handlers first so that this one replaces them.
+	workspace_init_dependency_runtime(wk);
 	obj_dict_set(wk, wk->dependency_handlers, an[0].val, handler_dict);
 	return true;
 }
@@ -390,8 +390,7 @@ FUNC_IMPL(module_fs, size, tc_number, func_impl_flag_impure, .desc = "Get a file
 	}
 
 	assert(size < INT64_MAX);
-	*res = make_obj(wk, obj_number);
-	set_obj_number(wk, *res, size);
+	*res = make_number(wk, size);
 	return true;
 }
 
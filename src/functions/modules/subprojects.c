@@ -11,10 +11,15 @@
 #include "coerce.h"
 #include "formats/ansi.h"
 #include "functions/modules/subprojects.h"
+#include "lang/compiler.h"
 #include "lang/object_iterators.h"
+#include "lang/parser.h"
 #include "lang/typecheck.h"
 #include "log.h"
+#include "options.h"
+#include "platform/filesystem.h"
 #include "platform/path.h"
+#include "platform/run_cmd.h"
 #include "platform/timer.h"
 #include "tracy.h"
 #include "util.h"
@@ -119,6 +124,7 @@ struct subprojects_process_opts {
 	bool single_file;
 	bool progress_bar;
 	bool fail_if_update_skipped;
+	bool early_out_if_meson_build_exists;
 };
 
 struct subprojects_process_progress_decorate_ctx {
@@ -316,15 +322,20 @@ subprojects_process(struct workspace *wk, obj list, struct subprojects_process_o
 			.allow_download = true,
 			.subprojects = opts->subprojects_dir ? opts->subprojects_dir : subprojects_dir(wk),
 			.fail_if_update_skipped = opts->fail_if_update_skipped,
+			.early_out_if_meson_build_exists = opts->early_out_if_meson_build_exists,
 		};
 	}
 
+	struct run_cmd_ctx **cmd_ctxs = ar_maken(wk->a_scratch, struct run_cmd_ctx *, ctx.handlers.len);
+	uint32_t cnt_cmd_ctxs;
+
 	wrap_handle_async_start(wk);
 	timer_start(&ctx.duration);
 
 	while (cnt_complete < ctx.handlers.len) {
 		float loop_start = timer_read(&ctx.duration);
 		cnt_running = 0;
+		cnt_cmd_ctxs = 0;
 
 		for (i = 0; i < ctx.handlers.len; ++i) {
 			wrap_ctx = arr_get(&ctx.handlers, i);
@@ -360,6 +371,8 @@ subprojects_process(struct workspace *wk, obj list, struct subprojects_process_o
 				wrap_ctx->ok = false;
 				++cnt_failed;
 				++cnt_complete;
+			} else if (wrap_ctx->sub_state == wrap_handle_sub_state_running_cmd) {
+				cmd_ctxs[cnt_cmd_ctxs++] = &wrap_ctx->cmd_ctx;
 			}
 
 			TracyCZoneEnd(tctx_1);
@@ -367,6 +380,13 @@ subprojects_process(struct workspace *wk, obj list, struct subprojects_process_o
 
 		log_progress_subval(wk, cnt_complete, cnt_complete + cnt_running);
 
+		if (cnt_cmd_ctxs && cnt_cmd_ctxs == cnt_running) {
+			// Every active handler is waiting on a child process, so
+			// block until one of them makes progress.
+			run_cmd_wait_any(wk, cmd_ctxs, cnt_cmd_ctxs, SLEEP_TIME / 1000000);
+			continue;
+		}
+
 		float loop_dur_ns = (timer_read(&ctx.duration) - loop_start) * 1e9;
 		if (loop_dur_ns < ((double)SLEEP_TIME / 10.0)) {
 			timer_sleep(((double)SLEEP_TIME / 10.0) - loop_dur_ns);
@@ -441,6 +461,188 @@ FUNC_IMPL(module_subprojects, update, 0, func_impl_flag_impure | func_impl_flag_
 		});
 }
 
+struct subprojects_reached_ctx {
+	const char *subprojects_dir;
+	obj names, dirs;
+	obj force_fallback_for;
+	bool force_fallback;
+};
+
+static const struct str *
+subprojects_reached_node_str(struct workspace *wk, struct node *n)
+{
+	if (!n) {
+		return 0;
+	} else if (n->type == node_type_array) {
+		// fallback: ['name', 'variable']
+		n = node_l(wk, n);
+	}
+
+	return n && n->type == node_type_string ? get_str(wk, n->data.str) : 0;
+}
+
+static void
+subprojects_reached_push(struct workspace *wk, struct subprojects_reached_ctx *ctx, const struct str *name)
+{
+	TSTR(wrap_file);
+	path_join(wk, &wrap_file, ctx->subprojects_dir, name->s);
+	tstr_pushs(wk, &wrap_file, ".wrap");
+
+	obj s = make_strn(wk, name->s, name->len);
+	if (!obj_array_in(wk, ctx->names, s) && fs_file_exists(wrap_file.buf)) {
+		obj_array_push(wk, ctx->names, s);
+	}
+}
+
+static void
+subprojects_reached_call(struct workspace *wk, struct subprojects_reached_ctx *ctx, const char *dir, struct node *n)
+{
+	struct node *args = node_l(wk, n), *callee = node_r(wk, n), *arg0 = 0, *fallback = 0, *allow_fallback = 0;
+	if (!callee || callee->type != node_type_id_lit || !args) {
+		return;
+	}
+
+	struct node *elem;
+	for (; args; args = node_r(wk, args)) {
+		if (!(elem = node_l(wk, args))) {
+			continue;
+		} else if (elem->type != node_type_kw) {
+			arg0 = arg0 ? arg0 : elem;
+		} else if (str_eql(get_str(wk, node_r(wk, elem)->data.str), &STR("fallback"))) {
+			fallback = node_l(wk, elem);
+		} else if (str_eql(get_str(wk, node_r(wk, elem)->data.str), &STR("allow_fallback"))) {
+			allow_fallback = node_l(wk, elem);
+		}
+	}
+
+	const struct str *name = get_str(wk, callee->data.str), *arg;
+	if (!(arg = subprojects_reached_node_str(wk, arg0))) {
+		return;
+	}
+
+	if (str_eql(name, &STR("subdir"))) {
+		TSTR(path);
+		path_join(wk, &path, dir, arg->s);
+		obj_array_push(wk, ctx->dirs, tstr_into_str(wk, &path));
+	} else if (str_eql(name, &STR("subproject"))) {
+		subprojects_reached_push(wk, ctx, arg);
+	} else if (str_eql(name, &STR("dependency"))) {
+		// A fallback is only reached when it is forced, otherwise the
+		// system lookup might succeed.
+		if (allow_fallback && !(allow_fallback->type == node_type_bool && allow_fallback->data.num)) {
+			return;
+		} else if (!ctx->force_fallback && !obj_array_in(wk, ctx->force_fallback_for, make_strn(wk, arg->s, arg->len))) {
+			return;
+		}
+
+		const struct str *sub_name;
+		obj provided;
+		if (fallback) {
+			sub_name = subprojects_reached_node_str(wk, fallback);
+		} else if (obj_dict_index_strn(wk, current_project(wk)->wrap_provides_deps, arg->s, arg->len, &provided)) {
+			sub_name = get_str(wk, obj_array_index(wk, provided, 0));
+		} else {
+			sub_name = arg;
+		}
+
+		if (sub_name) {
+			subprojects_reached_push(wk, ctx, sub_name);
+		}
+	}
+}
+
+/*
+ * Collect the subprojects named by literal subproject() calls and forced
+ * dependency() fallbacks in dir/meson.build, and queue literal subdir()
+ * calls.  Anything under a branch, loop, or function body is skipped since
+ * it may never run.
+ */
+static void
+subprojects_reached_scan(struct workspace *wk, struct subprojects_reached_ctx *ctx, const char *dir)
+{
+	TSTR(path);
+	path_join(wk, &path, dir, "meson.build");
+	if (!fs_file_exists(path.buf)) {
+		return;
+	}
+
+	workspace_scratch_begin(wk);
+	vm_compile_state_reset(wk);
+
+	struct source src;
+	struct node *n;
+	if (!fs_read_entire_file(wk->a_scratch, path.buf, &src) || !(n = parse(wk, &src, vm_compile_mode_quiet))) {
+		goto done;
+	}
+
+	struct arr stack;
+	arr_init(wk->a_scratch, &stack, 64, uint32_t);
+	arr_push(wk->a_scratch, &stack, &n->id);
+
+	while (stack.len) {
+		n = node_get(wk, *(uint32_t *)arr_pop(&stack));
+
+		switch (n->type) {
+		case node_type_if:
+		case node_type_ternary:
+		case node_type_and:
+		case node_type_or:
+		case node_type_foreach:
+		case node_type_func_def: continue;
+		case node_type_call: subprojects_reached_call(wk, ctx, dir, n); break;
+		default: break;
+		}
+
+		if (n->r) {
+			arr_push(wk->a_scratch, &stack, &n->r);
+		}
+		if (n->l) {
+			arr_push(wk->a_scratch, &stack, &n->l);
+		}
+	}
+
+done:
+	vm_compile_state_release(wk);
+	workspace_scratch_end(wk);
+}
+
+/*
+ * Fetch the wraps the main project is certain to reach, running up to
+ * job_count fetches at once.  Subprojects are still evaluated one at a time,
+ * and any other wrap is still fetched when it is first used.
+ */
+bool
+subprojects_prefetch(struct workspace *wk, const char *subprojects_dir, uint32_t job_count)
+{
+	struct subprojects_reached_ctx ctx = {
+		.subprojects_dir = subprojects_dir,
+		.names = make_obj(wk, obj_array),
+		.dirs = make_obj(wk, obj_array),
+		.force_fallback = get_option_wrap_mode(wk) == wrap_mode_forcefallback,
+	};
+	get_option_value(wk, current_project(wk), "force_fallback_for", &ctx.force_fallback_for);
+
+	obj_array_push(wk, ctx.dirs, current_project(wk)->source_root);
+	for (uint32_t i = 0; i < get_obj_array(wk, ctx.dirs)->len; ++i) {
+		subprojects_reached_scan(wk, &ctx, get_cstr(wk, obj_array_index(wk, ctx.dirs, i)));
+	}
+
+	if (!get_obj_array(wk, ctx.names)->len) {
+		return true;
+	}
+
+	obj res;
+	return subprojects_process(wk,
+		ctx.names,
+		&(struct subprojects_process_opts){
+			.wrap_mode = wrap_handle_mode_default,
+			.job_count = job_count,
+			.subprojects_dir = subprojects_dir,
+			.res = &res,
+			.early_out_if_meson_build_exists = true,
+		});
+}
+
 static int32_t
 subprojects_array_sort_func(struct workspace *wk, void *_ctx, obj a, obj b)
 {
@@ -294,6 +294,10 @@ func_modue_toolchain_register_component_common(struct workspace *wk, enum toolch
 		return true;
 	}
 
+	// Load the builtin toolchains first so that they keep their place in
+	// the registry.
+	workspace_init_toolchain_runtime(wk);
+
 	const struct toolchain_registry_component *inherit = 0;
 	struct toolchain_registry_component base;
 	{
@@ -99,6 +99,16 @@ FUNC_IMPL(module_util, exit, 0, func_impl_flag_impure)
 	return true;
 }
 
+FUNC_IMPL(module_util, object_count, tc_number, func_impl_flag_impure, .desc = "return the number of objects allocated so far")
+{
+	if (!pop_args(wk, NULL, NULL)) {
+		return false;
+	}
+
+	*res = make_number(wk, wk->vm.objects.objs.len);
+	return true;
+}
+
 FUNC_REGISTER(module_util)
 {
 	if (lang_mode == language_internal) {
@@ -106,5 +116,6 @@ FUNC_REGISTER(module_util)
 		FUNC_IMPL_REGISTER(module_util, serial_dump);
 		FUNC_IMPL_REGISTER(module_util, serial_load);
 		FUNC_IMPL_REGISTER(module_util, exit);
+		FUNC_IMPL_REGISTER(module_util, object_count);
 	}
 }
@@ -28,13 +28,11 @@ FUNC_IMPL(run_result, returncode, tc_number, func_impl_flag_impure)
 	}
 
 	if (!ensure_valid_run_result(wk, self, log_warn)) {
-		*res = make_obj(wk, obj_number);
-		set_obj_number(wk, *res, -1);
+		*res = make_number(wk, -1);
 		return true;
 	}
 
-	*res = make_obj(wk, obj_number);
-	set_obj_number(wk, *res, get_obj_run_result(wk, self)->status);
+	*res = make_number(wk, get_obj_run_result(wk, self)->status);
 	return true;
 }
 
@@ -337,8 +337,7 @@ FUNC_IMPL(string, to_int, tc_number)
 		return false;
 	}
 
-	*res = make_obj(wk, obj_number);
-	set_obj_number(wk, *res, n);
+	*res = make_number(wk, n);
 	return true;
 }
 
@@ -244,9 +244,9 @@ print_scope_stack(struct workspace *wk)
 				}
 			} else {
 				obj_array_for(wk, scope_group, scope) {
-					struct az_assignment *assign = bucket_arr_get(&assignments, v);
 					L("    scope group:");
 					obj_dict_for(wk, scope, k, v) {
+						struct az_assignment *assign = bucket_arr_get(&assignments, v);
 						LO("      %o: %s %o\n", k, assign->accessed ? "a" : "_", assign->o);
 					}
 				}
@@ -1547,6 +1547,15 @@ analyze_opts_push_override(struct workspace *wk,
 		return true;
 	}
 
+	obj existing;
+	if (obj_dict_index(wk, opts->file_override, path, &existing)) {
+		// Reuse the slot from an earlier override of the same file
+		// rather than growing file_override_src on every edit.
+		idx = existing;
+		src = arr_get(&opts->file_override_src, idx);
+		*src = (struct source){ 0 };
+	}
+
 	if (!src) {
 		idx = opts->file_override_src.len;
 		arr_push(wk->a, &opts->file_override_src, &(struct source){ 0 });
@@ -1688,6 +1697,9 @@ do_analyze(struct workspace *wk, struct az_opts *opts)
 	} else {
 		workspace_init_runtime(wk);
 		workspace_init_startup_files(wk);
+		// Load these up front rather than from within the analysis.
+		workspace_init_toolchain_runtime(wk);
+		workspace_init_dependency_runtime(wk);
 
 		{
 			obj wrap_mode;
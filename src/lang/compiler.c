@@ -87,17 +87,18 @@ vm_visit_nodes(struct workspace *wk,
 				prev = n;
 				n = 0;
 			} else {
-				arr_push(wk->a, &wk->vm.compiler_state.node_stack, &n);
-				n = n->l;
+				arr_push(wk->a, &wk->vm.compiler_state.node_stack, &n->id);
+				n = node_l(wk, n);
 			}
 		} else {
-			peek = *(struct node **)arr_peek(&wk->vm.compiler_state.node_stack, 1);
-			if (peek->r && prev != peek->r) {
-				n = peek->r;
+			peek = node_get(wk, *(uint32_t *)arr_peek(&wk->vm.compiler_state.node_stack, 1));
+			if (peek->r && node_id(prev) != peek->r) {
+				n = node_r(wk, peek);
 			} else {
 				push_location(wk, peek);
 				cb(wk, peek);
-				prev = *(struct node **)arr_pop(&wk->vm.compiler_state.node_stack);
+				arr_pop(&wk->vm.compiler_state.node_stack);
+				prev = peek;
 			}
 		}
 	}
@@ -121,18 +122,35 @@ push_constant_at(obj v, uint8_t *code)
 static void
 push_constant(struct workspace *wk, obj v)
 {
+	assert(v <= 0xffffff && "constant does not fit in an operand");
 	v = vm_constant_host_to_bc(v);
 	push_code(wk, (v >> 16) & 0xff);
 	push_code(wk, (v >> 8) & 0xff);
 	push_code(wk, v & 0xff);
 }
 
+static uint32_t
+vm_comp_global_slot(struct workspace *wk, obj id)
+{
+	const struct str *name = get_str(wk, id);
+	uint64_t *slot;
+
+	if ((slot = hash_get_strn(&wk->vm.compiler_state.global_slot_names, name->s, name->len))) {
+		return *slot;
+	}
+
+	arr_push(wk->a, &wk->vm.global_slots, &(struct vm_global_slot){ 0 });
+	hash_set_strn(wk->a, &wk->vm.compiler_state.global_slot_names, name->s, name->len, wk->vm.global_slots.len);
+	return wk->vm.global_slots.len;
+}
+
 static void
 vm_comp_assign_global(struct workspace *wk, obj id, enum node_assign_flag flags)
 {
 	push_code(wk, op_constant);
 	push_constant(wk, id);
 	push_code(wk, (flags & node_assign_flag_add_store) ? op_add_store_g : op_store_g);
+	push_constant(wk, vm_comp_global_slot(wk, id));
 }
 
 static void
@@ -504,18 +522,19 @@ vm_comp_block_locals_visitor(struct workspace *wk, struct node *n)
 	{
 	case node_type_assign: {
 		if (!(n->data.type & node_assign_flag_member) && !(n->data.type & node_assign_flag_add_store)) {
-			assert(n->l->type == node_type_id_lit);
-			obj id = n->l->data.str;
+			struct node *id = node_l(wk, n);
+			assert(id->type == node_type_id_lit);
 			if (n->data.type & node_assign_flag_force_declaration) {
-				vm_comp_force_declare_local(wk, n->l, id, false);
+				vm_comp_force_declare_local(wk, id, id->data.str, false);
 			} else {
-				vm_comp_try_declare_local(wk, n->l, id);
+				vm_comp_try_declare_local(wk, id, id->data.str);
 			}
 		}
 		break;
 	}
 	case node_type_foreach: {
-		struct node *ida = n->l->l->l, *idb = n->l->l->r;
+		struct node *ids = node_l(wk, node_l(wk, n));
+		struct node *ida = node_l(wk, ids), *idb = node_r(wk, ids);
 		vm_comp_force_declare_local(wk, ida, ida->data.str, true);
 		if (idb) {
 			 vm_comp_force_declare_local(wk, idb, idb->data.str, true);
@@ -523,7 +542,7 @@ vm_comp_block_locals_visitor(struct workspace *wk, struct node *n)
 		break;
 	}
 	case node_type_func_def: {
-		struct node *id = n->l->l->l;
+		struct node *id = node_l(wk, node_l(wk, node_l(wk, n)));
 		if (id) {
 			vm_comp_try_declare_local(wk, id, id->data.str);
 		}
@@ -551,8 +570,8 @@ vm_comp_block_locals(struct workspace *wk, struct node *n)
 	// means that the compiler will still error if you try to use a var
 	// before it is assigned.
 	while (n && n->l) {
-		vm_visit_nodes(wk, n->l, privelaged, ARRAY_LEN(privelaged), vm_comp_block_locals_visitor);
-		n = n->r;
+		vm_visit_nodes(wk, node_l(wk, n), privelaged, ARRAY_LEN(privelaged), vm_comp_block_locals_visitor);
+		n = node_r(wk, n);
 	}
 }
 
@@ -693,6 +712,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 			push_code(wk, op_constant);
 			push_constant(wk, n->data.str);
 			push_code(wk, op_load_g);
+			push_constant(wk, vm_comp_global_slot(wk, n->data.str));
 		}
 		break;
 	}
@@ -705,8 +725,8 @@ vm_comp_node(struct workspace *wk, struct node *n)
 	case node_type_number:
 		push_code(wk, op_constant);
 		obj o;
-		o = make_obj(wk, obj_number);
-		set_obj_number(wk, o, n->data.num);
+		// constants are limited to 24 bits, so immediates can't be used here
+		o = make_number_boxed(wk, n->data.num);
 		push_constant(wk, o);
 		break;
 	case node_type_bool:
@@ -734,26 +754,30 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		if (flags & node_assign_flag_member) {
 			push_code(wk, (flags & node_assign_flag_add_store) ? op_add_store_m : op_store_m);
 		} else if (wk->vm.compiler_state.mode & vm_compile_mode_locals) {
-			assert(n->l->type == node_type_id_lit);
-			vm_comp_assign_local(wk, n->l, n->l->data.str, flags);
+			struct node *id = node_l(wk, n);
+			assert(id->type == node_type_id_lit);
+			vm_comp_assign_local(wk, id, id->data.str, flags);
 		} else {
-			assert(n->l->type == node_type_id_lit);
-			vm_comp_assign_global(wk, n->l->data.str, flags);
+			struct node *id = node_l(wk, n);
+			assert(id->type == node_type_id_lit);
+			vm_comp_assign_global(wk, id->data.str, flags);
 		}
 		break;
 	}
 	case node_type_member: {
 		push_code(wk, op_member);
-		push_constant(wk, n->r->data.str);
+		push_constant(wk, node_r(wk, n)->data.str);
+		push_constant(wk, 0);
 		break;
 	}
 	case node_type_call: {
 		bool known = false;
 		const struct str *name = 0;
 		uint32_t idx;
+		struct node *args = node_l(wk, n), *callee = node_r(wk, n);
 
-		if (n->r->type == node_type_id_lit) {
-			name = get_str(wk, n->r->data.str);
+		if (callee->type == node_type_id_lit) {
+			name = get_str(wk, callee->data.str);
 
 			if (wk->vm.compiler_state.lang == build_language_meson) {
 				if (str_eql(name, &STR("subdir_done"))) {
@@ -761,7 +785,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 
 					push_location(wk, n);
 
-					vm_comp_assert_inline_func_args(wk, n, n->l, 0, 0, 0);
+					vm_comp_assert_inline_func_args(wk, n, args, 0, 0, 0);
 
 					push_code(wk, op_constant);
 					push_constant(wk, 0);
@@ -774,20 +798,22 @@ vm_comp_node(struct workspace *wk, struct node *n)
 
 					push_location(wk, n);
 
-					vm_comp_assert_inline_func_args(wk, n, n->l, 2, 2, 0);
+					vm_comp_assert_inline_func_args(wk, n, args, 2, 2, 0);
 
 					push_code(wk, op_swap);
 					push_code(wk, op_store_g);
+					push_constant(wk, 0);
 					break;
 				} else if (str_eql(name, &STR("get_variable"))) {
 					vm_comp_disable_in_script_mode(wk, n);
 
 					push_location(wk, n);
 
-					vm_comp_assert_inline_func_args(wk, n, n->l, 1, 2, 0);
+					vm_comp_assert_inline_func_args(wk, n, args, 1, 2, 0);
 
-					if (n->l->data.len.args == 1) {
+					if (args->data.len.args == 1) {
 						push_code(wk, op_load_g);
+						push_constant(wk, 0);
 					} else {
 						push_code(wk, op_try_load_g);
 					}
@@ -795,7 +821,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 				} else if (str_eql(name, &STR("disabler"))) {
 					push_location(wk, n);
 
-					vm_comp_assert_inline_func_args(wk, n, n->l, 0, 0, 0);
+					vm_comp_assert_inline_func_args(wk, n, args, 0, 0, 0);
 
 					push_code(wk, op_constant);
 					push_constant(wk, obj_disabler);
@@ -812,7 +838,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 
 					push_location(wk, n);
 
-					vm_comp_assert_inline_func_args(wk, n, n->l, 1, 1, 0);
+					vm_comp_assert_inline_func_args(wk, n, args, 1, 1, 0);
 
 					push_code(wk, op_jmp_if_disabler);
 					true_jmp_tgt = wk->vm.code.len;
@@ -840,38 +866,48 @@ vm_comp_node(struct workspace *wk, struct node *n)
 				if (str_eql(name, &STR("get_variable"))) {
 					push_location(wk, n);
 
-					vm_comp_assert_inline_func_args(wk, n, n->l, 1, 1, 0);
+					vm_comp_assert_inline_func_args(wk, n, args, 1, 1, 0);
 					push_code(wk, op_constant);
 					push_constant(wk, make_str(wk, ""));
 					push_code(wk, op_try_load_g);
 					break;
 				} else if (str_eql(name, &STR("set"))) {
-					if (n->l->data.len.args == 2) {
+					if (args->data.len.args == 2) {
 						push_code(wk, op_swap);
 						push_code(wk, op_store_g);
+						push_constant(wk, 0);
 						break;
 					}
 				}
 			}
 		}
 
-		if (!known && n->r->type == node_type_id_lit) {
-			n->r->type = node_type_id;
-			push_location(wk, n->r);
-			vm_comp_node(wk, n->r);
+		if (!known && callee->type == node_type_id_lit) {
+			callee->type = node_type_id;
+			push_location(wk, callee);
+			vm_comp_node(wk, callee);
 		}
 
 		push_location(wk, n);
 
 		if (known) {
 			push_code(wk, op_call_native);
-			push_constant(wk, n->l->data.len.args);
-			push_constant(wk, n->l->data.len.kwargs);
+			push_constant(wk, args->data.len.args);
+			push_constant(wk, args->data.len.kwargs);
 			push_constant(wk, idx);
+
+			if (args->data.len.kwargs) {
+				push_constant(wk, wk->vm.kwarg_slots.len + 1);
+				for (uint32_t i = 0; i < args->data.len.kwargs; ++i) {
+					arr_push(wk->a, &wk->vm.kwarg_slots, &(struct vm_kwarg_slot){ 0 });
+				}
+			} else {
+				push_constant(wk, 0);
+			}
 		} else {
 			push_code(wk, op_call);
-			push_constant(wk, n->l->data.len.args);
-			push_constant(wk, n->l->data.len.kwargs);
+			push_constant(wk, args->data.len.args);
+			push_constant(wk, args->data.len.kwargs);
 		}
 
 		if (known && (wk->vm.compiler_state.mode & vm_compile_mode_return_after_project)
@@ -915,9 +951,10 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		 *    <----------------`
 		 */
 		uint32_t break_jmp_patch_tgt, loop_body_start;
-		struct node *ida = n->l->l->l, *idb = n->l->l->r;
+		struct node *foreach_args = node_l(wk, n), *ids = node_l(wk, foreach_args);
+		struct node *ida = node_l(wk, ids), *idb = node_r(wk, ids);
 
-		vm_compile_expr(wk, n->l->r);
+		vm_compile_expr(wk, node_r(wk, foreach_args));
 
 		push_location(wk, n);
 
@@ -959,7 +996,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		arr_push(wk->a, &wk->vm.compiler_state.loop_jmp_stack, &loop_body_start);
 
 		++wk->vm.compiler_state.loop_depth;
-		vm_compile_block(wk, n->r, 0);
+		vm_compile_block(wk, node_r(wk, n), 0);
 		--wk->vm.compiler_state.loop_depth;
 
 		push_code(wk, op_jmp);
@@ -1038,8 +1075,9 @@ vm_comp_node(struct workspace *wk, struct node *n)
 				obj_array_push(wk, az_branches, make_az_branch_element(wk, wk->vm.code.len, 0));
 			}
 
-			if (n->l->l) {
-				vm_compile_expr(wk, n->l->l);
+			struct node *branch = node_l(wk, n);
+			if (branch->l) {
+				vm_compile_expr(wk, node_l(wk, branch));
 				push_code(wk, op_jmp_if_disabler);
 				arr_push(wk->a, &wk->vm.compiler_state.if_jmp_stack, &wk->vm.code.len);
 				++patch_tgts;
@@ -1050,18 +1088,18 @@ vm_comp_node(struct workspace *wk, struct node *n)
 				push_constant(wk, 0);
 			}
 
-			vm_compile_block(wk, n->l->r, 0);
+			vm_compile_block(wk, node_r(wk, branch), 0);
 
 			push_code(wk, op_jmp);
 			arr_push(wk->a, &wk->vm.compiler_state.if_jmp_stack, &wk->vm.code.len);
 			++patch_tgts;
 			push_constant(wk, 0);
 
-			if (n->l->l) {
+			if (branch->l) {
 				push_constant_at(wk->vm.code.len, arr_get(&wk->vm.code, else_jmp));
 			}
 
-			n = n->r;
+			n = node_r(wk, n);
 		}
 
 		for (uint32_t i = 0; i < patch_tgts; ++i) {
@@ -1085,7 +1123,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		 */
 		uint32_t else_jmp, end_jmp[3] = { 0 };
 
-		vm_compile_expr(wk, n->l);
+		vm_compile_expr(wk, node_l(wk, n));
 
 		obj az_branches = 0;
 		if (wk->vm.in_analyzer) {
@@ -1113,7 +1151,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 			else_jmp = wk->vm.code.len;
 			push_constant(wk, 0);
 
-			vm_compile_expr(wk, n->r->l);
+			vm_compile_expr(wk, node_l(wk, node_r(wk, n)));
 			push_code(wk, op_jmp);
 			end_jmp[1] = wk->vm.code.len;
 			push_constant(wk, 0);
@@ -1127,7 +1165,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 			}
 			push_constant_at(wk->vm.code.len, arr_get(&wk->vm.code, else_jmp));
 
-			vm_compile_expr(wk, n->r->r);
+			vm_compile_expr(wk, node_r(wk, node_r(wk, n)));
 		}
 
 		push_constant_at(wk->vm.code.len, arr_get(&wk->vm.code, end_jmp[0]));
@@ -1153,7 +1191,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		 */
 
 		uint32_t jmp1, end_jmp[2] = { 0 };
-		vm_compile_expr(wk, n->l);
+		vm_compile_expr(wk, node_l(wk, n));
 
 		if (wk->vm.in_analyzer) {
 			obj az_branches = 0;
@@ -1186,7 +1224,7 @@ vm_comp_node(struct workspace *wk, struct node *n)
 
 		push_code(wk, op_pop);
 
-		vm_compile_expr(wk, n->r);
+		vm_compile_expr(wk, node_r(wk, n));
 		push_code(wk, op_typecheck);
 		push_constant(wk, obj_bool);
 
@@ -1214,7 +1252,8 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		func_jump_over_patch_tgt = wk->vm.code.len;
 		push_constant(wk, 0);
 
-		struct node *id = n->l->l->l;
+		struct node *sig = node_l(wk, n), *name = node_l(wk, sig);
+		struct node *id = node_l(wk, name);
 
 		if (id) {
 			// If this function is written with an id resolve it here before
@@ -1231,16 +1270,18 @@ vm_comp_node(struct workspace *wk, struct node *n)
 
 		vm_comp_push_call_frame(wk);
 
-		for (arg = n->l->r; arg; arg = arg->r) {
-			if (!arg->l) {
+		for (arg = node_r(wk, sig); arg; arg = node_r(wk, arg)) {
+			struct node *param = node_l(wk, arg);
+			if (!param) {
 				break;
 			}
 
-			if (arg->l->type == node_type_kw) {
-				vm_comp_declare_local(wk, arg->l->r, arg->l->r->data.str);
+			if (param->type == node_type_kw) {
+				struct node *key = node_r(wk, param);
+				vm_comp_declare_local(wk, key, key->data.str);
 				++func->nkwargs;
 			} else {
-				vm_comp_declare_local(wk, arg->l, arg->l->data.str);
+				vm_comp_declare_local(wk, param, param->data.str);
 				++func->nargs;
 			}
 
@@ -1248,9 +1289,9 @@ vm_comp_node(struct workspace *wk, struct node *n)
 			l->bound = true;
 		}
 
-		vm_comp_block_locals(wk, n->r);
+		vm_comp_block_locals(wk, node_r(wk, n));
 
-		vm_compile_block(wk, n->r, vm_compile_block_final_return);
+		vm_compile_block(wk, node_r(wk, n), vm_compile_block_final_return);
 		struct compiler_call_frame *frame = vm_comp_pop_call_frame(wk);
 		vm_comp_init_func(wk, func, frame, func->nargs, func->nkwargs);
 
@@ -1259,31 +1300,32 @@ vm_comp_node(struct workspace *wk, struct node *n)
 		push_constant_at(wk->vm.code.len, arr_get(&wk->vm.code, func_jump_over_patch_tgt));
 
 		uint32_t kwarg_i = 0, arg_i = 0;
-		for (arg = n->l->r; arg; arg = arg->r) {
-			if (!arg->l) {
+		for (arg = node_r(wk, sig); arg; arg = node_r(wk, arg)) {
+			struct node *param = node_l(wk, arg);
+			if (!param) {
 				break;
 			}
 
-			if (arg->l->type == node_type_kw) {
-				struct node *doc = arg->l->r->r;
+			if (param->type == node_type_kw) {
+				struct node *key = node_r(wk, param), *doc = node_r(wk, key);
 				func->akw[kwarg_i] = (struct args_kw){
-					.key = get_cstr(wk, arg->l->r->data.str),
-					.type = arg->l->r->l->data.type,
+					.key = get_cstr(wk, key->data.str),
+					.type = node_l(wk, key)->data.type,
 					.desc = doc ? get_cstr(wk, doc->data.str) : 0,
 				};
 				++kwarg_i;
 
-				if (arg->l->l) {
-					vm_compile_expr(wk, arg->l->l);
+				if (param->l) {
+					vm_compile_expr(wk, node_l(wk, param));
 					push_code(wk, op_constant);
-					push_constant(wk, arg->l->r->data.str);
+					push_constant(wk, key->data.str);
 					++ndefargs;
 				}
 			} else {
-				struct node *doc = arg->l->r;
+				struct node *doc = node_r(wk, param);
 				func->an[arg_i] = (struct args_norm){
-					.name = get_cstr(wk, arg->l->data.str),
-					.type = arg->l->l->data.type,
+					.name = get_cstr(wk, param->data.str),
+					.type = node_l(wk, param)->data.type,
 					.desc = doc ? get_cstr(wk, doc->data.str) : 0,
 				};
 				++arg_i;
@@ -1298,8 +1340,8 @@ vm_comp_node(struct workspace *wk, struct node *n)
 			push_constant(wk, 0);
 		}
 
-		struct node *doc = n->l->l->r;
-		push_location(wk, id ? id : n->l);
+		struct node *doc = node_r(wk, name);
+		push_location(wk, id ? id : sig);
 
 		func->def = wk->vm.code.len;
 
@@ -1367,29 +1409,30 @@ vm_compile_block(struct workspace *wk, struct node *n, enum vm_compile_block_fla
 	while (n && n->l) {
 		assert(n->type == node_type_stmt);
 		uint32_t expr_start = wk->vm.code.len;
+		struct node *expr = node_l(wk, n), *next = node_r(wk, n);
 
-		vm_compile_expr(wk, n->l);
+		vm_compile_expr(wk, expr);
 
 		if (wk->vm.in_analyzer) {
 			if (!vm_op_range_had_effect(wk, expr_start, wk->vm.code.len)) {
-				vm_comp_warning(wk, n->l, "statment has no effect");
+				vm_comp_warning(wk, expr, "statment has no effect");
 			}
 		}
 
-		if (n->l->type == node_type_if) {
+		if (expr->type == node_type_if) {
 			// don't pop
-		} else if ((flags & vm_compile_block_expr) && !(n->r && n->r->l)) {
+		} else if ((flags & vm_compile_block_expr) && !(next && next->l)) {
 			// don't pop
 		} else {
 			push_code(wk, op_pop);
 		}
 
 		prev = n;
-		n = n->r;
+		n = next;
 	}
 
 	if (flags & vm_compile_block_final_return) {
-		if (prev && prev->l->type == node_type_return) {
+		if (prev && node_l(wk, prev)->type == node_type_return) {
 			--wk->vm.code.len;
 			wk->vm.code.e[wk->vm.code.len - 1] = op_return_end;
 		} else {
@@ -1403,10 +1446,24 @@ vm_compile_block(struct workspace *wk, struct node *n, enum vm_compile_block_fla
 	}
 }
 
+/* Nodes are only needed until the ast has been compiled, so they are allocated
+ * from a_scratch.  Callers should reset after workspace_scratch_begin and
+ * release before the matching workspace_scratch_end. */
 void
 vm_compile_state_reset(struct workspace *wk)
 {
-	bucket_arr_clear(&wk->vm.compiler_state.nodes);
+	struct vm_compiler_state *cs = &wk->vm.compiler_state;
+	bucket_arr_init(wk->a_scratch, &cs->nodes, 2048, struct node);
+	// Index 0 is reserved to mean "no node".
+	bucket_arr_push(wk->a_scratch, &cs->nodes, &(struct node){ 0 });
+	cs->node_fmt = (struct arr){ 0 };
+}
+
+void
+vm_compile_state_release(struct workspace *wk)
+{
+	wk->vm.compiler_state.nodes = (struct bucket_arr){ 0 };
+	wk->vm.compiler_state.node_fmt = (struct arr){ 0 };
 }
 
 bool vm_compile_ast(struct workspace *wk, struct node *n, const struct vm_compile_opts *opts, uint32_t *entry)
@@ -1503,7 +1560,9 @@ bool vm_compile_ast(struct workspace *wk, struct node *n, const struct vm_compil
 bool vm_compile(struct workspace *wk, const struct source *src, const struct vm_compile_opts *opts, uint32_t *entry)
 {
 	struct node *n = 0;
+	bool ok = false;
 
+	workspace_scratch_begin(wk);
 	vm_compile_state_reset(wk);
 
 	switch (opts->lang) {
@@ -1513,8 +1572,11 @@ bool vm_compile(struct workspace *wk, const struct source *src, const struct vm_
 
 	if (!n) {
 		wk->vm.compiler_state.err = true;
-		return false;
+	} else {
+		ok = vm_compile_ast(wk, n, opts, entry);
 	}
 
-	return vm_compile_ast(wk, n, opts, entry);
+	vm_compile_state_release(wk);
+	workspace_scratch_end(wk);
+	return ok;
 }
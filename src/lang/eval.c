@@ -83,9 +83,10 @@ cleanup:
 static bool
 ensure_project_is_first_statement(struct workspace *wk, const struct source *src, struct node *n, bool check_only)
 {
-	bool first_statement_is_a_call_to_project = n->type == node_type_stmt && n->l && n->l->type == node_type_call
-						    && n->l->r && n->l->r->type == node_type_id_lit
-						    && str_eql(get_str(wk, n->l->r->data.str), &STR("project"));
+	struct node *call = node_l(wk, n), *id = call ? node_r(wk, call) : 0;
+	bool first_statement_is_a_call_to_project = n->type == node_type_stmt && call && call->type == node_type_call
+						    && id && id->type == node_type_id_lit
+						    && str_eql(get_str(wk, id->data.str), &STR("project"));
 
 	if (!first_statement_is_a_call_to_project) {
 		if (!check_only) {
@@ -133,8 +134,8 @@ eval(struct workspace *wk, const struct source *src, const struct eval_opts *opt
 	{
 		struct node *n = 0;
 
-		vm_compile_state_reset(wk);
 		workspace_scratch_begin(wk);
+		vm_compile_state_reset(wk);
 		workspace_push_lang_mode(wk, opts->lang_mode);
 
 		bool ok = false;
@@ -163,6 +164,7 @@ eval(struct workspace *wk, const struct source *src, const struct eval_opts *opt
 		ok = true;
 compile_done:
 		workspace_pop_lang_mode(wk);
+		vm_compile_state_release(wk);
 		workspace_scratch_end(wk);
 
 
@@ -459,18 +461,20 @@ determine_project_root(struct workspace *wk, const char *path)
 
 		if (!fs_read_entire_file(wk->a_scratch, path, &src)) {
 			goto cont;
-		} else if (!(n = parse(wk, &src, vm_compile_mode_quiet | vm_compile_mode_relaxed_parse))) {
+		}
+
+		bool found;
+		vm_compile_state_reset(wk);
+		if ((n = parse(wk, &src, vm_compile_mode_quiet | vm_compile_mode_relaxed_parse))) {
+			found = ensure_project_is_first_statement(wk, 0, n, true);
+		} else {
 			// If we failed to parse this file, try just searching for the string project(
 			struct str src_str = { src.src, src.len };
-			if (str_startswith(&src_str, &STR("project(")) || str_contains(&src_str, &STR("\nproject("))) {
-				goto found;
-			}
-			goto cont;
+			found = str_startswith(&src_str, &STR("project(")) || str_contains(&src_str, &STR("\nproject("));
 		}
+		vm_compile_state_release(wk);
 
-		if (ensure_project_is_first_statement(wk, 0, n, true)) {
-found:
-			// found
+		if (found) {
 			path_dirname(wk, &tmp, path);
 			obj s = tstr_into_str(wk, &tmp);
 			return get_cstr(wk, s);
@@ -146,7 +146,7 @@ fmt_obj_as_simple_str(struct fmt_ctx *f, obj s)
 	n_str_stmt = parse(f->wk, &(struct source){ .src = str->s, .len = str->len }, 0);
 
 	assert(n_str_stmt && n_str_stmt->type == node_type_stmt && n_str_stmt->l);
-	n_str = n_str_stmt->l;
+	n_str = node_l(f->wk, n_str_stmt);
 
 	if (n_str->type != node_type_string) {
 		return 0;
@@ -844,28 +844,32 @@ fmt_list(struct fmt_ctx *f, struct node *n, struct fmt_frag *fr, enum fmt_list_f
 	bool is_func_with_single_arg = false;
 
 	while (true) {
-		if (n->l) {
+		struct node *elem = node_l(f->wk, n);
+		if (elem) {
 			prev = child;
 			child = fmt_frag(f, fmt_frag_type_expr);
 			arr_push(f->wk->a, &f->list_tmp, &child);
 
-			if (n->l->type == node_type_kw) {
+			if (elem->type == node_type_kw) {
+				struct node *key = node_r(f->wk, elem), *val = node_l(f->wk, elem);
+
 				if (f->opts.kwargs_force_multiline) {
 					fr->force_ml = true;
 				}
 
-				next = fmt_frag_child(&child->child, fmt_node(f, n->l->r));
+				next = fmt_frag_child(&child->child, fmt_node(f, key));
 
 				// Move the child's ws up one level and grab
 				// post_ws if we have it.
 				fmt_frag_move_ws(child, child->child);
-				if (n->l->fmt.post.list) {
-					fmt_node_ws(f, n->l, &n->l->fmt.post, &child->post_ws);
+				const struct node_fmt *elem_fmt = node_fmt(f->wk, elem);
+				if (elem_fmt->post.list) {
+					fmt_node_ws(f, elem, &elem_fmt->post, &child->post_ws);
 				}
 
-				if (type == node_type_def_args && n->l->r->l->data.type) {
+				if (type == node_type_def_args && node_l(f->wk, key)->data.type) {
 					next = fmt_frag_child(&child->child,
-						fmt_frag_s(f, typechecking_type_to_s(f->wk, n->l->r->l->data.type)));
+						fmt_frag_s(f, typechecking_type_to_s(f->wk, node_l(f->wk, key)->data.type)));
 					next->flags |= fmt_frag_flag_stick_line_left;
 				}
 
@@ -877,13 +881,13 @@ fmt_list(struct fmt_ctx *f, struct node *n, struct fmt_frag *fr, enum fmt_list_f
 				}
 
 				// node_type_list is a placeholder for keys with no value
-				if (n->l->l->type != node_type_list) {
+				if (val->type != node_type_list) {
 					next = fmt_frag_child(&child->child, fmt_frag(f, fmt_frag_type_expr));
 					next->flags |= fmt_frag_flag_stick_line_left;
-					fmt_frag_child(&next->child, fmt_node(f, n->l->l));
+					fmt_frag_child(&next->child, fmt_node(f, val));
 				}
 			} else {
-				fmt_frag_child(&child->child, fmt_node(f, n->l));
+				fmt_frag_child(&child->child, fmt_node(f, elem));
 
 				// Move the child's ws up one level
 				fmt_frag_move_ws(child, child->child);
@@ -905,9 +909,9 @@ fmt_list(struct fmt_ctx *f, struct node *n, struct fmt_frag *fr, enum fmt_list_f
 					}
 				}
 
-				if (type == node_type_def_args && n->l->l->data.type) {
+				if (type == node_type_def_args && node_l(f->wk, elem)->data.type) {
 					next = fmt_frag_sibling(child->child,
-						fmt_frag_s(f, typechecking_type_to_s(f->wk, n->l->l->data.type)));
+						fmt_frag_s(f, typechecking_type_to_s(f->wk, node_l(f->wk, elem)->data.type)));
 					next->flags |= fmt_frag_flag_stick_line_left;
 				}
 			}
@@ -919,15 +923,16 @@ fmt_list(struct fmt_ctx *f, struct node *n, struct fmt_frag *fr, enum fmt_list_f
 			break;
 		}
 
-		if (n->r->fmt.pre.list) {
+		const struct node_fmt *next_fmt = node_fmt(f->wk, node_r(f->wk, n));
+		if (next_fmt->pre.list) {
 			// this means we got whitespace before the ,
 			// Add it to the trailing whitespace for the current child
-			fmt_node_ws(f, n, &n->r->fmt.pre, &child->post_ws);
+			fmt_node_ws(f, n, &next_fmt->pre, &child->post_ws);
 		}
 
 		assert(!child->str);
 		child->str = make_str(f->wk, ",");
-		n = n->r;
+		n = node_r(f->wk, n);
 
 		if (!n->r && !n->l) {
 			// trailing comma
@@ -940,8 +945,8 @@ fmt_list(struct fmt_ctx *f, struct node *n, struct fmt_frag *fr, enum fmt_list_f
 		is_func_with_single_arg = (flags & fmt_list_flag_func_args) && len == 1;
 
 		if (is_func_with_single_arg) {
-			if (n->l->type == node_type_string
-				&& str_startswith(get_str(f->wk, n->l->data.str), &STR("'''"))) {
+			struct node *arg = node_l(f->wk, n);
+			if (arg->type == node_type_string && str_startswith(get_str(f->wk, arg->data.str), &STR("'''"))) {
 				fr->flags |= fmt_frag_flag_force_single_line;
 			}
 		}
@@ -987,16 +992,18 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 {
 	assert(n->type != node_type_stmt);
 	struct fmt_frag *fr, *res, *next;
+	struct node *l = node_l(f->wk, n), *r = node_r(f->wk, n);
 
 	res = fr = fmt_frag(f, fmt_frag_type_expr);
 	fr->node_type = n->type;
 
-	if (n->fmt.pre.list) {
-		fmt_node_ws(f, n, &n->fmt.pre, &fr->pre_ws);
+	const struct node_fmt *fmt = node_fmt(f->wk, n);
+	if (fmt->pre.list) {
+		fmt_node_ws(f, n, &fmt->pre, &fr->pre_ws);
 	}
 
-	if (n->fmt.post.list) {
-		fmt_node_ws(f, n, &n->fmt.post, &res->post_ws);
+	if (fmt->post.list) {
+		fmt_node_ws(f, n, &fmt->post, &res->post_ws);
 	}
 
 	// L("formatting %p:%s", (void *)n, node_to_s(f->wk, n));
@@ -1021,8 +1028,8 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 	}
 	case node_type_return: {
 		fr->str = make_str(f->wk, fmt_node_to_token(n->type));
-		if (n->l) {
-			next = fmt_frag_sibling(fr, fmt_node(f, n->l));
+		if (l) {
+			next = fmt_frag_sibling(fr, fmt_node(f, l));
 			next->flags |= fmt_frag_flag_stick_line_left;
 		}
 		break;
@@ -1066,13 +1073,13 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 	case node_type_negate: {
 		fr->str = make_str(f->wk, "-");
 		fr->flags |= fmt_frag_flag_stick_right;
-		next = fmt_frag_sibling(fr, fmt_node(f, n->l));
+		next = fmt_frag_sibling(fr, fmt_node(f, l));
 		break;
 	}
 	case node_type_not: {
 		fr->str = make_str(f->wk, "not");
 		fr->flags |= fmt_frag_flag_stick_line_right;
-		next = fmt_frag_sibling(fr, fmt_node(f, n->l));
+		next = fmt_frag_sibling(fr, fmt_node(f, l));
 		break;
 	}
 	case node_type_assign:
@@ -1104,22 +1111,22 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 		struct node *rhs;
 
 		if (is_member_assign) {
-			res = fr = fmt_node(f, n->r->l);
-			if (n->l->type == node_type_id_lit) {
+			res = fr = fmt_node(f, node_l(f->wk, r));
+			if (l->type == node_type_id_lit) {
 				next = fmt_frag_sibling(fr, fmt_frag_s(f, "."));
 				next->flags |= fmt_frag_flag_stick_left;
-				next = fmt_frag_sibling(fr, fmt_node(f, n->l));
+				next = fmt_frag_sibling(fr, fmt_node(f, l));
 				next->flags |= fmt_frag_flag_stick_left;
 			} else {
 				next = fmt_frag_sibling(fr, fmt_frag(f, fmt_frag_type_expr));
 				next->enclosing = "[]";
 				next->flags |= fmt_frag_flag_stick_left;
-				fmt_frag_child(&next->child, fmt_node(f, n->l));
+				fmt_frag_child(&next->child, fmt_node(f, l));
 			}
-			rhs = n->r->r;
+			rhs = node_r(f->wk, r);
 		} else {
-			res = fr = fmt_node(f, n->l);
-			rhs = n->r;
+			res = fr = fmt_node(f, l);
+			rhs = r;
 		}
 
 		next = fmt_frag_sibling(fr, fmt_frag_s(f, token));
@@ -1141,16 +1148,16 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 		break;
 	}
 	case node_type_index: {
-		res = fr = fmt_node(f, n->l);
+		res = fr = fmt_node(f, l);
 		next = fmt_frag_sibling(fr, fmt_frag(f, fmt_frag_type_expr));
 		next->enclosing = "[]";
 		next->flags |= fmt_frag_flag_stick_left;
-		fmt_frag_child(&next->child, fmt_node(f, n->r));
+		fmt_frag_child(&next->child, fmt_node(f, r));
 		break;
 	}
 	case node_type_group: {
 		fr->enclosing = "()";
-		fmt_frag_child(&fr->child, fmt_node(f, n->l));
+		fmt_frag_child(&fr->child, fmt_node(f, l));
 		if (f->opts.sticky_parens) {
 			fr->child->flags |= fmt_frag_flag_stick_left;
 			fmt_frag_last_child(fr)->flags |= fmt_frag_flag_stick_right;
@@ -1172,10 +1179,10 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 		break;
 	}
 	case node_type_member: {
-		res = fr = fmt_node(f, n->l);
+		res = fr = fmt_node(f, l);
 		next = fmt_frag_sibling(fr, fmt_frag_s(f, "."));
 		next->flags |= fmt_frag_flag_stick_left;
-		next = fmt_frag_sibling(fr, fmt_node(f, n->r));
+		next = fmt_frag_sibling(fr, fmt_node(f, r));
 		next->flags |= fmt_frag_flag_stick_left;
 
 		/* fmt_list(f, n->l->l, next, fmt_list_flag_func_args); */
@@ -1184,7 +1191,7 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 		break;
 	}
 	case node_type_call: {
-		res = fr = fmt_node(f, n->r);
+		res = fr = fmt_node(f, r);
 
 		enum fmt_list_flag flags = fmt_list_flag_func_args;
 
@@ -1196,8 +1203,8 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 
 			enum fmt_special_function function = fmt_special_function_unknown;
 
-			if (n->r->type == node_type_id_lit) {
-				if (str_eql(get_str(f->wk, n->r->data.str), &STR("files"))) {
+			if (r->type == node_type_id_lit) {
+				if (str_eql(get_str(f->wk, r->data.str), &STR("files"))) {
 					function = fmt_special_function_files;
 				}
 			}
@@ -1205,7 +1212,7 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 			switch (function) {
 			case fmt_special_function_unknown: break;
 			case fmt_special_function_files: {
-				struct node *args = n->l, *arr;
+				struct node *args = l, *arr;
 
 				if (!f->opts.sort_files) {
 					goto fmt_special_function_done;
@@ -1213,8 +1220,7 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 
 				// If files() gets a single argument of type
 				// array, un-nest it.
-				if (!args->r && args->l && args->l->type == node_type_array) {
-					arr = args->l;
+				if (!args->r && args->l && (arr = node_l(f->wk, args))->type == node_type_array) {
 					args->l = arr->l;
 					args->r = arr->r;
 				}
@@ -1222,10 +1228,10 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 				bool all_elements_are_simple_strings = true;
 
 				while (true) {
-					if (args->l) {
-						if (args->l->type != node_type_string
-							|| str_startswith(
-								get_str(f->wk, args->l->data.str), &STR("f"))) {
+					struct node *elem = node_l(f->wk, args);
+					if (elem) {
+						if (elem->type != node_type_string
+							|| str_startswith(get_str(f->wk, elem->data.str), &STR("f"))) {
 							all_elements_are_simple_strings = false;
 							break;
 						}
@@ -1235,7 +1241,7 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 						break;
 					}
 
-					args = args->r;
+					args = node_r(f->wk, args);
 				}
 
 				if (all_elements_are_simple_strings) {
@@ -1249,20 +1255,20 @@ fmt_node(struct fmt_ctx *f, struct node *n)
 fmt_special_function_done:
 
 		next = fmt_frag_sibling(fr, fmt_frag(f, fmt_frag_type_expr));
-		fmt_list(f, n->l, next, flags);
+		fmt_list(f, l, next, flags);
 		next->enclosing = "()";
 		next->flags |= fmt_frag_flag_stick_left;
 		break;
 	}
 	case node_type_ternary: {
-		res = fr = fmt_node(f, n->l);
+		res = fr = fmt_node(f, l);
 		next = fmt_frag_sibling(fr, fmt_frag_s(f, "?"));
 		next->flags |= fmt_frag_flag_stick_line_left;
-		next = fmt_frag_sibling(fr, fmt_node(f, n->r->l));
+		next = fmt_frag_sibling(fr, fmt_node(f, node_l(f->wk, r)));
 		next->flags |= fmt_frag_flag_stick_line_left;
 		next = fmt_frag_sibling(fr, fmt_frag_s(f, ":"));
 		next->flags |= fmt_frag_flag_stick_line_left;
-		next = fmt_frag_sibling(fr, fmt_node(f, n->r->r));
+		next = fmt_frag_sibling(fr, fmt_node(f, node_r(f->wk, r)));
 		next->flags |= fmt_frag_flag_stick_line_left;
 		break;
 	}
@@ -1271,22 +1277,23 @@ fmt_special_function_done:
 		fr = fmt_frag_child(&res->child, fmt_frag(f, fmt_frag_type_line));
 		fr = fmt_frag_child(&fr->child, fmt_frag_s(f, "foreach"));
 
-		next = fmt_frag_sibling(fr, fmt_node(f, n->l->l->l));
+		struct node *ids = node_l(f->wk, l);
+		next = fmt_frag_sibling(fr, fmt_node(f, node_l(f->wk, ids)));
 		next->flags |= fmt_frag_flag_stick_line_left;
-		if (n->l->l->r) {
+		if (ids->r) {
 			str_app(f->wk, &next->str, ",");
-			next = fmt_frag_sibling(fr, fmt_node(f, n->l->l->r));
+			next = fmt_frag_sibling(fr, fmt_node(f, node_r(f->wk, ids)));
 			next->flags |= fmt_frag_flag_stick_line_left;
 		}
 
 		next = fmt_frag_sibling(fr, fmt_frag_s(f, ":"));
 		next->flags |= fmt_frag_flag_stick_line_left;
 
-		next = fmt_frag_sibling(fr, fmt_node(f, n->l->r));
+		next = fmt_frag_sibling(fr, fmt_node(f, node_r(f->wk, l)));
 		next->flags |= fmt_frag_flag_stick_line_left;
 
-		if (n->r) {
-			fmt_frag_child(&res->child, fmt_block(f, n->r));
+		if (r) {
+			fmt_frag_child(&res->child, fmt_block(f, r));
 		}
 
 		fr = fmt_frag_child(&res->child, fmt_frag(f, fmt_frag_type_line));
@@ -1298,23 +1305,24 @@ fmt_special_function_done:
 
 		bool first = true;
 		while (n) {
+			struct node *branch = node_l(f->wk, n), *cond = node_l(f->wk, branch);
 			fr = fmt_frag_child(&res->child, fmt_frag(f, fmt_frag_type_line));
-			fr = fmt_frag_child(&fr->child, fmt_frag_s(f, first ? "if" : n->l->l ? "elif" : "else"));
+			fr = fmt_frag_child(&fr->child, fmt_frag_s(f, first ? "if" : cond ? "elif" : "else"));
 
-			if (n->l->l) {
-				next = fmt_frag_sibling(fr, fmt_node(f, n->l->l));
+			if (cond) {
+				next = fmt_frag_sibling(fr, fmt_node(f, cond));
 				next->flags |= fmt_frag_flag_stick_line_left;
 				if (f->opts.continuation_indent) {
 					fmt_frag_broadcast_flag(next, fmt_frag_flag_enclosed_extra_indent);
 				}
 			}
 
-			if (n->l->r) {
-				fmt_frag_child(&res->child, fmt_block(f, n->l->r));
+			if (branch->r) {
+				fmt_frag_child(&res->child, fmt_block(f, node_r(f->wk, branch)));
 			}
 
 			first = false;
-			n = n->r;
+			n = node_r(f->wk, n);
 		}
 
 		fr = fmt_frag_child(&res->child, fmt_frag(f, fmt_frag_type_line));
@@ -1325,12 +1333,13 @@ fmt_special_function_done:
 		res->type = fmt_frag_type_lines;
 		fr = fmt_frag_child(&res->child, fmt_frag(f, fmt_frag_type_line));
 		fr = fmt_frag_child(&fr->child, fmt_frag_s(f, "func"));
-		if (n->l->l->l) {
-			next = fmt_frag_sibling(fr, fmt_node(f, n->l->l->l));
+		struct node *name = node_l(f->wk, node_l(f->wk, l));
+		if (name) {
+			next = fmt_frag_sibling(fr, fmt_node(f, name));
 			next->flags |= fmt_frag_flag_stick_line_left;
 		}
 		next = fmt_frag_sibling(fr, fmt_frag(f, fmt_frag_type_expr));
-		fmt_list(f, n->l->r, next, 0);
+		fmt_list(f, node_r(f->wk, l), next, 0);
 		next->enclosing = "()";
 		next->flags |= fmt_frag_flag_stick_left;
 
@@ -1341,8 +1350,8 @@ fmt_special_function_done:
 			next->flags |= fmt_frag_flag_stick_line_left;
 		}
 
-		if (n->r) {
-			fmt_frag_child(&res->child, fmt_block(f, n->r));
+		if (r) {
+			fmt_frag_child(&res->child, fmt_block(f, r));
 		}
 
 		fr = fmt_frag_child(&res->child, fmt_frag(f, fmt_frag_type_line));
@@ -1367,16 +1376,17 @@ fmt_block(struct fmt_ctx *f, struct node *n)
 
 		line = fmt_frag(f, fmt_frag_type_line);
 
-		if (n->fmt.pre.list) {
-			fmt_node_ws(f, n, &n->fmt.pre, &line->pre_ws);
+		const struct node_fmt *fmt = node_fmt(f->wk, n);
+		if (fmt->pre.list) {
+			fmt_node_ws(f, n, &fmt->pre, &line->pre_ws);
 		}
 
-		if (n->fmt.post.list) {
-			fmt_node_ws(f, n, &n->fmt.post, &line->post_ws);
+		if (fmt->post.list) {
+			fmt_node_ws(f, n, &fmt->post, &line->post_ws);
 		}
 
 		if (n->l) {
-			child = fmt_node(f, n->l);
+			child = fmt_node(f, node_l(f->wk, n));
 
 			if (child->type == fmt_frag_type_lines) {
 				child->child->pre_ws = line->pre_ws;
@@ -1409,7 +1419,7 @@ fmt_block(struct fmt_ctx *f, struct node *n)
 			break;
 		}
 
-		n = n->r;
+		n = node_r(f->wk, n);
 	}
 
 	if (!block->child) {
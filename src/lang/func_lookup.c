@@ -56,6 +56,12 @@ struct func_impl native_funcs[768];
 
 struct func_impl_group func_impl_groups[obj_type_count][language_mode_count] = { 0 };
 
+// Open addressed index into native_funcs keyed on the owning group and the
+// function name.  Entries are stored as idx + 1 so that 0 means empty.  It is
+// rebuilt together with the function tables so a lookup only has to compare
+// the names that hash to the same slot instead of scanning the whole group.
+static uint16_t func_lookup_index[2048];
+
 static const func_impl_register_proto func_impl_register_funcs[obj_type_count] = {
 	[obj_null] = func_impl_register_kernel,
 	[obj_disabler] = func_impl_register_disabler,
@@ -124,6 +130,30 @@ func_impl_register_inherit(func_impl_register_proto reg,
 	}
 }
 
+static uint32_t
+func_lookup_hash(uint32_t group_off, const char *name)
+{
+	uint32_t h = 2166136261u;
+	h = (h ^ group_off) * 16777619u;
+	for (; *name; ++name) {
+		h = (h ^ (uint8_t)*name) * 16777619u;
+	}
+	return h;
+}
+
+static void
+func_lookup_index_insert(uint32_t group_off, uint32_t idx)
+{
+	const uint32_t mask = ARRAY_LEN(func_lookup_index) - 1;
+	uint32_t i = func_lookup_hash(group_off, native_funcs[idx].name);
+
+	while (func_lookup_index[i & mask]) {
+		++i;
+	}
+
+	func_lookup_index[i & mask] = idx + 1;
+}
+
 static void
 copy_func_impl_group(
 	struct workspace *wk,
@@ -140,6 +170,12 @@ copy_func_impl_group(
 		.off = *off,
 		.len = len,
 	};
+
+	uint32_t i;
+	for (i = 0; i < len; ++i) {
+		func_lookup_index_insert(*off, *off + i);
+	}
+
 	*off += len;
 }
 
@@ -151,6 +187,9 @@ build_func_impl_tables(struct workspace *wk)
 	enum obj_type t;
 	enum language_mode lang_mode;
 
+	assert(ARRAY_LEN(native_funcs) * 2 <= ARRAY_LEN(func_lookup_index));
+	memset(func_lookup_index, 0, sizeof(func_lookup_index));
+
 	// Only kernel registers functions
 	copy_func_impl_group(wk, &func_impl_groups[0][language_opts], &off, language_opts, func_impl_register_funcs[0]);
 
@@ -186,12 +225,17 @@ func_lookup_for_mode(const struct func_impl_group *impl_group, const char *name,
 		return false;
 	}
 
-	uint32_t i;
-	for (i = 0; i < impl_group->len; ++i) {
-		if (strcmp(impl_group->impls[i].name, name) == 0) {
-			*idx = impl_group->off + i;
+	const uint32_t mask = ARRAY_LEN(func_lookup_index) - 1;
+	uint32_t i = func_lookup_hash(impl_group->off, name), e;
+
+	while ((e = func_lookup_index[i & mask])) {
+		--e;
+		if (e >= impl_group->off && e < impl_group->off + impl_group->len
+			&& strcmp(native_funcs[e].name, name) == 0) {
+			*idx = e;
 			return true;
 		}
+		++i;
 	}
 
 	return false;
@@ -211,7 +211,7 @@ lex_str_token_lookup(struct lexer *lexer,
 	uint32_t i;
 
 	for (i = 0; i < table_len; ++i) {
-		if (str_eql(&table[i].str, str)) {
+		if (table[i].str.len == str->len && table[i].str.s[0] == str->s[0] && str_eql(&table[i].str, str)) {
 			token->type = table[i].token_type;
 			token->location.len = table[i].str.len;
 			token->data.type = table[i].token_subtype;
@@ -640,7 +640,22 @@ lex_basic_string(struct lexer *lexer, struct token *token, struct tstr *buf, cha
 			}
 			break;
 		}
-		default: tstr_push(lexer->wk, buf, lexer->src[lexer->i]); break;
+		default: {
+			// Copy runs of plain characters at once.  Advancing one
+			// character at a time is only necessary when tracking a fmt
+			// range.
+			uint32_t last = lexer->i;
+			if (!lexer->fmt.range) {
+				while (last + 1 < lexer->source->len && !strchr("\\\n", lexer->src[last + 1])
+					&& lexer->src[last + 1] != end) {
+					++last;
+				}
+			}
+
+			tstr_pushn(lexer->wk, buf, &lexer->src[lexer->i], last - lexer->i + 1);
+			lexer->i = last;
+			break;
+		}
 		}
 	}
 
@@ -659,6 +674,10 @@ static void
 lex_string(struct lexer *lexer, struct token *token)
 {
 	const struct str multiline_terminator = STR("'''");
+
+	// The buffer is only needed until the string object is made, so give
+	// its space back rather than leaving a 1k buffer behind per string.
+	workspace_scratch_begin(lexer->wk);
 	TSTR(buf);
 
 	if (str_eql(&lexer_str(multiline_terminator.len), &multiline_terminator)) {
@@ -678,11 +697,11 @@ lex_string(struct lexer *lexer, struct token *token)
 		} else {
 			lex_error_token(lexer, token, "unterminated multiline string");
 		}
-
-		return;
+	} else {
+		lex_basic_string(lexer, token, &buf, '\'', lex_string_escape);
 	}
 
-	lex_basic_string(lexer, token, &buf, '\'', lex_string_escape);
+	workspace_scratch_end(lexer->wk);
 }
 
 enum lexer_enclosed_state {
@@ -781,10 +800,16 @@ restart:
 			}
 
 			start = lexer->i;
+			uint32_t doc_comment_span = start;
 
 			while (lexer->src[lexer->i]) {
 				if (doc_comment) {
 					if (lexer->src[lexer->i] == '\n') {
+						str_appn(lexer->wk,
+							&doc_comment,
+							&lexer->src[doc_comment_span],
+							lexer->i - doc_comment_span);
+
 						uint32_t skip = 1;
 						while (strchr(" \t", lexer->src[lexer->i + skip])) {
 							++skip;
@@ -803,12 +828,12 @@ restart:
 							if (strchr(" \t", lexer->src[lexer->i])) {
 								lex_advance(lexer);
 							}
+							doc_comment_span = lexer->i;
 							continue;
 						} else {
+							doc_comment_span = lexer->i;
 							break;
 						}
-					} else {
-						str_appn(lexer->wk, &doc_comment, &lexer->src[lexer->i], 1);
 					}
 				} else if (lexer->src[lexer->i] == '\n') {
 					break;
@@ -817,6 +842,10 @@ restart:
 				lex_advance(lexer);
 			}
 
+			if (doc_comment && doc_comment_span < lexer->i) {
+				str_appn(lexer->wk, &doc_comment, &lexer->src[doc_comment_span], lexer->i - doc_comment_span);
+			}
+
 			if (lexer->mode & lexer_mode_fmt) {
 				bool fmt_on;
 				obj s;
@@ -847,22 +876,29 @@ restart:
 		}
 	}
 
-	if (str_eql(&lexer_str(2), &STR("\\\n"))) {
-		lex_advance_n(lexer, 2);
-		goto restart;
-	} else if (str_eql(&lexer_str(3), &STR("\\\r\n"))) {
-		lex_advance_n(lexer, 3);
-		goto restart;
+	if (lexer->src[lexer->i] == '\\') {
+		if (str_eql(&lexer_str(2), &STR("\\\n"))) {
+			lex_advance_n(lexer, 2);
+			goto restart;
+		} else if (str_eql(&lexer_str(3), &STR("\\\r\n"))) {
+			lex_advance_n(lexer, 3);
+			goto restart;
+		}
 	}
 
 	lexer->ws_end = lexer->i;
 	token->location.off = lexer->i;
 
+	// all 2 character tokens end in either '=' or '>'
 	struct str lexer_str_2chr = lexer_str(2);
-	if (lex_str_token_lookup(lexer, token, lex_2chr_tokens, ARRAY_LEN(lex_2chr_tokens), &lexer_str_2chr)
-		|| ((lexer->mode & lexer_mode_functions)
-			&& lex_str_token_lookup(
-				lexer, token, lex_2chr_tokens_func, ARRAY_LEN(lex_2chr_tokens_func), &lexer_str_2chr))) {
+	if (lexer_str_2chr.len == 2 && (lexer_str_2chr.s[1] == '=' || lexer_str_2chr.s[1] == '>')
+		&& (lex_str_token_lookup(lexer, token, lex_2chr_tokens, ARRAY_LEN(lex_2chr_tokens), &lexer_str_2chr)
+			|| ((lexer->mode & lexer_mode_functions)
+				&& lex_str_token_lookup(lexer,
+					token,
+					lex_2chr_tokens_func,
+					ARRAY_LEN(lex_2chr_tokens_func),
+					&lexer_str_2chr)))) {
 		lex_advance_n(lexer, 2);
 		return;
 	}
@@ -1153,8 +1189,10 @@ restart:
 		start = lexer->i;
 		token->type = token_type_string;
 
+		workspace_scratch_begin(lexer->wk);
 		TSTR(buf);
 		lex_basic_string(lexer, token, &buf, '"', lex_string_escape);
+		workspace_scratch_end(lexer->wk);
 		token->location.len = lexer->i - token->location.off;
 		return;
 	}
@@ -50,6 +50,10 @@ struct az_srv {
 	struct hash diagnostics_map;
 	struct arr diagnostics_to_clear;
 	struct az_opts opts;
+
+	// Path of a document whose changes have not been analyzed yet because
+	// more messages were already waiting.  Allocated in srv.wk.
+	obj deferred_path_str;
 };
 
 enum LspTextDocumentSyncKind {
@@ -325,6 +329,93 @@ az_srv_set_src_override(struct az_srv *srv, struct workspace *wk, const struct s
 	analyze_opts_push_override(srv->srv.wk, &srv->opts, srv->req.path, 0, content);
 }
 
+/*
+ * Convert an LSP position to a byte offset into src.  The character offset
+ * counts UTF-16 code units and is clamped to the end of its line.
+ */
+static uint32_t
+az_srv_position_to_offset(struct workspace *wk, const struct str *src, obj position)
+{
+	int64_t line = obj_dict_index_as_number(wk, position, "line");
+	int64_t character = obj_dict_index_as_number(wk, position, "character");
+	uint32_t i = 0;
+
+	for (; line > 0 && i < src->len; ++i) {
+		if (src->s[i] == '\n') {
+			--line;
+		}
+	}
+
+	while (character > 0 && i < src->len && src->s[i] != '\n') {
+		const uint8_t c = src->s[i];
+		if (c < 0x80) {
+			i += 1;
+		} else if (c < 0xe0) {
+			i += 2;
+		} else if (c < 0xf0) {
+			i += 3;
+		} else {
+			i += 4;
+			--character; // encoded as a surrogate pair
+		}
+
+		--character;
+	}
+
+	return i > src->len ? src->len : i;
+}
+
+static void
+az_srv_apply_content_changes(struct az_srv *srv, struct workspace *wk, const struct str *uri_s, obj content_changes)
+{
+	az_srv_set_request_path(srv, wk, uri_s);
+	if (!srv->req.path) {
+		return;
+	}
+
+	struct str cur = { 0 };
+	{
+		TSTR(abs);
+		path_make_absolute(wk, &abs, srv->req.path);
+
+		obj idx;
+		struct source src = { 0 };
+		if (obj_dict_index_str(srv->srv.wk, srv->opts.file_override, abs.buf, &idx)) {
+			src = *(struct source *)arr_get(&srv->opts.file_override_src, idx);
+		} else if (!fs_read_entire_file(wk->a_scratch, srv->req.path, &src)) {
+			src = (struct source){ 0 };
+		}
+
+		cur = (struct str){ .s = src.src, .len = src.len };
+	}
+
+	obj change;
+	obj_array_for(wk, content_changes, change) {
+		const struct str *text = obj_dict_index_as_str(wk, change, "text");
+		obj range = obj_dict_index_as_obj(wk, change, "range");
+		if (!text) {
+			continue;
+		} else if (!range) {
+			cur = *text;
+			continue;
+		}
+
+		uint32_t start = az_srv_position_to_offset(wk, &cur, obj_dict_index_as_obj(wk, range, "start"));
+		uint32_t end = az_srv_position_to_offset(wk, &cur, obj_dict_index_as_obj(wk, range, "end"));
+		if (end < start) {
+			end = start;
+		}
+
+		TSTR(buf);
+		tstr_pushn(wk, &buf, cur.s, start);
+		tstr_pushn(wk, &buf, text->s, text->len);
+		tstr_pushn(wk, &buf, cur.s + end, cur.len - end);
+		cur = (struct str){ .s = buf.buf, .len = buf.len };
+	}
+
+	az_srv_set_src_override(srv, wk, uri_s, &cur);
+}
+
 static void
 az_srv_handle_push_breakpoint_from_msg(struct az_srv *srv, struct workspace *wk, obj msg)
 {
@@ -411,7 +502,7 @@ az_srv_handle(struct az_srv *srv, struct workspace *wk, obj msg)
 		obj_dict_set(wk,
 			capabilities,
 			make_str(wk, "textDocumentSync"),
-			make_number(wk, LspTextDocumentSyncKindFull));
+			make_number(wk, LspTextDocumentSyncKindIncremental));
 
 		obj completion_provider = make_obj(wk, obj_dict);
 		obj trigger_characters = make_obj(wk, obj_array);
@@ -450,10 +541,8 @@ az_srv_handle(struct az_srv *srv, struct workspace *wk, obj msg)
 		obj text_document = obj_dict_index_as_obj(wk, params, "textDocument");
 		const struct str *uri = obj_dict_index_as_str(wk, text_document, "uri");
 		obj content_changes = obj_dict_index_as_obj(wk, params, "contentChanges");
-		obj change0 = obj_array_index(wk, content_changes, 0);
-		const struct str *content = obj_dict_index_as_str(wk, change0, "text");
 
-		az_srv_set_src_override(srv, wk, uri, content);
+		az_srv_apply_content_changes(srv, wk, uri, content_changes);
 	} else if (str_eql(method, &STR("textDocument/didSave"))) {
 		obj params = obj_dict_index_as_obj(wk, msg, "params");
 		obj text_document = obj_dict_index_as_obj(wk, params, "textDocument");
@@ -1030,21 +1119,53 @@ analyze_server(struct workspace *srv_wk, struct az_opts *cmdline_opts)
 
 		srv->should_analyze = false;
 		srv->req.id = srv->req.result = srv->req.type = 0;
+		srv->req.path = 0;
+		srv->req.path_str = 0;
+
+		if (srv->deferred_path_str && !srv_input_pending(&srv->srv)) {
+			// The client has gone quiet, analyze the changes that were
+			// deferred below.
+			workspace_scratch_begin(srv_wk);
+
+			srv->req.path_str = str_clone(srv_wk, &wk, srv->deferred_path_str);
+			srv->req.path = get_cstr(&wk, srv->req.path_str);
+			srv->should_analyze = true;
+		} else {
+			obj msg;
+			switch (srv_read(&srv->srv, &wk, &msg)) {
+			case srv_read_result_err:
+				ok = false;
+				goto shutdown;
+			case srv_read_result_eof:
+				goto shutdown;
+			case srv_read_result_ok:
+				break;
+			}
 
-		obj msg;
-		switch (srv_read(&srv->srv, &wk, &msg)) {
-		case srv_read_result_err:
-			ok = false;
-			goto shutdown;
-		case srv_read_result_eof:
-			goto shutdown;
-		case srv_read_result_ok:
-			break;
+			workspace_scratch_begin(srv_wk);
+
+			az_srv_handle(srv, &wk, msg);
 		}
 
-		workspace_scratch_begin(srv_wk);
+		if (srv->should_analyze && !srv->req.id && srv->req.path) {
+			bool same_as_deferred = false;
+			if (srv->deferred_path_str) {
+				same_as_deferred = str_eql(
+					get_str(srv_wk, srv->deferred_path_str), get_str(&wk, srv->req.path_str));
+			}
 
-		az_srv_handle(srv, &wk, msg);
+			if ((!srv->deferred_path_str || same_as_deferred) && srv_input_pending(&srv->srv)) {
+				// More messages are already waiting, which usually means
+				// the user is still typing.  Only analyze once the burst of
+				// edits is over.
+				if (!same_as_deferred) {
+					srv->deferred_path_str = str_clone(&wk, srv_wk, srv->req.path_str);
+				}
+				goto analyze_done;
+			} else if (same_as_deferred) {
+				srv->deferred_path_str = 0;
+			}
+		}
 
 		if (srv->should_analyze) {
 			bool did_chdir = false;
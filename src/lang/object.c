@@ -16,6 +16,7 @@
 #include "lang/func_lookup.h"
 #include "lang/object.h"
 #include "lang/object_iterators.h"
+#include "lang/profile.h"
 #include "lang/typecheck.h"
 #include "log.h"
 #include "options.h"
@@ -27,6 +28,13 @@ static bool making_default_objects = false;
 void *
 get_obj_internal(struct workspace *wk, obj id, enum obj_type type)
 {
+	// Immediate numbers have no entry in the object table.
+	if (id & OBJ_NUMBER_IMMEDIATE_TAG) {
+		LOG_E("internal type error, expected %s but got an immediate number", obj_type_to_s(type));
+		abort();
+		return NULL;
+	}
+
 	struct obj_internal *o = bucket_arr_get(&wk->vm.objects.objs, id);
 	if (o->t != type) {
 		LOG_E("internal type error, expected %s but got %s", obj_type_to_s(type), obj_type_to_s(o->t));
@@ -116,6 +124,10 @@ make_default_objects(struct workspace *wk)
 enum obj_type
 get_obj_type(struct workspace *wk, obj id)
 {
+	if (id & OBJ_NUMBER_IMMEDIATE_TAG) {
+		return obj_number;
+	}
+
 	struct obj_internal *o = bucket_arr_get(&wk->vm.objects.objs, id);
 	return o->t;
 }
@@ -148,23 +160,33 @@ get_obj_bool_with_default(struct workspace *wk, obj o, bool def)
 
 obj
 make_number(struct workspace *wk, int64_t n)
+{
+	if (OBJ_NUMBER_IMMEDIATE_MIN <= n && n <= OBJ_NUMBER_IMMEDIATE_MAX) {
+		return OBJ_NUMBER_IMMEDIATE_TAG | ((uint32_t)n & ~OBJ_NUMBER_IMMEDIATE_TAG);
+	}
+
+	return make_number_boxed(wk, n);
+}
+
+obj
+make_number_boxed(struct workspace *wk, int64_t n)
 {
 	obj o;
 	o = make_obj(wk, obj_number);
-	set_obj_number(wk, o, n);
+	*(int64_t *)get_obj_internal(wk, o, obj_number) = n;
 	return o;
 }
 
 int64_t
 get_obj_number(struct workspace *wk, obj o)
 {
-	return *(int64_t *)get_obj_internal(wk, o, obj_number);
-}
+	if (o & OBJ_NUMBER_IMMEDIATE_TAG) {
+		int64_t n = o & ~OBJ_NUMBER_IMMEDIATE_TAG;
+		// sign extend from 31 bits
+		return n > OBJ_NUMBER_IMMEDIATE_MAX ? n - ((int64_t)1 << 31) : n;
+	}
 
-void
-set_obj_number(struct workspace *wk, obj o, int64_t v)
-{
-	*(int64_t *)get_obj_internal(wk, o, obj_number) = v;
+	return *(int64_t *)get_obj_internal(wk, o, obj_number);
 }
 
 obj *
@@ -265,6 +287,11 @@ make_obj(struct workspace *wk, enum obj_type type)
 {
 	uint32_t val;
 	obj res = wk->vm.objects.objs.len;
+	assert(!(res & OBJ_NUMBER_IMMEDIATE_TAG) && "too many objects");
+
+	if (wk->vm.profile) {
+		vm_profile_obj(wk, type);
+	}
 
 	switch (type) {
 	case obj_null:
@@ -336,41 +363,452 @@ make_obj(struct workspace *wk, enum obj_type type)
 	return res;
 }
 
-void
-obj_set_clear_mark(struct workspace *wk, struct obj_clear_mark *mk)
+static void
+obj_clear_mark_save(struct workspace *wk, struct obj_clear_mark *mk)
 {
-	wk->vm.objects.obj_clear_mark_set = true;
-
 	bucket_arr_save(&wk->vm.objects.chrs, &mk->chrs);
 	bucket_arr_save(&wk->vm.objects.objs, &mk->objs);
 	bucket_arr_save(&wk->vm.objects.dict_elems, &mk->dict_elems);
 	bucket_arr_save(&wk->vm.objects.dict_hashes, &mk->dict_hashes);
-	bucket_arr_save(&wk->vm.objects.array_elems, &mk->array_elems);
+	mk->array_chunks.chunks = wk->vm.objects.array_chunks.len;
+	mk->array_chunks.tail_len
+		= mk->array_chunks.chunks ?
+			  ((struct obj_array_chunk *)arr_get(&wk->vm.objects.array_chunks, mk->array_chunks.chunks - 1))->len :
+			  0;
 	uint32_t i;
 	for (i = 0; i < obj_type_count - _obj_aos_start; ++i) {
 		bucket_arr_save(&wk->vm.objects.obj_aos[i], &mk->obj_aos[i]);
 	}
-
-	workspace_scratch_begin(wk);
-	//mk->arena_pos = wk->a->pos;
 }
 
-void
-obj_clear(struct workspace *wk, const struct obj_clear_mark *mk)
+static void
+obj_clear_mark_restore(struct workspace *wk, const struct obj_clear_mark *mk)
 {
-	//ar_pop_to(wk->a, mk->arena_pos);
-	workspace_scratch_end(wk);
+	uint32_t i;
 
 	bucket_arr_restore(&wk->vm.objects.objs, &mk->objs);
 	bucket_arr_restore(&wk->vm.objects.chrs, &mk->chrs);
 	bucket_arr_restore(&wk->vm.objects.dict_elems, &mk->dict_elems);
-	bucket_arr_restore(&wk->vm.objects.dict_hashes, &mk->dict_hashes);
-	bucket_arr_restore(&wk->vm.objects.array_elems, &mk->array_elems);
 
-	uint32_t i;
+	// The tables of big dicts past the mark live in wk->a, keep them for
+	// reuse too.
+	struct bucket_arr *hashes = &wk->vm.objects.dict_hashes;
+	for (i = mk->dict_hashes.tail_bucket * hashes->bucket_size + mk->dict_hashes.tail_bucket_len; i < hashes->len;
+		++i) {
+		arr_push(wk->a, &wk->vm.objects.dict_hashes_free, bucket_arr_get(hashes, i));
+	}
+	bucket_arr_restore(hashes, &mk->dict_hashes);
+
+	// Chunk memory past the mark is kept for reuse, like bucket_arr_restore
+	// keeps its buckets.
+	for (i = mk->array_chunks.chunks; i < wk->vm.objects.array_chunks.len; ++i) {
+		struct obj_array_chunk *chunk = arr_get(&wk->vm.objects.array_chunks, i);
+		chunk->len = 0;
+		arr_push(wk->a, &wk->vm.objects.array_chunks_free, chunk);
+	}
+	wk->vm.objects.array_chunks.len = mk->array_chunks.chunks;
+	if (mk->array_chunks.chunks) {
+		((struct obj_array_chunk *)arr_get(&wk->vm.objects.array_chunks, mk->array_chunks.chunks - 1))->len
+			= mk->array_chunks.tail_len;
+	}
+
 	for (i = 0; i < obj_type_count - _obj_aos_start; ++i) {
 		bucket_arr_restore(&wk->vm.objects.obj_aos[i], &mk->obj_aos[i]);
 	}
+
+	// Builders are tracked by id, which may now refer to other objects.
+	wk->vm.objects.str_builders = (struct str_builders){ 0 };
+}
+
+void
+obj_set_clear_mark(struct workspace *wk, struct obj_clear_mark *mk)
+{
+	wk->vm.objects.obj_clear_mark_set = true;
+	obj_clear_mark_save(wk, mk);
+	workspace_scratch_begin(wk);
+}
+
+void
+obj_clear(struct workspace *wk, const struct obj_clear_mark *mk)
+{
+	workspace_scratch_end(wk);
+	obj_clear_mark_restore(wk, mk);
+	wk->vm.objects.young.set = false;
+}
+
+/******************************************************************************
+ * young objects
+ ******************************************************************************/
+
+void
+obj_young_set_mark(struct workspace *wk)
+{
+	struct obj_young *y = &wk->vm.objects.young;
+
+	obj_clear_mark_save(wk, &y->mark);
+	y->objs = wk->vm.objects.objs.len;
+	y->global_scope = wk->vm.global_scope;
+	y->set = true;
+	y->dirty = false;
+}
+
+static bool
+obj_is_young(struct workspace *wk, obj o)
+{
+	return !(o & OBJ_NUMBER_IMMEDIATE_TAG) && o >= wk->vm.objects.young.objs;
+}
+
+void
+obj_young_barrier(struct workspace *wk, obj o)
+{
+	if (wk->vm.objects.young.set && !obj_is_young(wk, o)) {
+		wk->vm.objects.young.dirty = true;
+	}
+}
+
+static bool
+obj_young_bucket_pointer(struct bucket_arr *ba, const struct bucket_arr_save *save, const void *p)
+{
+	uint64_t i;
+	if (!p || !bucket_arr_lookup_pointer(ba, p, &i)) {
+		return false;
+	}
+
+	uint32_t bucket = i / ba->bucket_size, off = i % ba->bucket_size;
+	return bucket > save->tail_bucket || (bucket == save->tail_bucket && off >= save->tail_bucket_len);
+}
+
+static bool
+obj_young_array_storage(struct workspace *wk, const obj *e)
+{
+	const struct obj_clear_mark *mk = &wk->vm.objects.young.mark;
+
+	for (uint32_t i = 0; e && i < wk->vm.objects.array_chunks.len; ++i) {
+		const struct obj_array_chunk *chunk = arr_get(&wk->vm.objects.array_chunks, i);
+		if (chunk->mem <= e && e < chunk->mem + chunk->cap) {
+			if (i + 1 == mk->array_chunks.chunks) {
+				return (uint32_t)(e - chunk->mem) >= mk->array_chunks.tail_len;
+			}
+			return i >= mk->array_chunks.chunks;
+		}
+	}
+
+	return false;
+}
+
+/* A young object that has to survive a collection.  Its contents are copied
+ * out before the young objects are cleared: string bytes into bytes, and
+ * array elements or dict keys and values into elems.  Iterators over young
+ * storage copy out the elements they have left, which are remade into a new
+ * array or dict for them to iterate. */
+struct obj_young_copy {
+	obj o;
+	enum obj_type t;
+	uint32_t start, len;
+	bool has_elems;
+	union {
+		int64_t num;
+		enum obj_dict_flags dict_flags;
+		struct obj_iterator iter;
+		struct str big_str;
+	} u;
+};
+
+struct obj_young_ctx {
+	struct hash copies;
+	struct arr copy, elems, bytes;
+};
+
+static bool
+obj_young_copy_out(struct workspace *wk, struct obj_young_ctx *ctx, obj o)
+{
+	if (!obj_is_young(wk, o) || hash_get(&ctx->copies, &o)) {
+		return true;
+	}
+
+	struct obj_young_copy c = { .t = get_obj_type(wk, o) };
+
+	switch (c.t) {
+	case obj_string: {
+		const struct str *s = get_str(wk, o);
+		if (s->flags & str_flag_big) {
+			// Big strings aren't stored in chrs, so their storage
+			// survives the collection.
+			c.u.big_str = *s;
+			break;
+		}
+
+		c.start = ctx->bytes.len;
+		c.len = s->len;
+		if (c.len) {
+			arr_grow_by(wk->a_scratch, &ctx->bytes, c.len);
+			memcpy(arr_get(&ctx->bytes, c.start), s->s, c.len);
+		}
+		break;
+	}
+	case obj_number: c.u.num = get_obj_number(wk, o); break;
+	case obj_array: {
+		const struct obj_array *a = get_obj_array(wk, o);
+		c.start = ctx->elems.len;
+		c.len = a->len;
+		c.has_elems = true;
+		if (c.len) {
+			arr_grow_by(wk->a_scratch, &ctx->elems, c.len);
+			memcpy(arr_get(&ctx->elems, c.start), obj_array_elems(wk, a), sizeof(obj) * c.len);
+		}
+		break;
+	}
+	case obj_dict: {
+		const struct obj_dict *d = get_obj_dict(wk, o);
+		if (d->flags & obj_dict_flag_int_key) {
+			return false;
+		}
+
+		c.start = ctx->elems.len;
+		c.len = d->len * 2;
+		c.has_elems = true;
+		c.u.dict_flags = d->flags & obj_dict_flag_dont_expand;
+
+		obj k, v;
+		obj_dict_for(wk, o, k, v) {
+			arr_push(wk->a_scratch, &ctx->elems, &k);
+			arr_push(wk->a_scratch, &ctx->elems, &v);
+		}
+		break;
+	}
+	case obj_iterator: {
+		c.u.iter = *get_obj_iterator(wk, o);
+		struct obj_iterator *it = &c.u.iter;
+		const struct obj_clear_mark *mk = &wk->vm.objects.young.mark;
+		c.start = ctx->elems.len;
+
+		switch (it->type) {
+		case obj_iterator_type_array:
+			if (obj_young_array_storage(wk, it->data.array.e)) {
+				c.len = it->data.array.len - it->data.array.i;
+				if (c.len) {
+					arr_grow_by(wk->a_scratch, &ctx->elems, c.len);
+					memcpy(arr_get(&ctx->elems, c.start),
+						it->data.array.e + it->data.array.i,
+						sizeof(obj) * c.len);
+				}
+				c.has_elems = true;
+			}
+			break;
+		case obj_iterator_type_dict_small:
+			if (obj_young_bucket_pointer(
+				    &wk->vm.objects.dict_elems, &mk->dict_elems, it->data.dict_small)) {
+				for (const struct obj_dict_elem *e = it->data.dict_small; e;
+					e = e->next ? bucket_arr_get(&wk->vm.objects.dict_elems, e->next) : 0) {
+					arr_push(wk->a_scratch, &ctx->elems, &e->key);
+					arr_push(wk->a_scratch, &ctx->elems, &e->val);
+				}
+				c.len = ctx->elems.len - c.start;
+				c.has_elems = true;
+			}
+			break;
+		case obj_iterator_type_dict_big:
+			if (obj_young_bucket_pointer(
+				    &wk->vm.objects.dict_hashes, &mk->dict_hashes, it->data.dict_big.h)) {
+				const struct hash *h = it->data.dict_big.h;
+				for (uint32_t i = it->data.dict_big.i; i < h->keys.len; ++i) {
+					const void *k = bucket_arr_get(&h->keys, i);
+					const union obj_dict_big_dict_value *uv = (void *)hash_get(h, k);
+					arr_push(wk->a_scratch, &ctx->elems, &uv->val.key);
+					arr_push(wk->a_scratch, &ctx->elems, &uv->val.val);
+				}
+				c.len = ctx->elems.len - c.start;
+				c.has_elems = true;
+			}
+			break;
+		case obj_iterator_type_range:
+		case obj_iterator_type_typeinfo: break;
+		}
+		break;
+	}
+	default: return false;
+	}
+
+	hash_set(wk->a_scratch, &ctx->copies, &o, arr_push(wk->a_scratch, &ctx->copy, &c));
+
+	if (c.has_elems) {
+		for (uint32_t i = 0; i < c.len; ++i) {
+			if (!obj_young_copy_out(wk, ctx, *(obj *)arr_get(&ctx->elems, c.start + i))) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static obj
+obj_young_relocate(struct workspace *wk, struct obj_young_ctx *ctx, uint32_t objs, obj o)
+{
+	if ((o & OBJ_NUMBER_IMMEDIATE_TAG) || o < objs) {
+		return o;
+	}
+
+	uint64_t *i = hash_get(&ctx->copies, &o);
+	assert(i);
+	return ((struct obj_young_copy *)arr_get(&ctx->copy, *i))->o;
+}
+
+static void
+obj_young_fill_iterable(struct workspace *wk,
+	struct obj_young_ctx *ctx,
+	uint32_t objs,
+	const struct obj_young_copy *c,
+	enum obj_type t,
+	obj dst)
+{
+	const obj *e = c->len ? arr_get(&ctx->elems, c->start) : 0;
+
+	if (t == obj_array) {
+		for (uint32_t j = 0; j < c->len; ++j) {
+			obj_array_push(wk, dst, obj_young_relocate(wk, ctx, objs, e[j]));
+		}
+	} else {
+		for (uint32_t j = 0; j < c->len; j += 2) {
+			obj_dict_set(wk,
+				dst,
+				obj_young_relocate(wk, ctx, objs, e[j]),
+				obj_young_relocate(wk, ctx, objs, e[j + 1]));
+		}
+	}
+}
+
+static void
+obj_young_fill(struct workspace *wk, struct obj_young_ctx *ctx, uint32_t objs, struct obj_young_copy *c)
+{
+	if (c->t != obj_iterator) {
+		obj_young_fill_iterable(wk, ctx, objs, c, c->t, c->o);
+		return;
+	}
+
+	struct obj_iterator *it = get_obj_iterator(wk, c->o);
+
+	if (it->type == obj_iterator_type_array) {
+		obj a = make_obj(wk, obj_array);
+		obj_young_fill_iterable(wk, ctx, objs, c, obj_array, a);
+		struct obj_array *arr = get_obj_array(wk, a);
+		it->data.array.e = obj_array_elems(wk, arr);
+		it->data.array.i = 0;
+		it->data.array.len = arr->len;
+		return;
+	}
+
+	obj d = make_obj(wk, obj_dict);
+	obj_young_fill_iterable(wk, ctx, objs, c, obj_dict, d);
+	const struct obj_dict *dict = get_obj_dict(wk, d);
+	if (dict->flags & obj_dict_flag_big) {
+		it->type = obj_iterator_type_dict_big;
+		it->data.dict_big.h = bucket_arr_get(&wk->vm.objects.dict_hashes, dict->data);
+		it->data.dict_big.i = 0;
+	} else {
+		it->type = obj_iterator_type_dict_small;
+		it->data.dict_small = dict->len ? bucket_arr_get(&wk->vm.objects.dict_elems, dict->data) : 0;
+	}
+}
+
+/*
+ * roots is an arr of obj *.  If every young object reachable from roots can
+ * be copied, all young objects are cleared, the reachable ones are remade,
+ * and roots are updated to point at the new objects.  Returns false without
+ * changing anything otherwise.
+ */
+bool
+obj_young_collect(struct workspace *wk, struct arr *roots, uint32_t *survivors)
+{
+	TracyCZoneAutoS;
+	struct obj_young *y = &wk->vm.objects.young;
+	bool ok = false;
+
+	workspace_scratch_begin(wk);
+
+	struct obj_young_ctx ctx = { 0 };
+	hash_init(wk->a_scratch, &ctx.copies, 64, obj);
+	arr_init(wk->a_scratch, &ctx.copy, 64, struct obj_young_copy);
+	arr_init(wk->a_scratch, &ctx.elems, 256, obj);
+	arr_init(wk->a_scratch, &ctx.bytes, 1024, char);
+
+	for (uint32_t i = 0; i < roots->len; ++i) {
+		if (!obj_young_copy_out(wk, &ctx, **(obj **)arr_get(roots, i))) {
+			goto done;
+		}
+	}
+
+	const struct str_builders builders = wk->vm.objects.str_builders;
+
+	obj_clear_mark_restore(wk, &y->mark);
+
+	// Make everything first so that references between survivors can be
+	// resolved while filling in arrays and dicts.
+	for (uint32_t i = 0; i < ctx.copy.len; ++i) {
+		struct obj_young_copy *c = arr_get(&ctx.copy, i);
+		switch (c->t) {
+		case obj_string:
+			if (c->u.big_str.s) {
+				c->o = make_obj(wk, obj_string);
+				*(struct str *)get_str(wk, c->o) = c->u.big_str;
+			} else {
+				c->o = make_strn(wk, c->len ? arr_get(&ctx.bytes, c->start) : "", c->len);
+			}
+			break;
+		case obj_number: c->o = make_number(wk, c->u.num); break;
+		case obj_array: c->o = make_obj(wk, obj_array); break;
+		case obj_dict:
+			c->o = make_obj(wk, obj_dict);
+			get_obj_dict(wk, c->o)->flags = c->u.dict_flags;
+			break;
+		case obj_iterator:
+			c->o = make_obj(wk, obj_iterator);
+			*get_obj_iterator(wk, c->o) = c->u.iter;
+			break;
+		default: UNREACHABLE;
+		}
+	}
+
+	for (uint32_t i = 0; i < ctx.copy.len; ++i) {
+		struct obj_young_copy *c = arr_get(&ctx.copy, i);
+		if (c->has_elems) {
+			obj_young_fill(wk, &ctx, y->objs, c);
+		}
+	}
+
+	for (uint32_t i = 0; i < roots->len; ++i) {
+		obj *r = *(obj **)arr_get(roots, i);
+		*r = obj_young_relocate(wk, &ctx, y->objs, *r);
+	}
+
+	// String builders that kept their storage can still be appended to.
+	for (uint32_t i = 0; i < ARRAY_LEN(builders.e); ++i) {
+		obj s = builders.e[i].s;
+		if (!s) {
+			continue;
+		} else if (obj_is_young(wk, s)) {
+			if (!hash_get(&ctx.copies, &s)) {
+				continue;
+			}
+
+			s = obj_young_relocate(wk, &ctx, y->objs, s);
+			if (!(get_str(wk, s)->flags & str_flag_big)) {
+				continue;
+			}
+		}
+
+		wk->vm.objects.str_builders.e[i] = builders.e[i];
+		wk->vm.objects.str_builders.e[i].s = s;
+		++wk->vm.objects.str_builders.len;
+	}
+	wk->vm.objects.str_builders.next = builders.next;
+
+	*survivors = ctx.copy.len;
+	ok = true;
+done:
+	workspace_scratch_end(wk);
+	TracyCZoneAutoE;
+	return ok;
 }
 
 static struct {
@@ -605,22 +1043,255 @@ obj_equal(struct workspace *wk, obj left, obj right)
  * arrays
  ******************************************************************************/
 
+static uint32_t
+obj_array_chunk_new(struct workspace *wk, uint32_t cap)
+{
+	struct arr *free_chunks = &wk->vm.objects.array_chunks_free;
+	uint32_t i;
+
+	// Reuse a chunk released by obj_clear_mark_restore() if one fits without
+	// wasting more than half of it.
+	for (i = free_chunks->len; i > 0; --i) {
+		struct obj_array_chunk *chunk = arr_get(free_chunks, i - 1);
+		if (chunk->cap >= cap && chunk->cap / 2 <= cap) {
+			struct obj_array_chunk reused = *chunk;
+			*chunk = *(struct obj_array_chunk *)arr_pop(free_chunks);
+			return arr_push(wk->a, &wk->vm.objects.array_chunks, &reused);
+		}
+	}
+
+	struct obj_array_chunk chunk = {
+		.mem = ar_alloc(wk->a, cap, sizeof(obj), ar_alignof(obj)),
+		.cap = cap,
+	};
+	return arr_push(wk->a, &wk->vm.objects.array_chunks, &chunk);
+}
+
+/*
+ * Reserve space for cap elements and return its location in *chunk and
+ * *start.  Small runs are carved out of the tail chunk, larger ones get a
+ * dedicated chunk.
+ */
+static void
+obj_array_storage_alloc(struct workspace *wk, uint32_t cap, uint32_t *chunk, uint32_t *start)
+{
+	struct arr *chunks = &wk->vm.objects.array_chunks;
+
+	if (cap > obj_array_chunk_size / 4) {
+		*chunk = obj_array_chunk_new(wk, cap);
+		*start = 0;
+		((struct obj_array_chunk *)arr_get(chunks, *chunk))->len = cap;
+		return;
+	}
+
+	struct obj_array_chunk *tail = chunks->len ? arr_get(chunks, chunks->len - 1) : 0;
+	if (!tail || tail->cap - tail->len < cap) {
+		tail = arr_get(chunks, obj_array_chunk_new(wk, obj_array_chunk_size));
+	}
+
+	*chunk = chunks->len - 1;
+	*start = tail->len;
+	tail->len += cap;
+}
+
+obj *
+obj_array_elems(struct workspace *wk, const struct obj_array *a)
+{
+	if (!a->cap) {
+		return 0;
+	}
+
+	struct obj_array_chunk *chunk = arr_get(&wk->vm.objects.array_chunks, a->chunk);
+	assert(a->start + a->cap <= chunk->len);
+	return chunk->mem + a->start;
+}
+
+/*
+ * Grow the storage of a to hold at least cap elements.  If a is the last
+ * run in its chunk it is extended in place, otherwise it is moved to a new
+ * run twice the size.
+ */
+static void
+obj_array_reserve(struct workspace *wk, struct obj_array *a, uint32_t cap)
+{
+	if (cap <= a->cap) {
+		return;
+	}
+
+	uint32_t new_cap = a->cap * 2;
+	if (new_cap < cap) {
+		new_cap = cap;
+	}
+
+	if (a->cap) {
+		struct obj_array_chunk *chunk = arr_get(&wk->vm.objects.array_chunks, a->chunk);
+		if (a->start + a->cap == chunk->len && a->start + new_cap <= chunk->cap) {
+			chunk->len += new_cap - a->cap;
+			a->cap = new_cap;
+			return;
+		}
+	}
+
+	uint32_t chunk, start;
+	obj_array_storage_alloc(wk, new_cap, &chunk, &start);
+
+	if (a->len) {
+		const obj *src = obj_array_elems(wk, a);
+		struct obj_array_chunk *c = arr_get(&wk->vm.objects.array_chunks, chunk);
+		memcpy(c->mem + start, src, sizeof(obj) * a->len);
+	}
+
+	a->chunk = chunk;
+	a->start = start;
+	a->cap = new_cap;
+}
+
 static void
 obj_array_copy_on_write(struct workspace *wk, struct obj_array *a, obj arr)
 {
 	struct obj_array cur;
 
+	obj_young_barrier(wk, arr);
+
 	if (!(a->flags & obj_array_flag_cow)) {
 		return;
 	}
 
 	cur = *a;
-	*a = (struct obj_array){ 0 };
+	// The contents don't change, so neither does the index.
+	*a = (struct obj_array){ .flags = cur.flags & (obj_array_flag_indexed | obj_array_flag_queried) };
 
-	obj v;
-	obj_array_for_array(wk, &cur, v) {
-		obj_array_push(wk, arr, v);
+	if (cur.len) {
+		obj_array_reserve(wk, a, cur.len);
+		memcpy(obj_array_elems(wk, a), obj_array_elems(wk, &cur), sizeof(obj) * cur.len);
+		a->len = cur.len;
+	}
+}
+
+static void
+obj_array_index_add(struct workspace *wk, struct obj_array_index *index, obj v, uint32_t i)
+{
+	switch (get_obj_type(wk, v)) {
+	case obj_string: {
+		const struct str *s = get_str(wk, v);
+		if (s->flags & str_flag_mutable) {
+			index->mutable_strs = true;
+		} else if (!hash_get_strn(&index->strs, s->s, s->len)) {
+			hash_set_strn(wk->a, &index->strs, s->s, s->len, i);
+		}
+		break;
+	}
+	case obj_number: {
+		int64_t n = get_obj_number(wk, v);
+		if (!hash_get(&index->nums, &n)) {
+			hash_set(wk->a, &index->nums, &n, i);
+		}
+		break;
+	}
+	case obj_array: index->arrays = true; break;
+	default: break;
+	}
+}
+
+static struct obj_array_index *
+obj_array_index_lookup(struct workspace *wk, obj arr, struct obj_array *a)
+{
+	if (!(a->flags & obj_array_flag_indexed)) {
+		return 0;
+	}
+
+	uint64_t *slot = hash_get(&wk->vm.objects.array_index_ids, &arr);
+	if (!slot) {
+		a->flags &= ~obj_array_flag_indexed;
+		return 0;
+	}
+
+	return bucket_arr_get(&wk->vm.objects.array_indexes, *slot);
+}
+
+/*
+ * Returns the index of arr, building it if arr is large enough and has
+ * already been searched once.  Arrays that are only searched once never pay
+ * for an index.
+ */
+static struct obj_array_index *
+obj_array_index_get(struct workspace *wk, obj arr, struct obj_array *a)
+{
+	struct obj_array_index *index;
+	if ((index = obj_array_index_lookup(wk, arr, a))) {
+		return index;
+	} else if (a->len < obj_array_index_min_len) {
+		return 0;
+	} else if (!(a->flags & obj_array_flag_queried)) {
+		a->flags |= obj_array_flag_queried;
+		return 0;
+	}
+
+	TracyCZoneAutoS;
+	struct vm_objects *objects = &wk->vm.objects;
+	uint64_t *slot;
+	if ((slot = hash_get(&objects->array_index_ids, &arr))) {
+		index = bucket_arr_get(&objects->array_indexes, *slot);
+		hash_clear(&index->strs);
+		hash_clear(&index->nums);
+		index->mutable_strs = index->arrays = false;
+	} else {
+		hash_set(wk->a, &objects->array_index_ids, &arr, objects->array_indexes.len);
+		index = bucket_arr_push(wk->a, &objects->array_indexes, &(struct obj_array_index){ 0 });
+		hash_init_str(wk->a, &index->strs, 64);
+		hash_init(wk->a, &index->nums, 64, int64_t);
+	}
+
+	const obj *e = obj_array_elems(wk, a);
+	for (uint32_t i = 0; i < a->len; ++i) {
+		obj_array_index_add(wk, index, e[i], i);
+	}
+
+	a->flags |= obj_array_flag_indexed;
+	TracyCZoneAutoE;
+	return index;
+}
+
+/*
+ * Called before arr is modified in a way that doesn't just append elements.
+ */
+static void
+obj_array_index_invalidate(struct obj_array *a)
+{
+	a->flags &= ~(obj_array_flag_indexed | obj_array_flag_queried);
+}
+
+/*
+ * Look up val in index.  Returns false if the index can't tell whether val
+ * is present.
+ */
+static bool
+obj_array_index_find(struct workspace *wk, const struct obj_array_index *index, obj val, bool *found, uint32_t *idx)
+{
+	uint64_t *v;
+
+	switch (get_obj_type(wk, val)) {
+	case obj_string: {
+		if (index->mutable_strs) {
+			return false;
+		}
+
+		const struct str *s = get_str(wk, val);
+		v = hash_get_strn(&index->strs, s->s, s->len);
+		break;
+	}
+	case obj_number: {
+		int64_t n = get_obj_number(wk, val);
+		v = hash_get(&index->nums, &n);
+		break;
+	}
+	default: return false;
+	}
+
+	if ((*found = v != 0)) {
+		*idx = *v;
 	}
+	return true;
 }
 
 bool
@@ -662,27 +1333,19 @@ obj_array_foreach_flat(struct workspace *wk, obj arr, void *usr_ctx, obj_array_i
 void
 obj_array_push(struct workspace *wk, obj arr, obj child)
 {
-	struct obj_array_elem *e;
 	struct obj_array *a;
 
 	a = get_obj_array(wk, arr);
 	obj_array_copy_on_write(wk, a, arr);
 
-	uint32_t next = wk->vm.objects.array_elems.len;
-
-	if (!a->len) {
-		a->head = next;
-	}
-
-	bucket_arr_push(wk->a, &wk->vm.objects.array_elems, &(struct obj_array_elem){ .val = child });
+	obj_array_reserve(wk, a, a->len + 1);
+	obj_array_elems(wk, a)[a->len] = child;
+	++a->len;
 
-	if (a->len) {
-		e = bucket_arr_get(&wk->vm.objects.array_elems, a->tail);
-		e->next = next;
+	struct obj_array_index *index;
+	if ((index = obj_array_index_lookup(wk, arr, a))) {
+		obj_array_index_add(wk, index, child, a->len - 1);
 	}
-
-	a->tail = next;
-	++a->len;
 }
 
 void
@@ -698,6 +1361,14 @@ obj_array_prepend(struct workspace *wk, obj *arr, obj val)
 bool
 obj_array_index_of(struct workspace *wk, obj arr, obj val, uint32_t *idx)
 {
+	struct obj_array *a = get_obj_array(wk, arr);
+	struct obj_array_index *index;
+	bool found;
+	if (a->len >= obj_array_index_min_len && (index = obj_array_index_get(wk, arr, a))
+		&& obj_array_index_find(wk, index, val, &found, idx)) {
+		return found;
+	}
+
 	obj v;
 	uint32_t i = 0;
 	obj_array_for(wk, arr, v) {
@@ -718,36 +1389,49 @@ obj_array_in(struct workspace *wk, obj arr, obj val)
 	return obj_array_index_of(wk, arr, val, &_);
 }
 
-static obj *
-obj_array_index_pointer_raw(struct workspace *wk, obj arr, int64_t i)
+/*
+ * Like obj_array_in, but also searches arrays nested in arr.
+ */
+bool
+obj_array_in_flat(struct workspace *wk, obj arr, obj val)
 {
-	struct obj_array *a = get_obj_array(wk, arr);
+	if (obj_array_in(wk, arr, val)) {
+		return true;
+	}
 
-	if (!a->len) {
-		return 0;
-	} else if (i == 0) {
-		return &((struct obj_array_elem *)bucket_arr_get(&wk->vm.objects.array_elems, a->head))->val;
-	} else if (i == a->len - 1) {
-		return &((struct obj_array_elem *)bucket_arr_get(&wk->vm.objects.array_elems, a->tail))->val;
+	const struct obj_array_index *index = obj_array_index_lookup(wk, arr, get_obj_array(wk, arr));
+	if (index && !index->arrays) {
+		return false;
 	}
 
 	obj v;
-	int64_t j = 0;
-	obj_array_for_array_(wk, a, v, iter) {
-		(void)v;
-		if (j == i) {
-			return &iter.e->val;
+	obj_array_for(wk, arr, v) {
+		if (get_obj_type(wk, v) == obj_array && obj_array_in_flat(wk, v, val)) {
+			return true;
 		}
-		++j;
 	}
 
-	return 0;
+	return false;
+}
+
+static obj *
+obj_array_index_pointer_raw(struct workspace *wk, obj arr, int64_t i)
+{
+	struct obj_array *a = get_obj_array(wk, arr);
+
+	if (i < 0 || i >= a->len) {
+		return 0;
+	}
+
+	return &obj_array_elems(wk, a)[i];
 }
 
 obj *
 obj_array_index_pointer(struct workspace *wk, obj arr, int64_t i)
 {
-	obj_array_copy_on_write(wk, get_obj_array(wk, arr), arr);
+	struct obj_array *a = get_obj_array(wk, arr);
+	obj_array_copy_on_write(wk, a, arr);
+	obj_array_index_invalidate(a);
 	return obj_array_index_pointer_raw(wk, arr, i);
 }
 
@@ -762,27 +1446,32 @@ obj_array_index(struct workspace *wk, obj arr, int64_t i)
 obj
 obj_array_get_tail(struct workspace *wk, obj arr)
 {
-	uint32_t tail = get_obj_array(wk, arr)->tail;
-	struct obj_array_elem *e = bucket_arr_get(&wk->vm.objects.array_elems, tail);
-	return e->val;
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(a->len);
+	return obj_array_elems(wk, a)[a->len - 1];
 }
 
 obj
 obj_array_get_head(struct workspace *wk, obj arr)
 {
-	uint32_t head = get_obj_array(wk, arr)->head;
-	struct obj_array_elem *e = bucket_arr_get(&wk->vm.objects.array_elems, head);
-	return e->val;
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(a->len);
+	return obj_array_elems(wk, a)[0];
 }
 
 void
 obj_array_dup(struct workspace *wk, obj arr, obj *res)
 {
 	*res = make_obj(wk, obj_array);
-	obj v;
-	obj_array_for(wk, arr, v) {
-		obj_array_push(wk, *res, v);
+
+	struct obj_array *src = get_obj_array(wk, arr), *dst = get_obj_array(wk, *res);
+	if (!src->len) {
+		return;
 	}
+
+	obj_array_reserve(wk, dst, src->len);
+	memcpy(obj_array_elems(wk, dst), obj_array_elems(wk, src), sizeof(obj) * src->len);
+	dst->len = src->len;
 }
 
 static void
@@ -791,6 +1480,8 @@ obj_array_dup_into_light(struct workspace *wk, obj src, obj dst)
 	struct obj_array *a_dst = get_obj_array(wk, dst), *a_src = get_obj_array(wk, src);
 	*a_dst = *a_src;
 	a_dst->flags |= obj_array_flag_cow;
+	// The index of src is only found by its id.
+	obj_array_index_invalidate(a_dst);
 	a_src->flags |= obj_array_flag_cow;
 }
 
@@ -808,13 +1499,11 @@ void
 obj_array_extend_nodup(struct workspace *wk, obj arr, obj arr2)
 {
 	struct obj_array *a, *b;
-	struct obj_array_elem *tail;
 
 	b = get_obj_array(wk, arr2);
 	if (!b->len) {
 		return;
 	}
-	obj_array_copy_on_write(wk, b, arr2);
 
 	a = get_obj_array(wk, arr);
 	obj_array_copy_on_write(wk, a, arr);
@@ -824,18 +1513,31 @@ obj_array_extend_nodup(struct workspace *wk, obj arr, obj arr2)
 		return;
 	}
 
-	tail = bucket_arr_get(&wk->vm.objects.array_elems, a->tail);
-	assert(!tail->next);
-	tail->next = b->head;
+	uint32_t b_len = b->len;
+	obj_array_reserve(wk, a, a->len + b_len);
+	obj *e = obj_array_elems(wk, a);
+	memcpy(e + a->len, obj_array_elems(wk, b), sizeof(obj) * b_len);
+	a->len += b_len;
 
-	a->tail = b->tail;
-	a->len += b->len;
+	struct obj_array_index *index;
+	if ((index = obj_array_index_lookup(wk, arr, a))) {
+		for (uint32_t i = a->len - b_len; i < a->len; ++i) {
+			obj_array_index_add(wk, index, e[i], i);
+		}
+	}
 }
 
 // mutates arr without modifying arr2
 void
 obj_array_extend(struct workspace *wk, obj arr, obj arr2)
 {
+	if (!get_obj_array(wk, arr)->len) {
+		// Share the storage of arr2 until one of them is modified.
+		obj_young_barrier(wk, arr);
+		obj_array_dup_into_light(wk, arr2, arr);
+		return;
+	}
+
 	obj dup;
 	obj_array_dup(wk, arr2, &dup);
 	obj_array_extend_nodup(wk, arr, dup);
@@ -911,21 +1613,35 @@ obj_array_join(struct workspace *wk, bool flat, obj arr, obj join, obj *res)
 	return true;
 }
 
-void
-obj_array_tail(struct workspace *wk, obj arr, obj *res)
-{
-	const struct obj_array *a = get_obj_array(wk, arr);
+/*
+ * Returns a view sharing storage with arr.  Both arrays are marked
+ * copy-on-write.
+ */
+static obj
+obj_array_view(struct workspace *wk, obj arr, uint32_t start)
+{
+	obj res = make_obj(wk, obj_array);
+	struct obj_array *a = get_obj_array(wk, arr), *n = get_obj_array(wk, res);
+
+	if (start < a->len) {
+		*n = (struct obj_array){
+			.chunk = a->chunk,
+			.start = a->start + start,
+			.len = a->len - start,
+			.cap = a->len - start,
+			.flags = obj_array_flag_cow,
+		};
 
-	*res = make_obj(wk, obj_array);
+		a->flags |= obj_array_flag_cow;
+	}
 
-	if (a->len > 1) {
-		struct obj_array *n = get_obj_array(wk, *res);
-		struct obj_array_elem *head = bucket_arr_get(&wk->vm.objects.array_elems, a->head);
+	return res;
+}
 
-		n->head = head->next;
-		n->tail = a->tail;
-		n->len = a->len;
-	}
+void
+obj_array_tail(struct workspace *wk, obj arr, obj *res)
+{
+	*res = obj_array_view(wk, arr, 1);
 }
 
 void
@@ -941,48 +1657,12 @@ obj_array_del(struct workspace *wk, obj arr, int64_t i)
 {
 	struct obj_array *a = get_obj_array(wk, arr);
 	obj_array_copy_on_write(wk, a, arr);
-
-	struct obj_array_elem *head = bucket_arr_get(&wk->vm.objects.array_elems, a->head), *prev = 0;
-	uint32_t head_idx = a->head, prev_idx = 0;
+	obj_array_index_invalidate(a);
 
 	assert(i >= 0 && i < a->len);
 
-#if 0
-	if (i == 0) {
-		if (a->len >= 1) {
-			head = bucket_arr_get(&wk->vm.objects.array_elems, a->head);
-			a->head = head->next;
-			--a->len;
-		} else {
-			*a = (struct obj_array){ 0 };
-		}
-
-		return;
-	}
-#endif
-
-	int64_t j = 0;
-	while (true) {
-		if (j == i) {
-			break;
-		}
-
-		prev_idx = head_idx;
-		prev = head;
-		head_idx = head->next;
-		head = bucket_arr_get(&wk->vm.objects.array_elems, head_idx);
-		++j;
-	}
-
-	if (i == 0) {
-		a->head = head->next;
-	} else if (i == a->len - 1) {
-		a->tail = prev_idx;
-		prev->next = 0;
-	} else {
-		prev->next = head->next;
-	}
-
+	obj *e = obj_array_elems(wk, a);
+	memmove(&e[i], &e[i + 1], sizeof(obj) * (a->len - i - 1));
 	--a->len;
 }
 
@@ -997,49 +1677,79 @@ obj_array_pop(struct workspace *wk, obj arr)
 void
 obj_array_clear(struct workspace *wk, obj arr)
 {
+	obj_young_barrier(wk, arr);
+
 	struct obj_array *a = get_obj_array(wk, arr);
 	*a = (struct obj_array){ 0 };
 }
 
-void
-obj_array_dedup(struct workspace *wk, obj arr, obj *res)
+/*
+ * Returns true if val is equal to an element seen before.  kept holds the
+ * len elements that have been kept so far.
+ */
+static bool
+obj_array_dedup_seen(struct workspace *wk, struct hash *objs, struct hash *strs, obj kept, uint32_t len, obj val)
+{
+	switch (get_obj_type(wk, val)) {
+	case obj_file:
+		val = *get_obj_file(wk, val);
+		/* fallthrough */
+	case obj_string: {
+		const struct str *s = get_str(wk, val);
+		if (hash_get_strn(strs, s->s, s->len)) {
+			return true;
+		}
+		hash_set_strn(wk->a_scratch, strs, s->s, s->len, true);
+		return false;
+	}
+	default: {
+		if (hash_get(objs, &val)) {
+			return true;
+		}
+		hash_set(wk->a_scratch, objs, &val, true);
+
+		uint32_t idx;
+		return obj_array_index_of(wk, kept, val, &idx) && idx < len;
+	}
+	}
+}
+
+/*
+ * Returns a new array with the elements of arr minus duplicates.  If arr has
+ * no duplicates the result shares its storage until one of them is modified.
+ */
+static obj
+obj_array_dedup_impl(struct workspace *wk, obj arr)
 {
 	struct hash objs, strs;
 	hash_init(wk->a_scratch, &objs, 128, obj);
 	hash_init_str(wk->a_scratch, &strs, 128);
 
-	*res = make_obj(wk, obj_array);
-
-	obj val, oval;
+	obj res = 0, val;
+	uint32_t i = 0;
 	obj_array_for(wk, arr, val) {
-		oval = val;
-		switch (get_obj_type(wk, val)) {
-		case obj_file:
-			val = *get_obj_file(wk, val);
-			/* fallthrough */
-		case obj_string: {
-			const struct str *s = get_str(wk, val);
-			if (hash_get_strn(&strs, s->s, s->len)) {
-				continue;
-			}
-			hash_set_strn(wk->a_scratch, &strs, s->s, s->len, true);
-
-			obj_array_push(wk, *res, oval);
-			break;
+		bool seen;
+		if (res) {
+			seen = obj_array_dedup_seen(wk, &objs, &strs, res, get_obj_array(wk, res)->len, val);
+		} else {
+			seen = obj_array_dedup_seen(wk, &objs, &strs, arr, i, val);
 		}
-		default: {
-			if (hash_get(&objs, &val)) {
-				continue;
-			}
-			hash_set(wk->a_scratch, &objs, &val, true);
 
-			if (!obj_array_in(wk, *res, val)) {
-				obj_array_push(wk, *res, val);
-			}
-			break;
-		}
+		if (!res && seen) {
+			res = obj_array_slice(wk, arr, 0, i);
+		} else if (res && !seen) {
+			obj_array_push(wk, res, val);
 		}
+		++i;
 	}
+
+	return res ? res : obj_array_dup_light(wk, arr);
+}
+
+void
+obj_array_dedup(struct workspace *wk, obj arr, obj *res)
+{
+	*res = obj_array_dedup_impl(wk, arr);
 }
 
 void
@@ -1049,9 +1759,7 @@ obj_array_dedup_in_place(struct workspace *wk, obj *arr)
 		return;
 	}
 
-	obj dedupd;
-	obj_array_dedup(wk, *arr, &dedupd);
-	*arr = dedupd;
+	*arr = obj_array_dedup_impl(wk, *arr);
 }
 
 bool
@@ -1145,41 +1853,21 @@ obj_array_slice(struct workspace *wk, obj a, uint32_t start, uint32_t end)
 {
 	struct obj_array *src = get_obj_array(wk, a);
 
-	obj res;
-	res = make_obj(wk, obj_array);
-	struct obj_array *dst = get_obj_array(wk, res);
-
-	if (start == end) {
+	if (start >= end) {
 		// empty slice
-		return res;
+		return make_obj(wk, obj_array);
+	} else if (end == src->len) {
+		return obj_array_view(wk, a, start);
 	}
 
-	const bool tail_slice = end == src->len;
-	uint32_t prev_elem = src->head;
-
-	obj v;
-	obj_array_for_array_(wk, src, v, iter) {
-		if (iter.i >= end) {
-			break;
-		}
-
-		if (iter.i >= start) {
-			if (tail_slice) {
-				src->flags |= obj_array_flag_cow;
-
-				dst->len = src->len - start;
-				dst->head = prev_elem;
-				dst->tail = src->tail;
-				dst->flags |= obj_array_flag_cow;
-				return res;
-			}
-
-			obj_array_push(wk, res, v);
-		}
-
-		prev_elem = iter.e->next;
-	}
+	obj res;
+	res = make_obj(wk, obj_array);
+	struct obj_array *dst = get_obj_array(wk, res);
+	src = get_obj_array(wk, a);
 
+	obj_array_reserve(wk, dst, end - start);
+	memcpy(obj_array_elems(wk, dst), obj_array_elems(wk, src) + start, sizeof(obj) * (end - start));
+	dst->len = end - start;
 	return res;
 }
 
@@ -1337,6 +2025,8 @@ obj_dict_copy_on_write(struct workspace *wk, obj dict)
 {
 	struct obj_dict *d = get_obj_dict(wk, dict), cur;
 
+	obj_young_barrier(wk, dict);
+
 	if (!(d->flags & obj_dict_flag_cow)) {
 		return;
 	}
@@ -1351,6 +2041,36 @@ obj_dict_copy_on_write(struct workspace *wk, obj dict)
 	}
 }
 
+/* Push a pointer to each value of dict onto res.  The pointers are only valid
+ * until dict is modified. */
+void
+obj_dict_val_pointers(struct workspace *wk, obj dict, struct arena *a, struct arr *res)
+{
+	struct obj_dict *d = get_obj_dict(wk, dict);
+	if (!d->len) {
+		return;
+	}
+
+	if (d->flags & obj_dict_flag_big) {
+		struct hash *h = bucket_arr_get(&wk->vm.objects.dict_hashes, d->data);
+		for (uint32_t i = 0; i < h->keys.len; ++i) {
+			union obj_dict_big_dict_value *val
+				= (union obj_dict_big_dict_value *)hash_get(h, bucket_arr_get(&h->keys, i));
+			arr_push(a, res, &(obj *){ &val->val.val });
+		}
+	} else {
+		struct obj_dict_elem *e = bucket_arr_get(&wk->vm.objects.dict_elems, d->data);
+		while (true) {
+			arr_push(a, res, &(obj *){ &e->val });
+
+			if (!e->next) {
+				break;
+			}
+			e = bucket_arr_get(&wk->vm.objects.dict_elems, e->next);
+		}
+	}
+}
+
 obj *
 obj_dict_index_strn_pointer(struct workspace *wk, obj dict, const char *str, uint32_t len)
 {
@@ -1389,6 +2109,31 @@ obj_dict_in(struct workspace *wk, obj dict, obj key)
 	return obj_dict_index(wk, dict, key, &res);
 }
 
+static void
+obj_dict_hash_init(struct workspace *wk, struct hash *h, bool int_key)
+{
+	struct arr *free_hashes = &wk->vm.objects.dict_hashes_free;
+	uint32_t i;
+
+	// Reuse a table released by obj_clear_mark_restore() with the same key
+	// type if there is one.
+	for (i = free_hashes->len; i > 0; --i) {
+		struct hash *free_h = arr_get(free_hashes, i - 1);
+		if ((free_h->key_size == sizeof(obj)) == int_key) {
+			*h = *free_h;
+			*free_h = *(struct hash *)arr_pop(free_hashes);
+			hash_clear(h);
+			return;
+		}
+	}
+
+	if (int_key) {
+		hash_init(wk->a, h, 16, obj);
+	} else {
+		hash_init_str(wk->a, h, 16);
+	}
+}
+
 static void
 obj_dict_set_impl(struct workspace *wk,
 	obj dict,
@@ -1415,11 +2160,7 @@ obj_dict_set_impl(struct workspace *wk,
 		struct obj_dict_elem *e = bucket_arr_get(&wk->vm.objects.dict_elems, d->data);
 		uint32_t h_idx = wk->vm.objects.dict_hashes.len;
 		struct hash *h = bucket_arr_push(wk->a, &wk->vm.objects.dict_hashes, &(struct hash){ 0 });
-		if (d->flags & obj_dict_flag_int_key) {
-			hash_init(wk->a, h, 16, obj);
-		} else {
-			hash_init_str(wk->a, h, 16);
-		}
+		obj_dict_hash_init(wk, h, d->flags & obj_dict_flag_int_key);
 		d->data = h_idx;
 		d->tail = 0; // unnecessary but nice
 
@@ -1682,7 +2423,10 @@ obj_clone_impl(struct workspace *wk_src, struct workspace *wk_dest, struct hash
 {
 	*ret = 0;
 
-	if (val >= wk_src->vm.objects.objs.len) {
+	if (val & OBJ_NUMBER_IMMEDIATE_TAG) {
+		*ret = val;
+		return true;
+	} else if (val >= wk_src->vm.objects.objs.len) {
 		LOG_E("invalid object");
 		return false;
 	}
@@ -1706,8 +2450,7 @@ obj_clone_impl(struct workspace *wk_src, struct workspace *wk_dest, struct hash
 		break;
 	}
 	case obj_number: {
-		*ret = make_obj(wk_dest, t);
-		set_obj_number(wk_dest, *ret, get_obj_number(wk_src, val));
+		*ret = make_number(wk_dest, get_obj_number(wk_src, val));
 		break;
 	}
 	case obj_string: {
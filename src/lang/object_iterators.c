@@ -15,25 +15,25 @@ obj_array_flat_iter_next(struct workspace *wk, obj arr, struct obj_array_flat_it
 
 	if (!ctx->init) {
 		struct obj_array *a = get_obj_array(wk, arr);
-		ctx->e = a->len ? bucket_arr_get(&wk->vm.objects.array_elems, a->head) : 0;
+		ctx->pos = (struct obj_array_flat_iter_pos){ .e = obj_array_elems(wk, a), .len = a->len };
 		ctx->pushed = 0;
 		ctx->init = true;
 	}
 
-	while (ctx->e && !v) {
-		v = ctx->e->val;
+	while (ctx->pos.i < ctx->pos.len && !v) {
+		v = ctx->pos.e[ctx->pos.i];
 
 		while (get_obj_type(wk, v) == obj_array) {
 			struct obj_array *a = get_obj_array(wk, v);
-			struct obj_array_elem *e = 0;
 			if (!a->len) {
 				v = 0;
 				goto skip;
 			}
 
-			e = bucket_arr_get(&wk->vm.objects.array_elems, a->head);
-			v = e->val;
-			stack_push(&wk->stack, ctx->e, e);
+			stack_push(&wk->stack,
+				ctx->pos,
+				((struct obj_array_flat_iter_pos){ .e = obj_array_elems(wk, a), .len = a->len }));
+			v = ctx->pos.e[0];
 			++ctx->pushed;
 		}
 
@@ -58,16 +58,12 @@ obj_array_flat_iter_next(struct workspace *wk, obj arr, struct obj_array_flat_it
 #endif
 
 skip:
+		++ctx->pos.i;
 
-		while (!ctx->e->next && ctx->pushed) {
-			stack_pop(&wk->stack, ctx->e);
+		while (ctx->pos.i >= ctx->pos.len && ctx->pushed) {
+			stack_pop(&wk->stack, ctx->pos);
 			--ctx->pushed;
-		}
-
-		if (ctx->e->next) {
-			ctx->e = bucket_arr_get(&wk->vm.objects.array_elems, ctx->e->next);
-		} else {
-			ctx->e = 0;
+			++ctx->pos.i;
 		}
 	}
 
@@ -78,7 +74,7 @@ void
 obj_array_flat_iter_end(struct workspace *wk, struct obj_array_flat_iter_ctx *ctx)
 {
 	while (ctx->pushed) {
-		stack_pop(&wk->stack, ctx->e);
+		stack_pop(&wk->stack, ctx->pos);
 		--ctx->pushed;
 	}
 }
@@ -20,6 +20,49 @@
 #include "platform/assert.h"
 #include "tracy.h"
 
+/******************************************************************************
+ * nodes
+ ******************************************************************************/
+
+struct node *
+node_get(struct workspace *wk, uint32_t id)
+{
+	return id ? bucket_arr_get(&wk->vm.compiler_state.nodes, id) : 0;
+}
+
+struct node *
+node_l(struct workspace *wk, const struct node *n)
+{
+	return node_get(wk, n->l);
+}
+
+struct node *
+node_r(struct workspace *wk, const struct node *n)
+{
+	return node_get(wk, n->r);
+}
+
+uint32_t
+node_id(const struct node *n)
+{
+	return n ? n->id : 0;
+}
+
+struct node_fmt *
+node_fmt(struct workspace *wk, const struct node *n)
+{
+	struct arr *fmt = &wk->vm.compiler_state.node_fmt;
+	if (!fmt->item_size) {
+		arr_init(wk->a_scratch, fmt, 1024, struct node_fmt);
+	}
+
+	if (n->id >= fmt->len) {
+		arr_grow_to(wk->a_scratch, fmt, n->id + 1);
+	}
+
+	return arr_get(fmt, n->id);
+}
+
 /******************************************************************************
  * parser
  ******************************************************************************/
@@ -215,9 +258,10 @@ fmt_node_to_s(struct workspace *wk, const struct node *n)
 	}
 
 	i += obj_snprintf(wk, &buf[i], sizeof(buf) - i, ":");
-	fmt_node_ws_to_s(wk, n->fmt.pre.list, buf, sizeof(buf), &i);
+	const struct node_fmt *fmt = node_fmt(wk, n);
+	fmt_node_ws_to_s(wk, fmt->pre.list, buf, sizeof(buf), &i);
 	i += obj_snprintf(wk, &buf[i], sizeof(buf) - i, ":");
-	fmt_node_ws_to_s(wk, n->fmt.post.list, buf, sizeof(buf), &i);
+	fmt_node_ws_to_s(wk, fmt->post.list, buf, sizeof(buf), &i);
 
 	return buf;
 }
@@ -259,10 +303,10 @@ print_fmt_ast_at(struct workspace *wk, struct node *n, uint32_t d, char label)
 	log_raw("%c:%s\n", label, fmt_node_to_s(wk, n));
 
 	if (n->l) {
-		print_fmt_ast_at(wk, n->l, d + 1, 'l');
+		print_fmt_ast_at(wk, node_l(wk, n), d + 1, 'l');
 	}
 	if (n->r) {
-		print_fmt_ast_at(wk, n->r, d + 1, 'r');
+		print_fmt_ast_at(wk, node_r(wk, n), d + 1, 'r');
 	}
 }
 
@@ -282,10 +326,10 @@ print_ast_at(struct workspace *wk, struct node *n, uint32_t d, char label)
 	}
 
 	if (n->l) {
-		print_ast_at(wk, n->l, d + 1, 'l');
+		print_ast_at(wk, node_l(wk, n), d + 1, 'l');
 	}
 	if (n->r) {
-		print_ast_at(wk, n->r, d + 1, 'r');
+		print_ast_at(wk, node_r(wk, n), d + 1, 'r');
 	}
 }
 
@@ -509,15 +553,33 @@ parse_expect(struct parser *p, enum token_type type)
 static struct node *
 make_node(struct parser *p, struct node *n)
 {
-	n = bucket_arr_push(p->wk->a, p->nodes, n);
+	n->id = p->nodes->len;
+	n = bucket_arr_push(p->wk->a_scratch, p->nodes, n);
 	if (p->previous.type) {
 		n->location = p->previous.location;
 		n->data = p->previous.data;
-		parse_fmt_apply(p, &n->fmt.pre, &p->fmt.previous);
+		if (p->mode & vm_compile_mode_fmt) {
+			parse_fmt_apply(p, &node_fmt(p->wk, n)->pre, &p->fmt.previous);
+		}
 	}
 	return n;
 }
 
+/* Attach c as the left or right child of n, returning c. */
+static struct node *
+node_set_l(struct node *n, struct node *c)
+{
+	n->l = node_id(c);
+	return c;
+}
+
+static struct node *
+node_set_r(struct node *n, struct node *c)
+{
+	n->r = node_id(c);
+	return c;
+}
+
 static struct node *
 make_node_t(struct parser *p, enum node_type t)
 {
@@ -660,8 +722,8 @@ parse_id_assign(struct parser *p, struct node *id, enum node_assign_flag flags)
 	struct node *n = make_node_assign(p, flags);
 	n->location = id->location;
 	id->type = node_type_id_lit;
-	n->l = id;
-	n->r = parse_expr(p, false);
+	n->l = id->id;
+	node_set_r(n, parse_expr(p, false));
 	return n;
 }
 
@@ -712,7 +774,7 @@ parse_emit_coerce(struct parser *p, struct node *child, enum obj_type coerce_typ
 {
 	struct node *n = make_node_t(p, node_type_coerce);
 	n->data.type = coerce_type;
-	n->l = child;
+	node_set_l(n, child);
 	return n;
 }
 
@@ -751,33 +813,33 @@ parse_fstring(struct parser *p, bool assignment_allowed)
 						res = n = make_node_t(p, node_type_add);
 					} else {
 						if (n->type == node_type_add) {
-							prev_rhs = n->r;
-							n = n->r = make_node_t(p, node_type_add);
+							prev_rhs = node_r(p->wk, n);
+							n = node_set_r(n, make_node_t(p, node_type_add));
 						} else {
 							prev_rhs = n;
 							res = n = make_node_t(p, node_type_add);
 						}
 
-						n->l = prev_rhs;
-						n = n->r = make_node_t(p, node_type_add);
+						node_set_l(n, prev_rhs);
+						n = node_set_r(n, make_node_t(p, node_type_add));
 					}
 
-					n->l = lhs;
-					n->r = rhs;
+					node_set_l(n, lhs);
+					node_set_r(n, rhs);
 				} else {
 					if (!n) {
 						res = n = rhs;
 					} else {
 						if (n->type == node_type_add) {
-							prev_rhs = n->r;
-							n = n->r = make_node_t(p, node_type_add);
+							prev_rhs = node_r(p->wk, n);
+							n = node_set_r(n, make_node_t(p, node_type_add));
 						} else {
 							prev_rhs = n;
 							res = n = make_node_t(p, node_type_add);
 						}
 
-						n->l = prev_rhs;
-						n->r = rhs;
+						node_set_l(n, prev_rhs);
+						node_set_r(n, rhs);
 					}
 				}
 
@@ -797,15 +859,15 @@ parse_fstring(struct parser *p, bool assignment_allowed)
 			res = n = make_node_t(p, node_type_string);
 		} else {
 			if (n->type == node_type_add) {
-				prev_rhs = n->r;
-				n = n->r = make_node_t(p, node_type_add);
+				prev_rhs = node_r(p->wk, n);
+				n = node_set_r(n, make_node_t(p, node_type_add));
 			} else {
 				prev_rhs = n;
 				res = n = make_node_t(p, node_type_add);
 			}
 
-			n->l = prev_rhs;
-			n = n->r = make_node_t(p, node_type_string);
+			node_set_l(n, prev_rhs);
+			n = node_set_r(n, make_node_t(p, node_type_string));
 		}
 		n->data.str = make_strn(p->wk, str.s, str.len);
 	}
@@ -840,26 +902,26 @@ parse_binary(struct parser *p, struct node *l, bool assignment_allowed)
 	}
 
 	n = make_node_t(p, t);
-	n->l = l;
-	n->r = parse_prec(p, p->parse_rules[prev].precedence + 1, assignment_allowed);
+	n->l = l->id;
+	struct node *r = node_set_r(n, parse_prec(p, p->parse_rules[prev].precedence + 1, assignment_allowed));
 
-	n->location = source_location_merge(n->l->location, n->r->location);
+	n->location = source_location_merge(l->location, r->location);
 	return n;
 }
 
 static struct node *
 parse_ternary(struct parser *p, struct node *l, bool assignment_allowed)
 {
-	struct node *n;
+	struct node *n, *branches, *r;
 
 	n = make_node_t(p, node_type_ternary);
-	n->l = l;
-	n->r = make_node_t(p, node_type_list);
-	n->r->l = parse_prec(p, parse_precedence_assignment, false);
+	n->l = l->id;
+	branches = node_set_r(n, make_node_t(p, node_type_list));
+	node_set_l(branches, parse_prec(p, parse_precedence_assignment, false));
 	parse_expect(p, ':');
-	n->r->r = parse_prec(p, parse_precedence_assignment, false);
+	r = node_set_r(branches, parse_prec(p, parse_precedence_assignment, false));
 
-	n->location = source_location_merge(n->l->location, n->r->r->location);
+	n->location = source_location_merge(l->location, r->location);
 	return n;
 }
 
@@ -875,15 +937,15 @@ parse_index(struct parser *p, struct node *l, bool assignment_allowed)
 		&& (parse_accept(p, '=') || parse_accept(p, token_type_plus_assign))) {
 		n = make_node_assign(p, node_assign_flag_member);
 		n->location = key->location;
-		n->l = key;
-		n->r = make_node_t(p, node_type_list);
-		n->r->l = l;
-		n->r->r = parse_expr(p, false);
+		n->l = key->id;
+		struct node *target = node_set_r(n, make_node_t(p, node_type_list));
+		target->l = l->id;
+		node_set_r(target, parse_expr(p, false));
 	} else {
 		n = make_node_t(p, node_type_index);
 		n->location = key->location;
-		n->l = l;
-		n->r = key;
+		n->l = l->id;
+		n->r = key->id;
 	}
 
 	return n;
@@ -899,7 +961,7 @@ parse_unary(struct parser *p, bool assignment_allowed)
 	default: UNREACHABLE;
 	}
 
-	n->l = parse_prec(p, parse_precedence_unary, assignment_allowed);
+	node_set_l(n, parse_prec(p, parse_precedence_unary, assignment_allowed));
 	return n;
 }
 
@@ -915,9 +977,9 @@ static struct node *
 parse_grouping_fmt(struct parser *p, bool assignment_allowed)
 {
 	struct node *n = make_node_t(p, node_type_group);
-	n->l = parse_prec(p, parse_precedence_assignment, assignment_allowed);
+	struct node *l = node_set_l(n, parse_prec(p, parse_precedence_assignment, assignment_allowed));
 	parse_expect(p, ')');
-	parse_fmt_apply(p, &n->l->fmt.post, &p->fmt.previous);
+	parse_fmt_apply(p, &node_fmt(p->wk, l)->post, &p->fmt.previous);
 	return n;
 }
 
@@ -974,9 +1036,8 @@ parse_list(struct parser *p, enum node_type t, enum token_type end, bool consume
 				parse_error(p, 0, "expected type");
 			}
 
-			val->l = make_node_t(p, node_type_list);
-			val->l->data.type = type;
-			val->r = doc;
+			node_set_l(val, make_node_t(p, node_type_list))->data.type = type;
+			node_set_r(val, doc);
 
 			if (parse_accept(p, ':')) {
 				key = val;
@@ -1000,20 +1061,21 @@ parse_list(struct parser *p, enum node_type t, enum token_type end, bool consume
 			val = make_node_t(p, node_type_list);
 		}
 
+		struct node *elem;
 		if (key) {
 			got_kw = true;
-			n->l = make_node_t(p, node_type_kw);
-			n->l->r = key;
-			n->l->l = val;
+			elem = node_set_l(n, make_node_t(p, node_type_kw));
+			node_set_r(elem, key);
+			node_set_l(elem, val);
 			++kwlen;
 		} else {
-			n->l = val;
+			elem = node_set_l(n, val);
 			++len;
 		}
 
 		if (!parse_accept(p, ',')) {
-			if (n->l) {
-				n->l->fmt.post = p->fmt.current;
+			if (elem && p->mode & vm_compile_mode_fmt) {
+				node_fmt(p->wk, elem)->post = p->fmt.current;
 			}
 
 			if (!relaxed) {
@@ -1021,14 +1083,14 @@ parse_list(struct parser *p, enum node_type t, enum token_type end, bool consume
 			}
 		}
 
-		if (p->current.type == end && n->l) {
+		if (p->current.type == end && elem && p->mode & vm_compile_mode_fmt) {
 			// Don't break here, let n->r be made and then break.
 			// This is so the formatter can know there was a
 			// trailing comma here.
-			n->l->fmt.post = p->fmt.current;
+			node_fmt(p->wk, elem)->post = p->fmt.current;
 		}
 
-		n = n->r = make_node_t(p, node_type_list);
+		n = node_set_r(n, make_node_t(p, node_type_list));
 	}
 
 	parse_expect(p, end);
@@ -1057,13 +1119,13 @@ parse_call(struct parser *p, struct node *l, bool assignment_allowed)
 {
 	struct node *n;
 	n = make_node_t(p, node_type_call);
-	n->r = l;
-	n->l = p->behavior.parse_list(p, node_type_args, ')', true);
+	n->r = l->id;
+	node_set_l(n, p->behavior.parse_list(p, node_type_args, ')', true));
 
 	n->location = source_location_merge(l->location, p->previous.location);
 
-	if (n->r->type == node_type_id) {
-		n->r->type = node_type_id_lit;
+	if (l->type == node_type_id) {
+		l->type = node_type_id_lit;
 	}
 	return n;
 }
@@ -1090,16 +1152,16 @@ parse_member(struct parser *p, struct node *l, bool assignment_allowed)
 		if (!(p->mode & vm_compile_mode_fmt)) {
 			id->type = node_type_string;
 		}
-		n->l = id;
-		n->r = make_node_t(p, node_type_list);
-		n->r->l = l;
-		n->r->r = parse_expr(p, false);
+		n->l = id->id;
+		struct node *target = node_set_r(n, make_node_t(p, node_type_list));
+		target->l = l->id;
+		node_set_r(target, parse_expr(p, false));
 	} else {
 		n = make_node_t(p, node_type_member);
-		n->l = l;
-		n->r = id;
+		n->l = l->id;
+		n->r = id->id;
 
-		n->location = source_location_merge(l->location, n->r->location);
+		n->location = source_location_merge(l->location, id->location);
 
 		if (!((p->mode & vm_compile_mode_language_extended) || relaxed)) {
 			parse_expect_noadvance(p, '(');
@@ -1114,13 +1176,13 @@ parse_func_params_and_body(struct parser *p, struct node *id)
 {
 	struct node *n = make_node_t(p, node_type_func_def);
 
-	n->l = make_node_t(p, node_type_list);
-	n->l->l = make_node_t(p, node_type_list);
-	n->l->l->l = id;
-	n->l->l->r = parser_get_doc_comment(p);
+	struct node *sig = node_set_l(n, make_node_t(p, node_type_list));
+	struct node *name = node_set_l(sig, make_node_t(p, node_type_list));
+	node_set_l(name, id);
+	node_set_r(name, parser_get_doc_comment(p));
 
 	parse_expect(p, '(');
-	n->l->r = p->behavior.parse_list(p, node_type_def_args, ')', true);
+	node_set_r(sig, p->behavior.parse_list(p, node_type_def_args, ')', true));
 
 	if (parse_accept(p, token_type_returntype)) {
 		parse_type(p, &n->data.type, true);
@@ -1133,7 +1195,7 @@ parse_func_params_and_body(struct parser *p, struct node *id)
 
 	parse_accept(p, token_type_eol);
 
-	n->r = parse_block(p, (enum token_type[]){ token_type_endfunc }, 1, parse_stmt_flag_eol_optional);
+	node_set_r(n, parse_block(p, (enum token_type[]){ token_type_endfunc }, 1, parse_stmt_flag_eol_optional));
 	parse_expect(p, token_type_endfunc);
 
 	return n;
@@ -1180,43 +1242,44 @@ parse_stmt(struct parser *p, enum parse_stmt_flags flags)
 		struct node *parent;
 		parent = n = make_node_t(p, node_type_if);
 		while (true) {
-			n->l = make_node_t(p, node_type_list);
-			n->l->l = p->previous.type == token_type_else ? 0 : parse_expr(p, false);
+			struct node *branch = node_set_l(n, make_node_t(p, node_type_list));
+			node_set_l(branch, p->previous.type == token_type_else ? 0 : parse_expr(p, false));
 			parse_expect(p, token_type_eol);
-			n->l->r = parse_block(p,
-				(enum token_type[]){ token_type_elif, token_type_else, token_type_endif },
-				3,
-				parse_stmt_flag_eol_optional);
+			node_set_r(branch,
+				parse_block(p,
+					(enum token_type[]){ token_type_elif, token_type_else, token_type_endif },
+					3,
+					parse_stmt_flag_eol_optional));
 
 			if (!(parse_accept(p, token_type_elif) || parse_accept(p, token_type_else))) {
 				break;
 			}
 
-			n = n->r = make_node_t(p, node_type_if);
+			n = node_set_r(n, make_node_t(p, node_type_if));
 		}
 
 		parse_expect(p, token_type_endif);
 		n = parent;
 	} else if (parse_accept(p, token_type_foreach)) {
 		n = make_node_t(p, node_type_foreach);
-		n->l = make_node_t(p, node_type_foreach_args);
+		struct node *args = node_set_l(n, make_node_t(p, node_type_foreach_args));
 
 		parse_expect(p, token_type_identifier);
-		n->l->l = make_node_t(p, node_type_list);
-		n->l->l->l = parse_id(p, false);
+		struct node *ids = node_set_l(args, make_node_t(p, node_type_list));
+		node_set_l(ids, parse_id(p, false));
 
 		if (parse_accept(p, ',')) {
 			parse_expect(p, token_type_identifier);
-			n->l->l->r = parse_id(p, false);
+			node_set_r(ids, parse_id(p, false));
 		}
 
 		parse_expect(p, ':');
-		n->l->r = parse_expr(p, false);
+		node_set_r(args, parse_expr(p, false));
 
 		parse_expect(p, token_type_eol);
 
 		++p->inside_loop;
-		n->r = parse_block(p, (enum token_type[]){ token_type_endforeach }, 1, parse_stmt_flag_eol_optional);
+		node_set_r(n, parse_block(p, (enum token_type[]){ token_type_endforeach }, 1, parse_stmt_flag_eol_optional));
 		--p->inside_loop;
 
 		parse_expect(p, token_type_endforeach);
@@ -1231,7 +1294,7 @@ parse_stmt(struct parser *p, enum parse_stmt_flags flags)
 		n = make_node_t(p, node_type_return);
 
 		if (p->current.type != token_type_eol) {
-			n->l = parse_expr(p, false);
+			node_set_l(n, parse_expr(p, false));
 		}
 	} else {
 		n = parse_expr(p, true);
@@ -1291,7 +1354,7 @@ parse_block(struct parser *p, enum token_type types[], uint32_t types_len, enum
 			res = n = make_node_t(p, node_type_stmt);
 		}
 
-		n->l = p->behavior.parse_stmt(p, flags);
+		node_set_l(n, p->behavior.parse_stmt(p, flags));
 
 		if ((flags & parse_stmt_flag_eol_optional) && p->previous.type != token_type_eol) {
 			break;
@@ -1299,12 +1362,12 @@ parse_block(struct parser *p, enum token_type types[], uint32_t types_len, enum
 			break;
 		}
 
-		n = n->r = make_node_t(p, node_type_stmt);
+		n = node_set_r(n, make_node_t(p, node_type_stmt));
 	}
 
 	if (p->mode & vm_compile_mode_fmt) {
 		if (n) {
-			parse_fmt_apply(p, &n->fmt.post, &p->fmt.previous);
+			parse_fmt_apply(p, &node_fmt(p->wk, n)->post, &p->fmt.previous);
 		} else {
 			res = n = make_node_t(p, node_type_stmt);
 		}
@@ -1321,6 +1384,10 @@ parser_init(struct workspace *wk,
 	const struct parse_rule *rules,
 	struct parser *p)
 {
+	if (!wk->vm.compiler_state.nodes.item_size) {
+		vm_compile_state_reset(wk);
+	}
+
 	*p = (struct parser){
 		.wk = wk,
 		.nodes = &wk->vm.compiler_state.nodes,
@@ -1512,12 +1579,11 @@ static struct node *
 cm_parse_emit_named_call(struct parser *p, const char *name, struct node *arg)
 {
 	struct node *n = make_node_t(p, node_type_call);
-	n->r = make_node_t(p, node_type_id_lit);
-	n->r->data.str = make_str(p->wk, name);
-	n->l = make_node_t(p, node_type_args);
-	n->l->l = arg;
-	n->l->data.len.args = 1;
-	n->l->data.len.kwargs = 0;
+	node_set_r(n, make_node_t(p, node_type_id_lit))->data.str = make_str(p->wk, name);
+	struct node *args = node_set_l(n, make_node_t(p, node_type_args));
+	node_set_l(args, arg);
+	args->data.len.args = 1;
+	args->data.len.kwargs = 0;
 	return n;
 }
 
@@ -1650,8 +1716,8 @@ next_char:
 			if (root) {
 				struct node *l = root;
 				root = make_node_t(p, node_type_add);
-				root->l = l;
-				root->r = n;
+				node_set_l(root, l);
+				node_set_r(root, n);
 			} else {
 				root = n;
 			}
@@ -1693,22 +1759,23 @@ cm_parse_stmt(struct parser *p, enum parse_stmt_flags flags)
 		struct node *parent;
 		parent = n = make_node_t(p, node_type_if);
 		while (true) {
-			n->l = make_node_t(p, node_type_list);
+			struct node *branch = node_set_l(n, make_node_t(p, node_type_list));
 
 			if (p->previous.type == token_type_else) {
 				cm_parse_ignored_list(p);
 			} else {
-				n->l->l = cm_parse_with_mode(p, cm_parse_mode_conditional, parse_expr);
+				node_set_l(branch, cm_parse_with_mode(p, cm_parse_mode_conditional, parse_expr));
 			}
 			parse_expect(p, token_type_eol);
-			n->l->r = parse_block(
-				p, (enum token_type[]){ token_type_elif, token_type_else, token_type_endif }, 3, 0);
+			node_set_r(branch,
+				parse_block(
+					p, (enum token_type[]){ token_type_elif, token_type_else, token_type_endif }, 3, 0));
 
 			if (!(parse_accept(p, token_type_elif) || parse_accept(p, token_type_else))) {
 				break;
 			}
 
-			n = n->r = make_node_t(p, node_type_if);
+			n = node_set_r(n, make_node_t(p, node_type_if));
 		}
 
 		parse_expect(p, token_type_endif);
@@ -1744,10 +1811,10 @@ cm_parse_list(struct parser *p, enum node_type t, enum token_type end, bool cons
 	uint32_t len = 0;
 
 	while (p->current.type != end && p->current.type != token_type_eol) {
-		n->l = parse_expr(p, false);
+		node_set_l(n, parse_expr(p, false));
 		++len;
 		if (p->current.type != end) {
-			n = n->r = make_node_t(p, node_type_list);
+			n = node_set_r(n, make_node_t(p, node_type_list));
 		}
 	}
 
@@ -1771,17 +1838,17 @@ cm_parse_call(struct parser *p, struct node *l, bool assignment_allowed)
 	stack_push(&p->wk->stack, p->cm_mode, cm_parse_mode_command_args);
 
 	n = make_node_t(p, node_type_call);
-	n->r = l;
-	n->l = p->behavior.parse_list(p, node_type_args, ')', true);
+	n->r = l->id;
+	node_set_l(n, p->behavior.parse_list(p, node_type_args, ')', true));
 
-	/* n->r->data.str = make_strf(p->wk, "cm_%s", get_cstr(p->wk, n->r->data.str)); */
+	/* l->data.str = make_strf(p->wk, "cm_%s", get_cstr(p->wk, l->data.str)); */
 
 	stack_pop(&p->wk->stack, p->cm_mode);
 
 	n->location = source_location_merge(l->location, p->previous.location);
 
-	if (n->r->type == node_type_id) {
-		n->r->type = node_type_id_lit;
+	if (l->type == node_type_id) {
+		l->type = node_type_id_lit;
 	}
 	return n;
 }
@@ -1791,9 +1858,8 @@ cm_parse_comp_subtype_unary(struct parser *p, bool assignment_allowed)
 {
 	if (p->previous.data.type == cm_token_subtype_comp_exists) {
 		struct node *n = make_node_t(p, node_type_call);
-		n->l = make_node_t(p, node_type_id);
-		n->l->data.str = make_str(p->wk, "fs.exists");
-		n->r = p->behavior.parse_list(p, node_type_args, ')', false);
+		node_set_l(n, make_node_t(p, node_type_id))->data.str = make_str(p->wk, "fs.exists");
+		node_set_r(n, p->behavior.parse_list(p, node_type_args, ')', false));
 		return n;
 	}
 
@@ -1836,8 +1902,8 @@ cm_parse_binary(struct parser *p, struct node *l, bool assignment_allowed)
 
 	struct node *n;
 	n = parse_binary(p, l, assignment_allowed);
-	n->l = parse_emit_coerce(p, n->l, coerce_type);
-	n->r = parse_emit_coerce(p, n->r, coerce_type);
+	node_set_l(n, parse_emit_coerce(p, node_l(p->wk, n), coerce_type));
+	node_set_r(n, parse_emit_coerce(p, node_r(p->wk, n), coerce_type));
 	return n;
 }
 
@@ -1850,7 +1916,7 @@ cm_parse_unary(struct parser *p, bool assignment_allowed)
 	default: UNREACHABLE;
 	}
 
-	n->l = parse_emit_coerce(p, parse_prec(p, parse_precedence_unary, false), obj_bool);
+	node_set_l(n, parse_emit_coerce(p, parse_prec(p, parse_precedence_unary, false), obj_bool));
 	return n;
 }
 
@@ -0,0 +1,343 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "functions/modules.h"
+#include "lang/func_lookup.h"
+#include "lang/profile.h"
+#include "lang/workspace.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/path.h"
+
+struct vm_profile_key {
+	uint32_t parent, type, id, call_ip;
+};
+
+void
+vm_profile_init(struct workspace *wk, const char *path)
+{
+	struct vm_profile *p = ar_make(wk->a, struct vm_profile);
+	arena_init(&p->a, );
+	arr_init(&p->a, &p->nodes, 1024, struct vm_profile_node);
+	hash_init(&p->a, &p->children, 1024, struct vm_profile_key);
+	p->path = path;
+
+	arr_push(&p->a, &p->nodes, &(struct vm_profile_node){ .type = vm_profile_frame_type_root, .name = "muon" });
+
+	timer_start(&p->timer);
+	p->last_bytes = wk->a->pos;
+
+	wk->vm.profile = p;
+}
+
+static struct vm_profile_node *
+vm_profile_cur(struct vm_profile *p)
+{
+	return arr_get(&p->nodes, p->cur);
+}
+
+/* Charge everything since the last frame transition to the current frame. */
+static void
+vm_profile_account(struct workspace *wk, struct vm_profile *p)
+{
+	struct vm_profile_node *n = vm_profile_cur(p);
+	uint64_t now = timer_read_ns(&p->timer);
+	n->self_ns += now - p->last_ns;
+	n->bytes += wk->a->pos - p->last_bytes;
+	p->last_ns = now;
+	p->last_bytes = wk->a->pos;
+}
+
+static void
+vm_profile_push(struct workspace *wk,
+	enum vm_profile_frame_type type,
+	uint32_t id,
+	const char *name,
+	const char *prefix)
+{
+	struct vm_profile *p = wk->vm.profile;
+	vm_profile_account(wk, p);
+
+	struct vm_profile_key key = { .parent = p->cur, .type = type, .id = id, .call_ip = wk->vm.ip };
+	uint64_t *v;
+	if ((v = hash_get(&p->children, &key))) {
+		p->cur = *v;
+	} else {
+		p->cur = arr_push(&p->a,
+			&p->nodes,
+			&(struct vm_profile_node){
+				.parent = key.parent,
+				.type = type,
+				.id = id,
+				.call_ip = key.call_ip,
+				.name = name,
+				.prefix = prefix,
+			});
+		hash_set(&p->a, &p->children, &key, p->cur);
+	}
+
+	++vm_profile_cur(p)->calls;
+}
+
+void
+vm_profile_push_eval(struct workspace *wk, obj eval_name)
+{
+	vm_profile_push(wk, vm_profile_frame_type_eval, eval_name, 0, 0);
+}
+
+void
+vm_profile_push_func(struct workspace *wk, const struct obj_func *func)
+{
+	vm_profile_push(wk, vm_profile_frame_type_func, func->entry, func->name ? func->name : "anonymous function", 0);
+}
+
+void
+vm_profile_push_native(struct workspace *wk, uint32_t func_idx, obj self)
+{
+	const char *prefix = 0;
+	if (self) {
+		enum obj_type t = get_obj_type(wk, self);
+		prefix = t == obj_module ? module_info[get_obj_module(wk, self)->module].name : obj_type_to_s(t);
+	}
+
+	vm_profile_push(wk, vm_profile_frame_type_native, func_idx, native_funcs[func_idx].name, prefix);
+}
+
+void
+vm_profile_pop(struct workspace *wk)
+{
+	struct vm_profile *p = wk->vm.profile;
+	if (!p->cur) {
+		return;
+	}
+
+	vm_profile_account(wk, p);
+	p->cur = vm_profile_cur(p)->parent;
+}
+
+void
+vm_profile_obj(struct workspace *wk, enum obj_type t)
+{
+	struct vm_profile *p = wk->vm.profile;
+	++vm_profile_cur(p)->objects;
+	++p->objects_by_type[t];
+}
+
+/******************************************************************************
+ * output
+ ******************************************************************************/
+
+static void
+vm_profile_push_path(struct workspace *wk, struct tstr *buf, const char *path)
+{
+	if (path_is_absolute(path) && path_is_subpath(wk, wk->source_root, path)) {
+		TSTR(rel);
+		path_relative_to(wk, &rel, wk->source_root, path);
+		tstr_pushn(wk, buf, rel.buf, rel.len);
+	} else {
+		tstr_pushs(wk, buf, path);
+	}
+}
+
+static obj
+vm_profile_node_label(struct workspace *wk, const struct vm_profile_node *n)
+{
+	TSTR(buf);
+
+	switch (n->type) {
+	case vm_profile_frame_type_root: tstr_pushs(wk, &buf, n->name); break;
+	case vm_profile_frame_type_eval:
+		vm_profile_push_path(wk, &buf, n->id ? get_str(wk, n->id)->s : "eval");
+		break;
+	case vm_profile_frame_type_func:
+	case vm_profile_frame_type_native: {
+		if (n->prefix) {
+			tstr_pushf(wk, &buf, "%s.", n->prefix);
+		}
+		tstr_pushs(wk, &buf, n->name);
+
+		if (n->call_ip) {
+			struct vm_inst_location loc;
+			vm_inst_location(wk, n->call_ip - 1, &loc);
+			tstr_pushs(wk, &buf, " (");
+			vm_profile_push_path(wk, &buf, loc.file);
+			tstr_pushf(wk, &buf, ":%d)", loc.line);
+		}
+		break;
+	}
+	}
+
+	// ';' separates frames in the collapsed stack format
+	for (uint32_t i = 0; i < buf.len; ++i) {
+		if (buf.buf[i] == ';') {
+			buf.buf[i] = ',';
+		}
+	}
+
+	return tstr_into_str(wk, &buf);
+}
+
+struct vm_profile_summary {
+	obj label;
+	uint64_t self_ns, total_ns, calls, objects;
+	int64_t bytes;
+};
+
+static int32_t
+vm_profile_summary_compare(const void *_a, const void *_b, void *_ctx)
+{
+	const struct vm_profile_summary *a = _a, *b = _b;
+	return a->self_ns < b->self_ns ? 1 : a->self_ns > b->self_ns ? -1 : 0;
+}
+
+struct vm_profile_type_count {
+	enum obj_type t;
+	uint64_t n;
+};
+
+static int32_t
+vm_profile_type_count_compare(const void *_a, const void *_b, void *_ctx)
+{
+	const struct vm_profile_type_count *a = _a, *b = _b;
+	return a->n < b->n ? 1 : a->n > b->n ? -1 : 0;
+}
+
+bool
+vm_profile_write(struct workspace *wk)
+{
+	struct vm_profile *p = wk->vm.profile;
+	if (!p) {
+		return true;
+	}
+
+	vm_profile_account(wk, p);
+	// Stop profiling so that the objects made below aren't counted.
+	wk->vm.profile = 0;
+
+	const uint32_t max_rows = 25;
+	const uint32_t len = p->nodes.len;
+	obj *labels = ar_maken(&p->a, obj, len), *stacks = ar_maken(&p->a, obj, len);
+	uint64_t *total_ns = ar_maken(&p->a, uint64_t, len);
+
+	for (int32_t i = len - 1; i >= 0; --i) {
+		const struct vm_profile_node *n = arr_get(&p->nodes, i);
+		total_ns[i] += n->self_ns;
+		if (i) {
+			total_ns[n->parent] += total_ns[i];
+		}
+	}
+
+	struct hash stack_idx, label_idx;
+	struct arr folded, summaries;
+	hash_init_str(&p->a, &stack_idx, 1024);
+	hash_init_str(&p->a, &label_idx, 1024);
+	arr_init(&p->a, &folded, 1024, uint64_t);
+	arr_init(&p->a, &summaries, 1024, struct vm_profile_summary);
+
+	for (uint32_t i = 0; i < len; ++i) {
+		const struct vm_profile_node *n = arr_get(&p->nodes, i);
+		labels[i] = vm_profile_node_label(wk, n);
+
+		// Nodes are always created after their parent, so the parent's
+		// stack is already known.
+		if (i) {
+			TSTR(stack);
+			const struct str *parent = get_str(wk, stacks[n->parent]), *label = get_str(wk, labels[i]);
+			tstr_pushn(wk, &stack, parent->s, parent->len);
+			tstr_push(wk, &stack, ';');
+			tstr_pushn(wk, &stack, label->s, label->len);
+			stacks[i] = tstr_into_str(wk, &stack);
+		} else {
+			stacks[i] = labels[i];
+		}
+
+		const struct str *s = get_str(wk, stacks[i]);
+		uint64_t *v;
+		if ((v = hash_get_strn(&stack_idx, s->s, s->len))) {
+			*(uint64_t *)arr_get(&folded, *v) += n->self_ns;
+		} else {
+			hash_set_strn(&p->a, &stack_idx, s->s, s->len, arr_push(&p->a, &folded, &n->self_ns));
+		}
+
+		const struct str *l = get_str(wk, labels[i]);
+		struct vm_profile_summary *sum;
+		if ((v = hash_get_strn(&label_idx, l->s, l->len))) {
+			sum = arr_get(&summaries, *v);
+		} else {
+			uint32_t idx = arr_push(&p->a, &summaries, &(struct vm_profile_summary){ .label = labels[i] });
+			hash_set_strn(&p->a, &label_idx, l->s, l->len, idx);
+			sum = arr_get(&summaries, idx);
+		}
+
+		sum->self_ns += n->self_ns;
+		sum->total_ns += total_ns[i];
+		sum->calls += n->calls;
+		sum->objects += n->objects;
+		sum->bytes += n->bytes;
+	}
+
+	bool ok = true;
+	{ // collapsed stacks, in microseconds
+		TSTR(buf);
+		for (uint32_t i = 0; i < len; ++i) {
+			const struct str *s = get_str(wk, stacks[i]);
+			uint64_t *v = hash_get_strn(&stack_idx, s->s, s->len);
+			uint64_t *ns = arr_get(&folded, *v);
+			if (*ns < 1000) {
+				continue;
+			}
+
+			tstr_pushn(wk, &buf, s->s, s->len);
+			tstr_pushf(wk, &buf, " %" PRIu64 "\n", *ns / 1000);
+			*ns = 0;
+		}
+
+		if (!fs_write_entire_file(p->path, (uint8_t *)buf.buf, buf.len)) {
+			ok = false;
+		}
+	}
+
+	arr_sort(&summaries, 0, vm_profile_summary_compare);
+
+	log_plain(log_info, "profile written to %s\n", p->path);
+	log_plain(log_info, "%10s %10s %10s %10s %10s  %s\n", "self ms", "total ms", "calls", "objects", "arena KiB", "frame");
+	for (uint32_t i = 0; i < summaries.len && i < max_rows; ++i) {
+		const struct vm_profile_summary *sum = arr_get(&summaries, i);
+		log_plain(log_info,
+			"%10.2f %10.2f %10" PRIu64 " %10" PRIu64 " %10" PRId64 "  %s\n",
+			sum->self_ns / 1e6,
+			sum->total_ns / 1e6,
+			sum->calls,
+			sum->objects,
+			sum->bytes / 1024,
+			get_str(wk, sum->label)->s);
+	}
+
+	{
+		struct arr counts;
+		arr_init(&p->a, &counts, obj_type_count, struct vm_profile_type_count);
+		for (uint32_t t = 0; t < obj_type_count; ++t) {
+			if (p->objects_by_type[t]) {
+				arr_push(&p->a, &counts, &(struct vm_profile_type_count){ t, p->objects_by_type[t] });
+			}
+		}
+
+		arr_sort(&counts, 0, vm_profile_type_count_compare);
+
+		log_plain(log_info, "objects allocated by type:\n");
+		for (uint32_t i = 0; i < counts.len; ++i) {
+			const struct vm_profile_type_count *c = arr_get(&counts, i);
+			log_plain(log_info, "%10" PRIu64 "  %s\n", c->n, obj_type_to_s(c->t));
+		}
+	}
+
+	ar_destroy(&p->a);
+	return ok;
+}
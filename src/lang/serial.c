@@ -17,7 +17,7 @@
 
 #define SERIAL_MAGIC_LEN 9
 static const char serial_magic[SERIAL_MAGIC_LEN + 1] = "muondump";
-static const uint32_t serial_version = 10;
+static const uint32_t serial_version = 11;
 
 static bool
 corrupted_dump(void)
@@ -118,6 +118,61 @@ done:
 	return true;
 }
 
+static bool
+dump_array_chunks(const struct arr *chunks, FILE *f)
+{
+	uint32_t i;
+
+	if (!dump_uint32(chunks->len, f)) {
+		return false;
+	}
+
+	for (i = 0; i < chunks->len; ++i) {
+		const struct obj_array_chunk *chunk = arr_get(chunks, i);
+
+		if (!dump_uint32(chunk->len, f)) {
+			return false;
+		}
+
+		if (!fs_fwrite(chunk->mem, sizeof(obj) * chunk->len, f)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+load_array_chunks(struct arena *a, struct arr *chunks, FILE *f)
+{
+	uint32_t i, chunks_len;
+
+	assert(chunks->len == 0);
+
+	if (!load_uint32(&chunks_len, f)) {
+		return false;
+	}
+
+	for (i = 0; i < chunks_len; ++i) {
+		struct obj_array_chunk chunk = { 0 };
+
+		if (!load_uint32(&chunk.len, f)) {
+			return corrupted_dump();
+		}
+
+		chunk.cap = chunk.len < obj_array_chunk_size ? obj_array_chunk_size : chunk.len;
+		chunk.mem = ar_alloc(a, chunk.cap, sizeof(obj), ar_alignof(obj));
+
+		if (!fs_fread(chunk.mem, sizeof(obj) * chunk.len, f)) {
+			return corrupted_dump();
+		}
+
+		arr_push(a, chunks, &chunk);
+	}
+
+	return true;
+}
+
 static bool
 dump_serial_header(FILE *f)
 {
@@ -419,7 +474,7 @@ serial_dump(struct workspace *wk, obj o, FILE *f)
 	if (!(dump_serial_header(f) && dump_uint32(obj_dest, f) && dump_bucket_arr(&wk_dest.vm.objects.chrs, f)
 		    && dump_big_strings(&wk_dest, &big_string_offsets, f) && dump_objs(&wk_dest, &big_string_offsets, f)
 		    && dump_bucket_arr(&wk_dest.vm.objects.dict_elems, f)
-		    && dump_bucket_arr(&wk_dest.vm.objects.array_elems, f))) {
+		    && dump_array_chunks(&wk_dest.vm.objects.array_chunks, f))) {
 		goto ret;
 	}
 
@@ -439,7 +494,6 @@ serial_load(struct workspace *wk, obj *res, FILE *f)
 	vm_init_objects(&wk_src);
 	// remove null elems
 	bucket_arr_clear(&wk_src.vm.objects.dict_elems);
-	bucket_arr_clear(&wk_src.vm.objects.array_elems);
 
 	struct big_string_table bst = { 0 };
 
@@ -447,7 +501,7 @@ serial_load(struct workspace *wk, obj *res, FILE *f)
 	if (!(load_serial_header(f) && load_uint32(&obj_src, f) && load_bucket_arr(wk_src.a, &wk_src.vm.objects.chrs, f)
 		    && load_big_strings(&wk_src, &bst, f) && load_objs(&wk_src, &bst, f)
 		    && load_bucket_arr(wk_src.a, &wk_src.vm.objects.dict_elems, f)
-		    && load_bucket_arr(wk_src.a, &wk_src.vm.objects.array_elems, f))) {
+		    && load_array_chunks(wk_src.a, &wk_src.vm.objects.array_chunks, f))) {
 		goto ret;
 	}
 
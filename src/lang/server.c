@@ -20,6 +20,7 @@
 
 struct stdio_server {
 	int in, out;
+	bool in_is_file;
 };
 
 static enum srv_read_result
@@ -180,6 +181,32 @@ srv_read(struct server *srv, struct workspace *wk, obj *msg)
 	return srv_read_result_ok;
 }
 
+/*
+ * Returns true if another message can be read without blocking.  This is only
+ * a hint.  Input replayed from a file is never reported as pending so that
+ * every message in it is handled as if it had arrived on its own.
+ */
+bool
+srv_input_pending(struct server *srv)
+{
+	const struct tstr *buf = &srv->in_buf;
+
+	if (srv->io_type == server_io_type_stdio && ((struct stdio_server *)srv->io)->in_is_file) {
+		return false;
+	}
+
+	if (buf->len && memmem(buf->buf, buf->len, "\r\n\r\n", 4)) {
+		return true;
+	}
+
+	switch (srv->io_type) {
+	case server_io_type_stdio: return fs_has_input(((struct stdio_server *)srv->io)->in);
+	case server_io_type_pipe: return false;
+	}
+
+	return false;
+}
+
 void
 srv_write(struct server *srv, struct workspace *wk, obj msg)
 {
@@ -218,6 +245,7 @@ srv_init_stdio(struct workspace *wk, struct server *srv)
 		.in = 0, // STDIN_FILENO
 		.out = 1, // STDOUT_FILENO
 	};
+	io->in_is_file = fs_fd_is_regular_file(io->in);
 
 	tstr_init(&srv->in_buf, 0);
 }
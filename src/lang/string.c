@@ -19,6 +19,7 @@
 #include "log.h"
 #include "memmem.h"
 #include "platform/assert.h"
+#include "platform/mem.h"
 
 void
 str_escape(struct workspace *wk, struct tstr *sb, const struct str *ss, bool escape_printable)
@@ -141,19 +142,19 @@ get_cstr(struct workspace *wk, obj s)
 	return ss->s;
 }
 
-struct str *
-reserve_str(struct workspace *wk, obj *s, uint32_t len)
+static struct str *
+reserve_str_cap(struct workspace *wk, obj *s, uint32_t len, uint32_t cap)
 {
 	enum str_flags f = 0;
 	const char *p;
 
-	uint32_t new_len = len + 1;
+	assert(cap > len);
 
-	if (new_len > wk->vm.objects.chrs.bucket_size) {
+	if (cap > wk->vm.objects.chrs.bucket_size) {
 		f |= str_flag_big;
-		p = ar_alloc(wk->a, 1, new_len, 1);
+		p = ar_alloc(wk->a, 1, cap, 1);
 	} else {
-		p = bucket_arr_pushn(wk->a, &wk->vm.objects.chrs, NULL, 0, new_len);
+		p = bucket_arr_pushn(wk->a, &wk->vm.objects.chrs, NULL, 0, cap);
 	}
 
 	*s = make_obj(wk, obj_string);
@@ -169,6 +170,12 @@ reserve_str(struct workspace *wk, obj *s, uint32_t len)
 	return str;
 }
 
+struct str *
+reserve_str(struct workspace *wk, obj *s, uint32_t len)
+{
+	return reserve_str_cap(wk, s, len, len + 1);
+}
+
 static struct str *
 grow_str(struct workspace *wk, obj *s, uint32_t grow_by, bool alloc_nul)
 {
@@ -186,6 +193,8 @@ grow_str(struct workspace *wk, obj *s, uint32_t grow_by, bool alloc_nul)
 		return newstr;
 	}
 
+	obj_young_barrier(wk, *s);
+
 	if (alloc_nul) {
 		new_len += 1;
 	}
@@ -227,7 +236,8 @@ _make_str(struct workspace *wk, const char *p, uint32_t len, enum str_flags flag
 	memcpy((void *)str->s, p, len);
 	str->flags |= flags;
 
-	if (hash && !wk->vm.objects.obj_clear_mark_set && len <= SMALL_STR_LEN) {
+	// Strings that may be cleared can't be interned.
+	if (hash && !wk->vm.objects.obj_clear_mark_set && !wk->vm.objects.young.set && len <= SMALL_STR_LEN) {
 		hash_set_strn(wk->a, &wk->vm.objects.str_hash, str->s, str->len, s);
 	}
 	return s;
@@ -617,6 +627,91 @@ str_join(struct workspace *wk, obj s1, obj s2)
 	return res;
 }
 
+/*
+ * String builders
+ *
+ * `s += 'x'` on a string would copy s every time, so a loop appending to a
+ * string is quadratic.  Instead, the vm appends with str_builder_append,
+ * which makes a string with spare capacity the first time and remembers it
+ * as a builder.  Later appends to a builder fill in its spare capacity in
+ * place.  This is only valid while the builder is referenced by nothing but
+ * the variable it is assigned to, so the vm calls str_builder_release
+ * whenever a variable is read, after which the string is an ordinary one
+ * again and the next append copies it.
+ *
+ * Builders are tracked by object id, so they are all forgotten when objects
+ * are cleared.
+ */
+
+obj
+str_builder_append(struct workspace *wk, obj s, obj val)
+{
+	struct str_builders *b = &wk->vm.objects.str_builders;
+	const struct str *ss = get_str(wk, s), *sv = get_str(wk, val);
+	const uint32_t len = ss->len + sv->len;
+
+	for (uint32_t i = 0; i < ARRAY_LEN(b->e); ++i) {
+		if (b->e[i].s != s) {
+			continue;
+		}
+
+		if (len < b->e[i].cap) {
+			struct str *dst = (struct str *)ss;
+			memcpy((char *)&dst->s[dst->len], sv->s, sv->len);
+			((char *)dst->s)[len] = 0;
+			dst->len = len;
+			return s;
+		}
+
+		b->e[i].s = 0;
+		--b->len;
+		break;
+	}
+
+	uint32_t cap = 32;
+	while (cap <= len) {
+		cap *= 2;
+	}
+
+	obj res;
+	struct str *dst = reserve_str_cap(wk, &res, len, cap);
+	memcpy((char *)dst->s, ss->s, ss->len);
+	memcpy((char *)&dst->s[ss->len], sv->s, sv->len);
+
+	// Take a free entry if there is one, otherwise forget the oldest builder.
+	uint32_t i = b->next;
+	for (uint32_t j = 0; j < ARRAY_LEN(b->e); ++j) {
+		if (!b->e[j].s) {
+			i = j;
+			break;
+		}
+	}
+
+	if (b->e[i].s) {
+		b->next = (i + 1) % ARRAY_LEN(b->e);
+	} else {
+		++b->len;
+	}
+
+	b->e[i].s = res;
+	b->e[i].cap = cap;
+	return res;
+}
+
+void
+str_builder_release(struct workspace *wk, obj s)
+{
+	struct str_builders *b = &wk->vm.objects.str_builders;
+
+	for (uint32_t i = 0; i < ARRAY_LEN(b->e); ++i) {
+		if (b->e[i].s == s) {
+			b->e[i].s = 0;
+			--b->len;
+			return;
+		}
+	}
+}
+
 bool
 is_whitespace(char c)
 {
@@ -922,10 +1017,24 @@ tstr_grow(struct workspace *wk, struct tstr *sb, uint32_t inc)
 		newcap *= 2;
 	}
 
-	sb->buf = ar_realloc(wk->a_scratch, sb->buf, sb->cap, newcap, 1);
+	if (sb->flags & tstr_flag_heap) {
+		sb->buf = sb->cap ? z_realloc(sb->buf, newcap) : z_malloc(newcap);
+	} else {
+		sb->buf = ar_realloc(wk->a_scratch, sb->buf, sb->cap, newcap, 1);
+	}
 	sb->cap = newcap;
 }
 
+void
+tstr_free(struct tstr *sb)
+{
+	if ((sb->flags & tstr_flag_heap) && sb->cap) {
+		z_free(sb->buf);
+	}
+
+	tstr_init(sb, sb->flags);
+}
+
 void
 tstr_push(struct workspace *wk, struct tstr *sb, char s)
 {
@@ -1004,11 +1113,16 @@ tstr_vpushf(struct workspace *wk, struct tstr *sb, const char *fmt, va_list args
 	va_list args_copy;
 	va_copy(args_copy, args);
 
-	len = vsnprintf(NULL, 0, fmt, args_copy) + 1;
+	// Format directly into any remaining space, and only grow and format
+	// again if it didn't fit.
+	uint32_t avail = sb->cap > sb->len ? sb->cap - sb->len : 0;
+	len = vsnprintf(avail ? &sb->buf[sb->len] : NULL, avail, fmt, args_copy) + 1;
 
-	tstr_grow(wk, sb, len);
+	if (len > avail) {
+		tstr_grow(wk, sb, len);
+		vsnprintf(&sb->buf[sb->len], len, fmt, args);
+	}
 
-	vsnprintf(&sb->buf[sb->len], len, fmt, args);
 	sb->len += len - 1;
 
 	va_end(args_copy);
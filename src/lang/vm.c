@@ -19,6 +19,7 @@
 #include "lang/func_lookup.h"
 #include "lang/object_iterators.h"
 #include "lang/parser.h"
+#include "lang/profile.h"
 #include "lang/typecheck.h"
 #include "lang/vm.h"
 #include "lang/workspace.h"
@@ -43,8 +44,11 @@ const uint32_t op_operands[op_count] = {
 	[op_constant_dict] = 1,
 	[op_constant_func] = 1,
 	[op_call] = 2,
-	[op_member] = 1,
-	[op_call_native] = 3,
+	[op_member] = 2,
+	[op_call_native] = 4,
+	[op_load_g] = 1,
+	[op_store_g] = 1,
+	[op_add_store_g] = 1,
 	[op_jmp_if_true] = 1,
 	[op_jmp_if_false] = 1,
 	[op_jmp_if_disabler] = 1,
@@ -484,17 +488,32 @@ typecheck_and_mutate_function_arg(struct workspace *wk, uint32_t ip, obj *val, t
 }
 
 static bool
-handle_kwarg(struct workspace *wk, struct args_kw akw[], const char *kw, uint32_t kw_ip, obj v, uint32_t v_ip)
+handle_kwarg(struct workspace *wk,
+	struct args_kw akw[],
+	uint32_t akw_len,
+	struct vm_kwarg_slot *slot,
+	const char *kw,
+	uint32_t kw_ip,
+	obj v,
+	uint32_t v_ip)
 {
 	uint32_t i;
 	bool glob = false;
 
-	for (i = 0; akw[i].key; ++i) {
-		if (akw[i].type & TYPE_TAG_GLOB) {
-			glob = true;
-			break;
-		} else if (strcmp(kw, akw[i].key) == 0) {
-			break;
+	if (slot && slot->key && slot->i < akw_len && akw[slot->i].key == slot->key) {
+		i = slot->i;
+	} else {
+		for (i = 0; akw[i].key; ++i) {
+			if (akw[i].type & TYPE_TAG_GLOB) {
+				glob = true;
+				break;
+			} else if (strcmp(kw, akw[i].key) == 0) {
+				break;
+			}
+		}
+
+		if (slot && akw[i].key && !glob) {
+			*slot = (struct vm_kwarg_slot){ .key = akw[i].key, .i = i };
 		}
 	}
 
@@ -527,10 +546,17 @@ vm_pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[])
 {
 	const char *kw;
 	struct obj_stack_entry *entry;
-	uint32_t i, j, argi;
+	struct vm_kwarg_slot *slot;
+	uint32_t i, j, argi, akw_len = 0;
 	uint32_t args_popped = 0;
 	bool got_kwargs_typeinfo = false;
 
+	// Keyword arguments of a native call site remember which args_kw entry
+	// they matched the last time, so the name lookup is normally skipped.
+	// Only the first pop_args of a native call uses them.
+	const uint32_t kwarg_slots = wk->vm.call_kwarg_slots;
+	wk->vm.call_kwarg_slots = 0;
+
 	if (akw) {
 		for (i = 0; akw[i].key; ++i) {
 			akw[i].set = false;
@@ -541,6 +567,7 @@ vm_pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[])
 				akw[i].set = true;
 			}
 		}
+		akw_len = i;
 	} else if (wk->vm.nkwargs) {
 		vm_error(wk, "this function does not accept kwargs");
 		goto err;
@@ -550,7 +577,9 @@ vm_pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[])
 		entry = object_stack_pop_entry(&wk->vm.stack);
 		++args_popped;
 		kw = get_str(wk, entry->o)->s;
-		if (strcmp(kw, "kwargs") == 0) {
+		slot = kwarg_slots ? arr_get(&wk->vm.kwarg_slots, kwarg_slots - 1 + i) : 0;
+		// A kwarg that has been matched by name before can't be kwargs.
+		if (!(slot && slot->key) && strcmp(kw, "kwargs") == 0) {
 			entry = object_stack_pop_entry(&wk->vm.stack);
 			++args_popped;
 			if (entry->o == obj_disabler) {
@@ -571,7 +600,7 @@ vm_pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[])
 
 			obj k, v;
 			obj_dict_for(wk, entry->o, k, v) {
-				if (!handle_kwarg(wk, akw, get_cstr(wk, k), entry->ip, v, entry->ip)) {
+				if (!handle_kwarg(wk, akw, akw_len, 0, get_cstr(wk, k), entry->ip, v, entry->ip)) {
 					goto err;
 				}
 				wk->vm.saw_disabler |= v == obj_disabler;
@@ -580,7 +609,7 @@ vm_pop_args(struct workspace *wk, struct args_norm an[], struct args_kw akw[])
 			uint32_t kw_ip = entry->ip;
 			entry = object_stack_pop_entry(&wk->vm.stack);
 			++args_popped;
-			if (!handle_kwarg(wk, akw, kw, kw_ip, entry->o, entry->ip)) {
+			if (!handle_kwarg(wk, akw, akw_len, slot, kw, kw_ip, entry->o, entry->ip)) {
 				goto err;
 			}
 			wk->vm.saw_disabler |= entry->o == obj_disabler;
@@ -719,6 +748,34 @@ vm_get_constant(uint8_t *code, uint32_t *ip)
 	return r;
 }
 
+static void
+vm_set_constant_ip(uint8_t *code, uint32_t ip, uint32_t v)
+{
+	v = vm_constant_host_to_bc(v);
+	code[ip + 0] = (v >> 16) & 0xff;
+	code[ip + 1] = (v >> 8) & 0xff;
+	code[ip + 2] = v & 0xff;
+}
+
+/*
+ * The second operand of op_member is an inline cache of the last successful
+ * lookup of a native method at that call site.  It packs the type of self,
+ * the language mode, and the index into native_funcs.  A valid bit is set so
+ * that 0 can mean empty.
+ */
+static uint32_t
+vm_member_cache_key(enum obj_type t, enum language_mode mode, uint32_t idx)
+{
+	assert(t < (1 << 6) && mode < (1 << 3) && idx < (1 << 10));
+	return (1 << 23) | ((uint32_t)t << 13) | ((uint32_t)mode << 10) | idx;
+}
+
+static uint32_t
+vm_member_cache_idx(uint32_t cache)
+{
+	return cache & 0x3ff;
+}
+
 static void
 vm_push_call_stack_frame(struct workspace *wk, struct call_frame *frame, obj eval_name)
 {
@@ -739,6 +796,14 @@ vm_push_call_stack_frame(struct workspace *wk, struct call_frame *frame, obj eva
 	frame->stack_base = wk->vm.stack.ba.len;
 	arr_push(wk->a, &wk->vm.call_stack, frame);
 	workspace_push_lang_mode(wk, frame->lang_mode);
+
+	if (wk->vm.profile) {
+		if (frame->closure->func->automatically_defined) {
+			vm_profile_push_eval(wk, frame->eval_name);
+		} else {
+			vm_profile_push_func(wk, frame->closure->func);
+		}
+	}
 }
 
 static struct call_frame *
@@ -746,6 +811,10 @@ vm_pop_call_stack_frame(struct workspace *wk)
 {
 	struct call_frame *frame = arr_pop(&wk->vm.call_stack);
 	workspace_pop_lang_mode(wk);
+
+	if (wk->vm.profile) {
+		vm_profile_pop(wk);
+	}
 	return frame;
 }
 
@@ -829,7 +898,7 @@ vm_dis_inst(struct workspace *wk, uint8_t *code, uint32_t base_ip, int64_t offse
 	uint32_t ip = base_ip;
 	buf_push("%04" PRIx64 " ", ip + offset);
 
-	uint32_t op = code[ip], constants[3] = { 0 };
+	uint32_t op = code[ip], constants[4] = { 0 };
 	{
 		++ip;
 		uint32_t j;
@@ -859,9 +928,9 @@ vm_dis_inst(struct workspace *wk, uint8_t *code, uint32_t base_ip, int64_t offse
 	case op_return: break;
 	case op_return_end: break;
 	case op_try_load_g: break;
-	case op_load_g: break;
-	case op_store_g: break;
-	case op_add_store_g: break;
+	case op_load_g:
+	case op_store_g:
+	case op_add_store_g: buf_push(":%d", constants[0]); break;
 	case op_store_m: break;
 	case op_add_store_m: break;
 
@@ -901,6 +970,9 @@ vm_dis_inst(struct workspace *wk, uint8_t *code, uint32_t base_ip, int64_t offse
 		uint32_t a;
 		a = constants[0];
 		buf_push(":%o", a);
+		if (constants[1]) {
+			buf_push(",%s", native_funcs[vm_member_cache_idx(constants[1])].name);
+		}
 		break;
 	}
 	case op_call_native:
@@ -1389,6 +1461,9 @@ vm_begin_execute_closure(struct workspace *wk, obj a)
 
 	closure = get_obj_closure(wk, a);
 
+	// The function may run in another scope or capture upvalues.
+	wk->vm.objects.young.dirty = true;
+
 	stack_push(&wk->stack, wk->vm.saw_disabler, false);
 	bool ok = pop_args(wk, closure->func->an, closure->func->akw);
 	bool saw_disabler = wk->vm.saw_disabler;
@@ -1438,11 +1513,35 @@ vm_begin_execute_closure(struct workspace *wk, obj a)
 	return true;
 }
 
+/* Methods on plain values only make new objects, so they can be called
+ * between young collections.  Anything else may hold on to what it makes
+ * somewhere a collection can't see. */
+static bool
+vm_young_native_is_value_method(struct workspace *wk, uint32_t func_idx, obj self)
+{
+	if (!self || (native_funcs[func_idx].flags & func_impl_flag_impure)) {
+		return false;
+	}
+
+	switch (get_obj_type(wk, self)) {
+	case obj_string:
+	case obj_number:
+	case obj_bool:
+	case obj_array:
+	case obj_dict: return true;
+	default: return false;
+	}
+}
+
 static void
-vm_execute_native(struct workspace *wk, uint32_t func_idx, obj self)
+vm_execute_native(struct workspace *wk, uint32_t func_idx, obj self, uint32_t kwarg_slots)
 {
 	obj res = 0;
 
+	if (!vm_young_native_is_value_method(wk, func_idx, self)) {
+		wk->vm.objects.young.dirty = true;
+	}
+
 	stack_push(&wk->stack, wk->vm.saw_disabler, false);
 
 	bool ok;
@@ -1454,7 +1553,17 @@ vm_execute_native(struct workspace *wk, uint32_t func_idx, obj self)
 		TracyCZoneName(tctx_func, func_name, strlen(func_name));
 #endif
 
+		if (wk->vm.profile) {
+			vm_profile_push_native(wk, func_idx, self);
+		}
+
+		wk->vm.call_kwarg_slots = kwarg_slots;
 		ok = wk->vm.behavior.native_func_dispatch(wk, func_idx, self, &res);
+		wk->vm.call_kwarg_slots = 0;
+
+		if (wk->vm.profile) {
+			vm_profile_pop(wk);
+		}
 
 		TracyCZoneEnd(tctx_func);
 	}
@@ -1561,6 +1670,8 @@ vm_op_constant_func(struct workspace *wk)
 	defargs = object_stack_pop(&wk->vm.stack);
 	a = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
 
+	wk->vm.objects.young.dirty = true;
+
 	c = make_obj(wk, obj_closure);
 	closure = get_obj_closure(wk, c);
 
@@ -1688,8 +1799,7 @@ vm_op_add(struct workspace *wk)
 	case obj_number: {
 		typecheck_operand(b, b_t, obj_number, tc_number, tc_number);
 
-		res = make_obj(wk, obj_number);
-		set_obj_number(wk, res, get_obj_number(wk, a) + get_obj_number(wk, b));
+		res = make_number(wk, get_obj_number(wk, a) + get_obj_number(wk, b));
 		break;
 	}
 	case obj_string: {
@@ -1774,8 +1884,7 @@ vm_div_by_0_check(struct workspace *wk, int64_t val)
 			return;                                                                             \
 		}                                                                                           \
                                                                                                             \
-		res = make_obj(wk, obj_number);                                                             \
-		set_obj_number(wk, res, get_obj_number(wk, a) __op b_val);                                  \
+		res = make_number(wk, get_obj_number(wk, a) __op b_val);                                    \
 		break;                                                                                      \
 	}                                                                                                   \
 	case obj_typeinfo: {                                                                                \
@@ -1835,8 +1944,7 @@ vm_op_div(struct workspace *wk)
 			return;
 		}
 
-		res = make_obj(wk, obj_number);
-		set_obj_number(wk, res, get_obj_number(wk, a) / b_val);
+		res = make_number(wk, get_obj_number(wk, a) / b_val);
 		break;
 	}
 	case obj_string: {
@@ -2115,8 +2223,7 @@ vm_op_negate(struct workspace *wk)
 
 	switch (a_t) {
 	case obj_number: {
-		res = make_obj(wk, obj_number);
-		set_obj_number(wk, res, get_obj_number(wk, a) * -1);
+		res = make_number(wk, get_obj_number(wk, a) * -1);
 		break;
 	}
 	case obj_typeinfo: {
@@ -2172,8 +2279,7 @@ vm_op_coerce(struct workspace *wk)
 		switch (a_type) {
 		case obj_number: res = a; break;
 		case obj_bool:
-			res = make_obj(wk, obj_number);
-			set_obj_number(wk, res, get_obj_bool(wk, a) ? 1 : 0);
+			res = make_number(wk, get_obj_bool(wk, a) ? 1 : 0);
 			break;
 		case obj_string: {
 			int64_t n;
@@ -2185,8 +2291,7 @@ vm_op_coerce(struct workspace *wk)
 					obj_type_to_s(coerce_type));
 				goto push_dummy;
 			}
-			res = make_obj(wk, obj_number);
-			set_obj_number(wk, res, n);
+			res = make_number(wk, n);
 			break;
 		}
 		default: goto type_error;
@@ -2245,6 +2350,16 @@ push_dummy:
 }
 
 // When you assign a value to a variable, these mutations are performed.
+/* Called whenever a variable is read, since its value may be referenced from
+ * somewhere else afterwards. */
+static void
+vm_str_builder_release(struct workspace *wk, obj o)
+{
+	if (wk->vm.objects.str_builders.len) {
+		str_builder_release(wk, o);
+	}
+}
+
 static obj
 vm_perform_store_mutations(struct workspace *wk, obj val)
 {
@@ -2277,8 +2392,10 @@ vm_perform_store_mutations(struct workspace *wk, obj val)
 	return res;
 }
 
+/* str_builder may only be set when source was read directly out of a
+ * variable, see str_builder_append. */
 static obj
-vm_perform_add_store_mutations(struct workspace *wk, obj val, obj source)
+vm_perform_add_store_mutations(struct workspace *wk, obj val, obj source, bool str_builder)
 {
 	obj res = source;
 	enum obj_type source_t = get_obj_type(wk, source), val_t = get_obj_type(wk, val);
@@ -2287,15 +2404,17 @@ vm_perform_add_store_mutations(struct workspace *wk, obj val, obj source)
 	case obj_number: {
 		typecheck_operand(val, val_t, obj_number, tc_number, tc_number);
 
-		res = make_obj(wk, obj_number);
-		set_obj_number(wk, res, get_obj_number(wk, source) + get_obj_number(wk, val));
+		res = make_number(wk, get_obj_number(wk, source) + get_obj_number(wk, val));
 		break;
 	}
 	case obj_string: {
 		typecheck_operand(val, val_t, obj_string, tc_string, tc_string);
 
-		// TODO: could use str_appn, but would have to dup on store
-		res = str_join(wk, source, val);
+		if (str_builder && !wk->vm.in_analyzer) {
+			res = str_builder_append(wk, source, val);
+		} else {
+			res = str_join(wk, source, val);
+		}
 		break;
 	}
 	case obj_array: {
@@ -2333,10 +2452,63 @@ type_err:
 	return res;
 }
 
+static bool vm_get_global(struct workspace *wk, const char *name, obj *res);
+static void vm_assign_global(struct workspace *wk, const char *name, obj o, uint32_t ip);
+
+/*
+ * Returns a pointer to the value of the global in slot, or 0 if the slot
+ * can't be trusted.  Slots are only used with the default global behavior
+ * functions, the analyzer keeps its own scopes.
+ */
+static obj *
+vm_global_slot_get(struct workspace *wk, uint32_t slot, bool for_write)
+{
+	if (!slot || wk->vm.behavior.get_global != vm_get_global || wk->vm.behavior.assign_global != vm_assign_global) {
+		return 0;
+	}
+
+	const struct vm_global_slot *s = arr_get(&wk->vm.global_slots, slot - 1);
+	if (s->scope != wk->vm.global_scope || s->generation != wk->vm.global_slots_generation) {
+		return 0;
+	}
+
+	const struct obj_dict *d = get_obj_dict(wk, s->scope);
+	if (d->data != s->data || d->flags != s->flags) {
+		return 0;
+	} else if (for_write && (d->flags & obj_dict_flag_cow)) {
+		return 0;
+	}
+
+	return s->val;
+}
+
+static void
+vm_global_slot_fill(struct workspace *wk, uint32_t slot, const struct str *name)
+{
+	if (!slot || wk->vm.behavior.get_global != vm_get_global || wk->vm.behavior.assign_global != vm_assign_global) {
+		return;
+	}
+
+	obj *val = obj_dict_index_strn_pointer(wk, wk->vm.global_scope, name->s, name->len);
+	if (!val) {
+		return;
+	}
+
+	const struct obj_dict *d = get_obj_dict(wk, wk->vm.global_scope);
+	*(struct vm_global_slot *)arr_get(&wk->vm.global_slots, slot - 1) = (struct vm_global_slot){
+		.scope = wk->vm.global_scope,
+		.data = d->data,
+		.flags = d->flags,
+		.generation = wk->vm.global_slots_generation,
+		.val = val,
+	};
+}
+
 static void
 vm_op_store_g(struct workspace *wk)
 {
 	/* operand order: <destination_id> <value> */
+	uint32_t slot = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
 	struct obj_stack_entry *id = object_stack_pop_entry(&wk->vm.stack);
 	obj val = object_stack_pop(&wk->vm.stack);
 
@@ -2347,7 +2519,14 @@ vm_op_store_g(struct workspace *wk)
 
 	obj res = vm_perform_store_mutations(wk, val);
 
-	wk->vm.behavior.assign_global(wk, get_str(wk, id->o)->s, res, id->ip);
+	obj *dest;
+	if ((dest = vm_global_slot_get(wk, slot, true))) {
+		*dest = res;
+	} else {
+		const struct str *id_str = get_str(wk, id->o);
+		wk->vm.behavior.assign_global(wk, id_str->s, res, id->ip);
+		vm_global_slot_fill(wk, slot, id_str);
+	}
 
 	object_stack_push(wk, res);
 }
@@ -2356,6 +2535,7 @@ static void
 vm_op_add_store_g(struct workspace *wk)
 {
 	/* operand order: <destination_id> <value> */
+	uint32_t slot = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
 	obj id = object_stack_pop(&wk->vm.stack);
 	obj val = object_stack_pop(&wk->vm.stack);
 
@@ -2364,6 +2544,13 @@ vm_op_add_store_g(struct workspace *wk)
 		return;
 	}
 
+	obj *dest;
+	if ((dest = vm_global_slot_get(wk, slot, true))) {
+		*dest = vm_perform_add_store_mutations(wk, val, *dest, true);
+		object_stack_push(wk, *dest);
+		return;
+	}
+
 	obj source;
 	const struct str *id_str = get_str(wk, id);
 	if (!wk->vm.behavior.get_global(wk, id_str->s, &source)) {
@@ -2372,9 +2559,10 @@ vm_op_add_store_g(struct workspace *wk)
 		return;
 	}
 
-	obj res = vm_perform_add_store_mutations(wk, val, source);
+	obj res = vm_perform_add_store_mutations(wk, val, source, true);
 
 	wk->vm.behavior.assign_global(wk, id_str->s, res, wk->vm.ip - 1);
+	vm_global_slot_fill(wk, slot, id_str);
 
 	object_stack_push(wk, res);
 }
@@ -2382,6 +2570,7 @@ vm_op_add_store_g(struct workspace *wk)
 static void
 vm_op_load_g(struct workspace *wk)
 {
+	uint32_t slot = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
 	obj a = object_stack_pop(&wk->vm.stack);
 
 	// a could be a disabler if this is an inlined get_variable call
@@ -2393,6 +2582,13 @@ vm_op_load_g(struct workspace *wk)
 		return;
 	}
 
+	obj *src;
+	if ((src = vm_global_slot_get(wk, slot, false))) {
+		vm_str_builder_release(wk, *src);
+		object_stack_push(wk, *src);
+		return;
+	}
+
 	obj b;
 	if (!wk->vm.behavior.get_global(wk, get_str(wk, a)->s, &b)) {
 		vm_error(wk, "undefined global %s", get_cstr(wk, a));
@@ -2400,6 +2596,9 @@ vm_op_load_g(struct workspace *wk)
 		return;
 	}
 
+	vm_global_slot_fill(wk, slot, get_str(wk, a));
+
+	vm_str_builder_release(wk, b);
 	object_stack_push(wk, b);
 }
 
@@ -2504,7 +2703,7 @@ vm_op_add_store_m(struct workspace *wk)
 		return;
 	}
 
-	*member_target = vm_perform_add_store_mutations(wk, val, *member_target);
+	*member_target = vm_perform_add_store_mutations(wk, val, *member_target, false);
 
 	object_stack_push(wk, *member_target);
 }
@@ -2529,6 +2728,7 @@ vm_op_load_l(struct workspace *wk)
 	vm_op_store_load_l_common();
 	vm_op_store_uninit_check(slot->o);
 
+	vm_str_builder_release(wk, slot->o);
 	object_stack_push(wk, slot->o);
 }
 
@@ -2549,7 +2749,7 @@ vm_op_add_store_l(struct workspace *wk)
 	vm_op_store_uninit_check(slot->o);
 
 	const struct obj_stack_entry *src = object_stack_pop_entry(&wk->vm.stack);
-	slot->o = vm_perform_add_store_mutations(wk, src->o, slot->o);
+	slot->o = vm_perform_add_store_mutations(wk, src->o, slot->o, true);
 	slot->ip = src->ip;
 	object_stack_push(wk, slot->o);
 }
@@ -2564,6 +2764,7 @@ vm_op_load_u(struct workspace *wk)
 {
 	vm_op_store_load_u_common();
 	vm_op_store_uninit_check(*slot);
+	vm_str_builder_release(wk, *slot);
 	object_stack_push(wk, *slot);
 }
 
@@ -2571,6 +2772,7 @@ static void
 vm_op_store_u(struct workspace *wk)
 {
 	vm_op_store_load_u_common();
+	wk->vm.objects.young.dirty = true;
 	obj val = object_stack_peek(&wk->vm.stack, 1);
 	*slot = vm_perform_store_mutations(wk, val);
 }
@@ -2580,8 +2782,9 @@ vm_op_add_store_u(struct workspace *wk)
 {
 	vm_op_store_load_u_common();
 	vm_op_store_uninit_check(*slot);
+	wk->vm.objects.young.dirty = true;
 	obj val = object_stack_pop(&wk->vm.stack);
-	*slot = vm_perform_add_store_mutations(wk, val, *slot);
+	*slot = vm_perform_add_store_mutations(wk, val, *slot, true);
 	object_stack_push(wk, *slot);
 }
 
@@ -2604,6 +2807,7 @@ vm_op_try_load(struct workspace *wk)
 		res = b;
 	}
 
+	vm_str_builder_release(wk, res);
 	object_stack_push(wk, res);
 }
 
@@ -2692,8 +2896,7 @@ vm_op_index(struct workspace *wk)
 			break;
 		}
 
-		res = make_obj(wk, obj_number);
-		set_obj_number(wk, res, (i * iter->data.range.step) + iter->data.range.start);
+		res = make_number(wk, (i * iter->data.range.step) + iter->data.range.start);
 		break;
 	}
 	case obj_typeinfo: {
@@ -2720,20 +2923,61 @@ type_err:
 	object_stack_push(wk, res);
 }
 
+static void
+vm_op_call(struct workspace *wk)
+{
+	wk->vm.nargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+	wk->vm.nkwargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+
+	obj f = object_stack_pop(&wk->vm.stack);
+
+	if (f == obj_disabler) {
+		object_stack_discard(&wk->vm.stack, wk->vm.nargs + wk->vm.nkwargs * 2);
+		object_stack_push(wk, obj_disabler);
+		return;
+	}
+
+	if (wk->vm.in_analyzer && get_obj_type(wk, f) == obj_typeinfo) {
+		object_stack_discard(&wk->vm.stack, wk->vm.nargs + wk->vm.nkwargs * 2);
+		vm_push_dummy(wk);
+		typecheck(wk, 0, f, tc_closure);
+		return;
+	} else if (!typecheck(wk, 0, f, tc_closure)) {
+		object_stack_discard(&wk->vm.stack, wk->vm.nargs + wk->vm.nkwargs * 2);
+		vm_push_dummy(wk);
+		return;
+	}
+
+	struct obj_closure *c = get_obj_closure(wk, f);
+	if (c->func) {
+		vm_begin_execute_closure(wk, f);
+	} else {
+		workspace_scratch_begin(wk);
+		vm_execute_native(wk, c->native_func, c->self, 0);
+		workspace_scratch_end(wk);
+	}
+}
+
 static void
 vm_op_member(struct workspace *wk)
 {
 	obj id, self, f = 0;
-	uint32_t idx;
+	uint32_t idx, cache_ip, cache;
+	enum obj_type t;
 
 	self = object_stack_pop(&wk->vm.stack);
 	id = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+	cache_ip = wk->vm.ip;
+	cache = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+	t = get_obj_type(wk, self);
 
-	if (!wk->vm.behavior.func_lookup(wk, self, get_str(wk, id)->s, &idx, &f)) {
+	if (cache && cache == vm_member_cache_key(t, wk->vm.lang_mode, vm_member_cache_idx(cache))) {
+		idx = vm_member_cache_idx(cache);
+	} else if (!wk->vm.behavior.func_lookup(wk, self, get_str(wk, id)->s, &idx, &f)) {
 		if (self == obj_disabler) {
 			object_stack_push(wk, obj_disabler);
 			return;
-		} else if (get_obj_type(wk, self) == obj_dict) {
+		} else if (t == obj_dict) {
 			obj res;
 			if (obj_dict_index(wk, self, id, &res)) {
 				object_stack_push(wk, res);
@@ -2742,8 +2986,7 @@ vm_op_member(struct workspace *wk)
 		} else if (typecheck_typeinfo(wk, self, tc_dict)) {
 			vm_push_dummy(wk);
 			return;
-		} else if (wk->vm.in_analyzer && get_obj_type(wk, self) == obj_module
-			   && !get_obj_module(wk, self)->found) {
+		} else if (wk->vm.in_analyzer && t == obj_module && !get_obj_module(wk, self)->found) {
 			// Don't error on missing functions for not-found modules
 			vm_push_dummy(wk);
 			return;
@@ -2752,64 +2995,51 @@ vm_op_member(struct workspace *wk)
 		vm_member_not_found_error(wk, id, self);
 		vm_push_dummy(wk);
 		return;
+	} else if (!f && t != obj_module && wk->vm.behavior.func_lookup == func_lookup) {
+		// Methods on modules depend on the module instance, everything else
+		// only depends on the type of self and the language mode.
+		vm_set_constant_ip(wk->vm.code.e, cache_ip, vm_member_cache_key(t, wk->vm.lang_mode, idx));
 	}
 
-	obj res = make_obj(wk, obj_closure);
-	struct obj_closure *c = get_obj_closure(wk, res);
-
 	if (f) {
 		if (get_obj_type(wk, f) == obj_typeinfo) {
 			vm_push_dummy(wk);
 			return;
 		}
 
+		obj res = make_obj(wk, obj_closure);
+		struct obj_closure *c = get_obj_closure(wk, res);
 		*c = *get_obj_closure(wk, f);
-	} else {
-		c->native_func = idx;
-
-		if (native_funcs[idx].self_transform && get_obj_type(wk, self) != obj_typeinfo) {
-			self = native_funcs[idx].self_transform(wk, self);
-		}
-	}
-
-	c->self = self;
-
-	object_stack_push(wk, res);
-}
-
-static void
-vm_op_call(struct workspace *wk)
-{
-	wk->vm.nargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
-	wk->vm.nkwargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
-
-	obj f = object_stack_pop(&wk->vm.stack);
-
-	if (f == obj_disabler) {
-		object_stack_discard(&wk->vm.stack, wk->vm.nargs + wk->vm.nkwargs * 2);
-		object_stack_push(wk, obj_disabler);
+		c->self = self;
+		object_stack_push(wk, res);
 		return;
 	}
 
-	if (wk->vm.in_analyzer && get_obj_type(wk, f) == obj_typeinfo) {
-		object_stack_discard(&wk->vm.stack, wk->vm.nargs + wk->vm.nkwargs * 2);
-		vm_push_dummy(wk);
-		typecheck(wk, 0, f, tc_closure);
-		return;
-	} else if (!typecheck(wk, 0, f, tc_closure)) {
-		object_stack_discard(&wk->vm.stack, wk->vm.nargs + wk->vm.nkwargs * 2);
-		vm_push_dummy(wk);
-		return;
+	if (native_funcs[idx].self_transform && t != obj_typeinfo) {
+		self = native_funcs[idx].self_transform(wk, self);
 	}
 
-	struct obj_closure *c = get_obj_closure(wk, f);
-	if (c->func) {
-		vm_begin_execute_closure(wk, f);
-	} else {
+	// A native method that is called immediately is dispatched directly
+	// rather than through a closure object that would only live until the
+	// following op_call.  This is skipped when op_call has been replaced,
+	// e.g. by the analyzer, or when a breakpoint is set on it.
+	if (wk->vm.code.e[wk->vm.ip] == op_call && wk->vm.ops.ops[op_call] == vm_op_call) {
+		++wk->vm.ip;
+		wk->vm.nargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+		wk->vm.nkwargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+
 		workspace_scratch_begin(wk);
-		vm_execute_native(wk, c->native_func, c->self);
+		vm_execute_native(wk, idx, self, 0);
 		workspace_scratch_end(wk);
+		return;
 	}
+
+	obj res = make_obj(wk, obj_closure);
+	struct obj_closure *c = get_obj_closure(wk, res);
+	c->native_func = idx;
+	c->self = self;
+
+	object_stack_push(wk, res);
 }
 
 static void
@@ -2819,8 +3049,9 @@ vm_op_call_native(struct workspace *wk)
 	wk->vm.nkwargs = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
 
 	uint32_t idx = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+	uint32_t kwarg_slots = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
 	workspace_scratch_begin(wk);
-	vm_execute_native(wk, idx, 0);
+	vm_execute_native(wk, idx, 0, kwarg_slots);
 	workspace_scratch_end(wk);
 }
 
@@ -2852,7 +3083,8 @@ vm_op_iterator(struct workspace *wk)
 
 		obj dup = obj_array_dup_light(wk, a);
 		struct obj_array *arr = get_obj_array(wk, dup);
-		iterator->data.array = arr->len ? bucket_arr_get(&wk->vm.objects.array_elems, arr->head) : 0;
+		iterator->data.array.e = obj_array_elems(wk, arr);
+		iterator->data.array.len = arr->len;
 		break;
 	case obj_dict: {
 		expected_args_to_unpack = 2;
@@ -2945,6 +3177,91 @@ push_dummy_iterator:
 	iterator->data.typeinfo.type = args_to_unpack == 2 ? obj_dict : obj_array;
 }
 
+enum {
+	// Number of objects made between attempts at a young collection.
+	vm_young_collect_interval = 8192,
+};
+
+static bool
+vm_young_collect_enabled(struct workspace *wk)
+{
+	return !wk->vm.in_analyzer && !wk->vm.error && !wk->vm.objects.obj_clear_mark_set && !wk->vm.dbg_state.dbg
+	       && !wk->vm.dbg_state.breakpoints.len && wk->vm.behavior.get_global == vm_get_global
+	       && wk->vm.behavior.assign_global == vm_assign_global;
+}
+
+static void
+vm_young_mark(struct workspace *wk, obj iter)
+{
+	obj_young_set_mark(wk);
+	wk->vm.objects.young.iter = iter;
+	wk->vm.objects.young.next_collect = wk->vm.objects.objs.len + vm_young_collect_interval;
+}
+
+/*
+ * Called at the start of each loop iteration.  Temporaries made by the loop
+ * body are reclaimed once they are no longer referenced by the stack or a
+ * global variable.  Loops that do anything else, e.g. call a function or
+ * append to a list defined outside the loop, just promote their young
+ * objects.
+ */
+static void
+vm_young_collect(struct workspace *wk)
+{
+	struct obj_young *y = &wk->vm.objects.young;
+	// Iterators of enclosing loops were made first, so they have lower ids.
+	obj iter = object_stack_peek(&wk->vm.stack, 1);
+
+	if (!y->set) {
+		if (vm_young_collect_enabled(wk)) {
+			vm_young_mark(wk, iter);
+		}
+		return;
+	}
+
+	if (iter < y->iter) {
+		y->iter = iter;
+	}
+
+	if (wk->vm.objects.objs.len < y->next_collect) {
+		return;
+	} else if (y->dirty && iter != y->iter && wk->vm.objects.objs.len < y->next_collect + vm_young_collect_interval) {
+		// Something made before the mark was modified, e.g. a dict an
+		// inner loop is adding to.  Moving the mark inside that loop would
+		// just catch it again, so wait for the outer loop to come around.
+		return;
+	} else if (y->dirty || y->global_scope != wk->vm.global_scope || !vm_young_collect_enabled(wk)) {
+		vm_young_mark(wk, iter);
+		return;
+	}
+
+	workspace_scratch_begin(wk);
+
+	struct arr roots;
+	arr_init(wk->a_scratch, &roots, 256, obj *);
+
+	for (uint32_t i = 1; i <= wk->vm.stack.ba.len; ++i) {
+		arr_push(wk->a_scratch, &roots, &(obj *){ &object_stack_peek_entry(&wk->vm.stack, i)->o });
+	}
+
+	obj_dict_val_pointers(wk, wk->vm.global_scope, wk->a_scratch, &roots);
+
+	uint32_t survivors;
+	if (obj_young_collect(wk, &roots, &survivors)) {
+		// If a lot survived, the loop is probably accumulating something.
+		// Promote it rather than copying it again next time.
+		if (survivors > vm_young_collect_interval / 4) {
+			vm_young_mark(wk, object_stack_peek(&wk->vm.stack, 1));
+		} else {
+			y->next_collect = wk->vm.objects.objs.len + vm_young_collect_interval;
+		}
+	} else {
+		y->next_collect = wk->vm.objects.objs.len + vm_young_collect_interval;
+	}
+
+	workspace_scratch_end(wk);
+}
+
 static void
 vm_op_iterator_next(struct workspace *wk)
 {
@@ -2952,26 +3269,26 @@ vm_op_iterator_next(struct workspace *wk)
 	obj key = 0, val = 0;
 	struct obj_iterator *iterator;
 	uint32_t break_jmp = vm_get_constant(wk->vm.code.e, &wk->vm.ip);
+
+	vm_young_collect(wk);
+
 	iterator = get_obj_iterator(wk, object_stack_peek(&wk->vm.stack, 1));
 	bool should_break = false;
 
 	switch (iterator->type) {
 	case obj_iterator_type_array:
-		if (!iterator->data.array) {
+		if (iterator->data.array.i >= iterator->data.array.len) {
 			should_break = true;
 		} else {
-			val = iterator->data.array->val;
-			iterator->data.array = iterator->data.array->next ? bucket_arr_get(
-						       &wk->vm.objects.array_elems, iterator->data.array->next) :
-									    0;
+			val = iterator->data.array.e[iterator->data.array.i];
+			++iterator->data.array.i;
 		}
 		break;
 	case obj_iterator_type_range:
 		if (iterator->data.range.i >= iterator->data.range.stop) {
 			should_break = true;
 		} else {
-			val = make_obj(wk, obj_number);
-			set_obj_number(wk, val, iterator->data.range.i);
+			val = make_number(wk, iterator->data.range.i);
 			iterator->data.range.i += iterator->data.range.step;
 		}
 		break;
@@ -3280,6 +3597,9 @@ vm_execute_impl(struct workspace *wk, uint32_t ip, obj closure, obj frame_name)
 	uint32_t object_stack_base = wk->vm.stack.ba.len;
 	obj res = 0;
 
+	// The caller may be holding on to young objects.
+	wk->vm.objects.young.set = false;
+
 	vm_dbg_resolve_breakpoints(wk);
 
 	stack_push(&wk->stack, wk->vm.run, true);
@@ -3325,6 +3645,8 @@ done:
 	stack_pop(&wk->stack, wk->vm.call_stack_base);
 	stack_pop(&wk->stack, wk->vm.run);
 
+	wk->vm.objects.young.set = false;
+
 	TracyCZoneAutoE;
 	return res;
 }
@@ -3342,7 +3664,12 @@ vm_execute(struct workspace *wk, uint32_t ip, obj frame_name)
 static bool
 vm_get_global(struct workspace *wk, const char *name, obj *res)
 {
-	return obj_dict_index_str(wk, wk->vm.global_scope, name, res);
+	if (!obj_dict_index_str(wk, wk->vm.global_scope, name, res)) {
+		return false;
+	}
+
+	vm_str_builder_release(wk, *res);
+	return true;
 }
 
 static obj
@@ -3357,6 +3684,7 @@ static void
 vm_unassign_global(struct workspace *wk, const char *name)
 {
 	obj_dict_del_str(wk, wk->vm.global_scope, name);
+	++wk->vm.global_slots_generation;
 }
 
 static void
@@ -3371,10 +3699,178 @@ vm_native_func_dispatch(struct workspace *wk, uint32_t func_idx, obj self, obj *
 	return native_funcs[func_idx].func(wk, self, res);
 }
 
+/******************************************************************************
+ * superinstructions
+ ******************************************************************************/
+
+/* These are only dispatched by vm_execute_loop_direct, where the handlers for
+ * the following ops are known to be the default ones.  Each one checks the
+ * upcoming bytecode and falls back to the plain handler if it doesn't match.
+ * A breakpoint patched over any of the fused ops makes the match fail, so
+ * op_dbg_break is still dispatched normally. */
+
+static bool
+vm_code_matches(struct workspace *wk, uint32_t ip, enum op op)
+{
+	return ip < wk->vm.code.len && wk->vm.code.e[ip] == op;
+}
+
+/* store_l; pop: store the popped value directly into the local slot. */
 static void
-vm_execute_loop(struct workspace *wk)
+vm_op_store_l_pop(struct workspace *wk)
 {
-	uint32_t cip;
+	if (!vm_code_matches(wk, wk->vm.ip + op_operand_size, op_pop)) {
+		vm_op_store_l(wk);
+		return;
+	}
+
+	vm_op_store_load_l_common();
+
+	const struct obj_stack_entry src = *object_stack_pop_entry(&wk->vm.stack);
+	slot->o = vm_perform_store_mutations(wk, src.o);
+	slot->ip = src.ip;
+	++wk->vm.ip;
+}
+
+/* iterator_next; store_l; pop: the loop variable of a single-variable foreach. */
+static void
+vm_op_iterator_next_store_l(struct workspace *wk)
+{
+	const uint32_t next_ip = wk->vm.ip + op_operand_size;
+
+	vm_op_iterator_next(wk);
+
+	if (wk->vm.run && wk->vm.ip == next_ip && vm_code_matches(wk, next_ip, op_store_l)) {
+		++wk->vm.ip;
+		vm_op_store_l_pop(wk);
+	}
+}
+
+/* load_l; constant; index: index a local array or dict by a constant without
+ * pushing either operand.  Anything other than an in-bounds array index or a
+ * present dict key goes through the regular ops so that errors are reported
+ * the same way. */
+static void
+vm_op_load_l_index(struct workspace *wk)
+{
+	const uint32_t constant_ip = wk->vm.ip + op_operand_size,
+		       index_ip = constant_ip + OP_WIDTH(op_constant);
+
+	if (!(vm_code_matches(wk, constant_ip, op_constant) && vm_code_matches(wk, index_ip, op_index))) {
+		vm_op_load_l(wk);
+		return;
+	}
+
+	const struct call_frame *frame = arr_get(&wk->vm.call_stack, wk->vm.call_stack.len - 1);
+	obj slot_idx = vm_get_constant_ip(wk->vm.code.e, wk->vm.ip) + frame->stack_base;
+	const struct obj_stack_entry *slot = bucket_arr_get(&wk->vm.stack.ba, slot_idx);
+	obj a = slot->o, b = vm_get_constant_ip(wk->vm.code.e, constant_ip + 1), res = 0;
+	bool found = false;
+
+	if (a == obj_uninitialized) {
+		vm_op_load_l(wk);
+		return;
+	}
+
+	switch (get_obj_type(wk, a)) {
+	case obj_array: {
+		if (get_obj_type(wk, b) != obj_number) {
+			break;
+		}
+
+		int64_t i = get_obj_number(wk, b);
+		if (bounds_adjust(get_obj_array(wk, a)->len, &i)) {
+			res = obj_array_index(wk, a, i);
+			found = true;
+		}
+		break;
+	}
+	case obj_dict: {
+		found = get_obj_type(wk, b) == obj_string && obj_dict_index(wk, a, b, &res);
+		break;
+	}
+	default: break;
+	}
+
+	if (!found) {
+		vm_op_load_l(wk);
+		return;
+	}
+
+	wk->vm.ip = index_ip + 1;
+	object_stack_push(wk, res);
+}
+
+/******************************************************************************
+ * execute loop
+ ******************************************************************************/
+
+/* The default op handlers.  Each entry is (op, handler, direct handler), where
+ * the direct handler is what vm_execute_loop_direct dispatches to and may be
+ * a superinstruction. */
+#define VM_DEFAULT_OPS(_)                                                                  \
+	_(op_constant, vm_op_constant, vm_op_constant)                                     \
+	_(op_constant_list, vm_op_constant_list, vm_op_constant_list)                      \
+	_(op_constant_dict, vm_op_constant_dict, vm_op_constant_dict)                      \
+	_(op_constant_func, vm_op_constant_func, vm_op_constant_func)                      \
+	_(op_add, vm_op_add, vm_op_add)                                                    \
+	_(op_sub, vm_op_sub, vm_op_sub)                                                    \
+	_(op_mul, vm_op_mul, vm_op_mul)                                                    \
+	_(op_div, vm_op_div, vm_op_div)                                                    \
+	_(op_mod, vm_op_mod, vm_op_mod)                                                    \
+	_(op_not, vm_op_not, vm_op_not)                                                    \
+	_(op_eq, vm_op_eq, vm_op_eq)                                                       \
+	_(op_in, vm_op_in, vm_op_in)                                                       \
+	_(op_gt, vm_op_gt, vm_op_gt)                                                       \
+	_(op_lt, vm_op_lt, vm_op_lt)                                                       \
+	_(op_negate, vm_op_negate, vm_op_negate)                                           \
+	_(op_coerce, vm_op_coerce, vm_op_coerce)                                           \
+	_(op_store_g, vm_op_store_g, vm_op_store_g)                                        \
+	_(op_add_store_g, vm_op_add_store_g, vm_op_add_store_g)                            \
+	_(op_try_load_g, vm_op_try_load, vm_op_try_load)                                   \
+	_(op_load_g, vm_op_load_g, vm_op_load_g)                                           \
+	_(op_store_m, vm_op_store_m, vm_op_store_m)                                        \
+	_(op_add_store_m, vm_op_add_store_m, vm_op_add_store_m)                            \
+	_(op_store_l, vm_op_store_l, vm_op_store_l_pop)                                    \
+	_(op_add_store_l, vm_op_add_store_l, vm_op_add_store_l)                            \
+	_(op_load_l, vm_op_load_l, vm_op_load_l_index)                                     \
+	_(op_store_u, vm_op_store_u, vm_op_store_u)                                        \
+	_(op_add_store_u, vm_op_add_store_u, vm_op_add_store_u)                            \
+	_(op_load_u, vm_op_load_u, vm_op_load_u)                                           \
+	_(op_return, vm_op_return, vm_op_return)                                           \
+	_(op_return_end, vm_op_return, vm_op_return)                                       \
+	_(op_call, vm_op_call, vm_op_call)                                                 \
+	_(op_member, vm_op_member, vm_op_member)                                           \
+	_(op_call_native, vm_op_call_native, vm_op_call_native)                            \
+	_(op_index, vm_op_index, vm_op_index)                                              \
+	_(op_iterator, vm_op_iterator, vm_op_iterator)                                     \
+	_(op_iterator_next, vm_op_iterator_next, vm_op_iterator_next_store_l)              \
+	_(op_jmp_if_false, vm_op_jmp_if_false, vm_op_jmp_if_false)                         \
+	_(op_jmp_if_true, vm_op_jmp_if_true, vm_op_jmp_if_true)                            \
+	_(op_jmp_if_disabler, vm_op_jmp_if_disabler, vm_op_jmp_if_disabler)                \
+	_(op_jmp_if_disabler_keep, vm_op_jmp_if_disabler_keep, vm_op_jmp_if_disabler_keep) \
+	_(op_jmp, vm_op_jmp, vm_op_jmp)                                                    \
+	_(op_pop, vm_op_pop, vm_op_pop)                                                    \
+	_(op_dup, vm_op_dup, vm_op_dup)                                                    \
+	_(op_swap, vm_op_swap, vm_op_swap)                                                 \
+	_(op_typecheck, vm_op_typecheck, vm_op_typecheck)                                  \
+	_(op_dbg_break, vm_op_dbg_break, vm_op_dbg_break)
+
+static const struct vm_ops vm_default_ops = { .ops = {
+#define VM_OP_TABLE_ENTRY(op, fn, direct_fn) [op] = fn,
+	VM_DEFAULT_OPS(VM_OP_TABLE_ENTRY)
+#undef VM_OP_TABLE_ENTRY
+} };
+
+/* Dispatches through wk->vm.ops.  This loop is used whenever something needs
+ * to observe every op: the progress bar, op profiling, or a patched op table
+ * such as the analyzer's. */
+static void
+vm_execute_loop_generic(struct workspace *wk)
+{
+	struct vm_op_profile *prof = wk->vm.op_profile;
+	uint8_t op, prev_op = 0;
+
 	while (wk->vm.run) {
 		// if (log_should_print(log_debug)) {
 		// 	LL("%-50s", vm_dis_inst(wk, wk->vm.code.e, wk->vm.ip, 0));
@@ -3385,21 +3881,104 @@ vm_execute_loop(struct workspace *wk)
 
 		// vm_check_break(wk, wk->vm.ip);
 
-		cip = wk->vm.ip;
+		op = wk->vm.code.e[wk->vm.ip];
 		++wk->vm.ip;
 
+		if (prof) {
+			++prof->ops[op];
+			++prof->pairs[prev_op][op];
+			prev_op = op;
+		}
+
 		// TracyCZoneN(tctx, "op", true);
 		// {
-		// 	const char *op_name = vm_op_to_s(wk->vm.code.e[cip]);
+		// 	const char *op_name = vm_op_to_s(op);
 		// 	TracyCZoneName(tctx, op_name, strlen(op_name));
 		// }
 
-		wk->vm.ops.ops[wk->vm.code.e[cip]](wk);
+		wk->vm.ops.ops[op](wk);
 
 		// TracyCZoneEnd(tctx);
 	}
 }
 
+#if defined(__GNUC__) && !defined(__TINYC__)
+#define VM_COMPUTED_GOTO 1
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+/* Calls the default handlers directly rather than through wk->vm.ops so that
+ * each op costs a single indirect jump and the handlers can be inlined.
+ * Breakpoints still work since op_dbg_break is dispatched like any other op.
+ * Note that wk->vm.code.e must be reloaded for every op since it may be
+ * reallocated by a handler, e.g. when evaluating a subproject. */
+static void
+vm_execute_loop_direct(struct workspace *wk)
+{
+#if VM_COMPUTED_GOTO
+	static const void *dispatch[op_count] = {
+		[0] = &&vm_label_fallback,
+#define VM_OP_LABEL_ENTRY(op, fn, direct_fn) [op] = &&vm_label_##op,
+		VM_DEFAULT_OPS(VM_OP_LABEL_ENTRY)
+#undef VM_OP_LABEL_ENTRY
+		[op_az_branch] = &&vm_label_fallback,
+		[op_az_merge] = &&vm_label_fallback,
+		[op_az_noop] = &&vm_label_fallback,
+	};
+
+#define VM_DISPATCH()                  \
+	if (!wk->vm.run) {             \
+		return;                \
+	}                              \
+	goto *dispatch[wk->vm.code.e[wk->vm.ip++]]
+
+	VM_DISPATCH();
+
+#define VM_OP_LABEL(op, fn, direct_fn) \
+	vm_label_##op : direct_fn(wk);     \
+	VM_DISPATCH();
+	VM_DEFAULT_OPS(VM_OP_LABEL)
+#undef VM_OP_LABEL
+
+vm_label_fallback:
+	wk->vm.ops.ops[wk->vm.code.e[wk->vm.ip - 1]](wk);
+	VM_DISPATCH();
+#undef VM_DISPATCH
+#else
+	uint8_t op;
+	while (wk->vm.run) {
+		op = wk->vm.code.e[wk->vm.ip];
+		++wk->vm.ip;
+
+		switch (op) {
+#define VM_OP_CASE(op, fn, direct_fn) \
+	case op: direct_fn(wk); break;
+			VM_DEFAULT_OPS(VM_OP_CASE)
+#undef VM_OP_CASE
+		default: wk->vm.ops.ops[op](wk); break;
+		}
+	}
+#endif
+}
+
+#if VM_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+static void
+vm_execute_loop(struct workspace *wk)
+{
+	if (wk->vm.op_profile || log_is_progress_bar_enabled()
+		|| memcmp(&wk->vm.ops, &vm_default_ops, sizeof(struct vm_ops)) != 0) {
+		vm_execute_loop_generic(wk);
+	} else {
+		vm_execute_loop_direct(wk);
+	}
+}
+
 /******************************************************************************
  * struct/type registration
  ******************************************************************************/
@@ -3745,8 +4324,7 @@ vm_reflect_obj_field_(struct workspace *wk, enum obj_type t, const struct vm_ref
 
 	int64_t i = wk->vm.objects.reflected.fields.len;
 	bucket_arr_push(wk->a, &wk->vm.objects.reflected.fields, f);
-	obj n = make_obj(wk, obj_number);
-	set_obj_number(wk, n, i);
+	obj n = make_number(wk, i);
 	obj_array_push(wk, wk->vm.objects.reflected.objs[t], n);
 }
 
@@ -3864,7 +4442,11 @@ vm_init_objects(struct workspace *wk)
 	bucket_arr_init(wk->a, &wk->vm.objects.objs, 1024, struct obj_internal);
 	bucket_arr_init(wk->a, &wk->vm.objects.dict_elems, 1024, struct obj_dict_elem);
 	bucket_arr_init(wk->a, &wk->vm.objects.dict_hashes, 16, struct hash);
-	bucket_arr_init(wk->a, &wk->vm.objects.array_elems, 1024, struct obj_array_elem);
+	arr_init(wk->a, &wk->vm.objects.dict_hashes_free, 16, struct hash);
+	arr_init(wk->a, &wk->vm.objects.array_chunks, 16, struct obj_array_chunk);
+	arr_init(wk->a, &wk->vm.objects.array_chunks_free, 16, struct obj_array_chunk);
+	bucket_arr_init(wk->a, &wk->vm.objects.array_indexes, 16, struct obj_array_index);
+	hash_init(wk->a, &wk->vm.objects.array_index_ids, 16, obj);
 	bucket_arr_init(wk->a, &wk->vm.objects.reflected.fields, 128, struct vm_reflected_field);
 
 #define P(__type) sizeof(__type), ar_alignof(__type)
@@ -3914,9 +4496,8 @@ vm_init_objects(struct workspace *wk)
 			sizes[i].item_align);
 	}
 
-	// reserve dict_elem 0 and array_elem as a null element
+	// reserve dict_elem 0 as a null element
 	bucket_arr_pushn(wk->a, &wk->vm.objects.dict_elems, 0, 0, 1);
-	bucket_arr_pushn(wk->a, &wk->vm.objects.array_elems, 0, 0, 1);
 
 	hash_init_str(wk->a, &wk->vm.objects.str_hash, 128);
 
@@ -3934,16 +4515,18 @@ vm_init(struct workspace *wk)
 	arr_init(wk->a, &wk->vm.code, 4 * 1024, char);
 	arr_init(wk->a, &wk->vm.src, 64, struct source);
 	arr_init(wk->a, &wk->vm.locations, 1024, struct source_location_mapping);
+	arr_init(wk->a, &wk->vm.kwarg_slots, 256, struct vm_kwarg_slot);
+	arr_init(wk->a, &wk->vm.global_slots, 256, struct vm_global_slot);
 	arr_init(wk->a, &wk->vm.open_upvalues, 256, struct open_upvalue);
 
 	/* compiler state */
-	arr_init(wk->a, &wk->vm.compiler_state.node_stack, 4096, struct node *);
+	arr_init(wk->a, &wk->vm.compiler_state.node_stack, 4096, uint32_t);
 	arr_init(wk->a, &wk->vm.compiler_state.locals, 256, struct local_binding);
 	arr_init(wk->a, &wk->vm.compiler_state.upvalues, 256, struct upvalue_binding);
 	arr_init(wk->a, &wk->vm.compiler_state.call_stack, 128, struct compiler_call_frame);
 	arr_init(wk->a, &wk->vm.compiler_state.if_jmp_stack, 64, uint32_t);
 	arr_init(wk->a, &wk->vm.compiler_state.loop_jmp_stack, 64, uint32_t);
-	bucket_arr_init(wk->a, &wk->vm.compiler_state.nodes, 2048, struct node);
+	hash_init_str(wk->a, &wk->vm.compiler_state.global_slot_names, 256);
 
 	/* behavior pointers */
 	wk->vm.behavior = (struct vm_behavior){
@@ -3959,54 +4542,7 @@ vm_init(struct workspace *wk)
 	};
 
 	/* ops */
-	wk->vm.ops = (struct vm_ops){ .ops = {
-					      [op_constant] = vm_op_constant,
-					      [op_constant_list] = vm_op_constant_list,
-					      [op_constant_dict] = vm_op_constant_dict,
-					      [op_constant_func] = vm_op_constant_func,
-					      [op_add] = vm_op_add,
-					      [op_sub] = vm_op_sub,
-					      [op_mul] = vm_op_mul,
-					      [op_div] = vm_op_div,
-					      [op_mod] = vm_op_mod,
-					      [op_not] = vm_op_not,
-					      [op_eq] = vm_op_eq,
-					      [op_in] = vm_op_in,
-					      [op_gt] = vm_op_gt,
-					      [op_lt] = vm_op_lt,
-					      [op_negate] = vm_op_negate,
-					      [op_coerce] = vm_op_coerce,
-					      [op_store_g] = vm_op_store_g,
-					      [op_add_store_g] = vm_op_add_store_g,
-					      [op_try_load_g] = vm_op_try_load,
-					      [op_load_g] = vm_op_load_g,
-					      [op_store_m] = vm_op_store_m,
-					      [op_add_store_m] = vm_op_add_store_m,
-					      [op_store_l] = vm_op_store_l,
-					      [op_add_store_l] = vm_op_add_store_l,
-					      [op_load_l] = vm_op_load_l,
-					      [op_store_u] = vm_op_store_u,
-					      [op_add_store_u] = vm_op_add_store_u,
-					      [op_load_u] = vm_op_load_u,
-					      [op_return] = vm_op_return,
-					      [op_return_end] = vm_op_return,
-					      [op_call] = vm_op_call,
-					      [op_member] = vm_op_member,
-					      [op_call_native] = vm_op_call_native,
-					      [op_index] = vm_op_index,
-					      [op_iterator] = vm_op_iterator,
-					      [op_iterator_next] = vm_op_iterator_next,
-					      [op_jmp_if_false] = vm_op_jmp_if_false,
-					      [op_jmp_if_true] = vm_op_jmp_if_true,
-					      [op_jmp_if_disabler] = vm_op_jmp_if_disabler,
-					      [op_jmp_if_disabler_keep] = vm_op_jmp_if_disabler_keep,
-					      [op_jmp] = vm_op_jmp,
-					      [op_pop] = vm_op_pop,
-					      [op_dup] = vm_op_dup,
-					      [op_swap] = vm_op_swap,
-					      [op_typecheck] = vm_op_typecheck,
-					      [op_dbg_break] = vm_op_dbg_break,
-				      } };
+	wk->vm.ops = vm_default_ops;
 
 	/* objects */
 	vm_init_objects(wk);
@@ -4053,6 +4589,22 @@ vm_mem_stat(struct workspace *wk, struct vm_mem_stats *stats)
 
 	for (uint32_t i = _obj_aos_start; i < obj_type_count; ++i) {
 	}
+
+	const struct bucket_arr *arrays = &wk->vm.objects.obj_aos[obj_array - _obj_aos_start];
+	for (i = 0; i < arrays->len; ++i) {
+		const struct obj_array *a = bucket_arr_get(arrays, i);
+		stats->array_storage.elems += a->len;
+		if (!(a->flags & obj_array_flag_cow)) {
+			stats->array_storage.reserved += a->cap;
+		}
+	}
+
+	stats->array_storage.chunks = wk->vm.objects.array_chunks.len;
+	for (i = 0; i < wk->vm.objects.array_chunks.len; ++i) {
+		const struct obj_array_chunk *chunk = arr_get(&wk->vm.objects.array_chunks, i);
+		stats->array_storage.used += chunk->len;
+		stats->array_storage.allocated += chunk->cap;
+	}
 }
 
 void
@@ -4063,4 +4615,82 @@ vm_mem_stat_print(struct workspace *wk, struct vm_mem_stats *stats)
 	for (i = 0; i < obj_type_count; ++i) {
 		printf("%s - %d\n", obj_type_to_s(i), stats->count[i]);
 	}
+
+	printf("array storage:\n");
+	printf("elements - %" PRIu64 "\n", stats->array_storage.elems);
+	printf("reserved - %" PRIu64 "\n", stats->array_storage.reserved);
+	printf("used - %" PRIu64 " / %" PRIu64 " in %d chunks (%" PRIu64 " bytes)\n",
+		stats->array_storage.used,
+		stats->array_storage.allocated,
+		stats->array_storage.chunks,
+		stats->array_storage.allocated * sizeof(obj));
+}
+
+struct vm_op_profile_entry {
+	uint64_t n;
+	uint8_t op, next_op;
+};
+
+static int32_t
+vm_op_profile_entry_compare(const void *_a, const void *_b, void *_ctx)
+{
+	const struct vm_op_profile_entry *a = _a, *b = _b;
+	return a->n < b->n ? 1 : a->n > b->n ? -1 : 0;
+}
+
+static void
+vm_op_profile_print_entries(struct workspace *wk, struct arr *entries, uint64_t total, const char *title)
+{
+	const uint32_t max_entries = 32;
+
+	arr_sort(entries, 0, vm_op_profile_entry_compare);
+
+	log_plain(log_info, "%s:\n", title);
+	for (uint32_t i = 0; i < entries->len && i < max_entries; ++i) {
+		const struct vm_op_profile_entry *e = arr_get(entries, i);
+		log_plain(log_info, "%12" PRIu64 " %5.1f%%  %s", e->n, e->n * 100.0 / total, vm_op_to_s(e->op));
+		if (e->next_op) {
+			log_plain(log_info, " %s", vm_op_to_s(e->next_op));
+		}
+		log_plain(log_info, "\n");
+	}
+}
+
+void
+vm_op_profile_print(struct workspace *wk)
+{
+	const struct vm_op_profile *prof = wk->vm.op_profile;
+	if (!prof) {
+		return;
+	}
+
+	struct arr ops, pairs;
+	arr_init(wk->a_scratch, &ops, op_count, struct vm_op_profile_entry);
+	arr_init(wk->a_scratch, &pairs, 256, struct vm_op_profile_entry);
+
+	uint64_t total = 0;
+	for (uint32_t i = 1; i < op_count; ++i) {
+		if (!prof->ops[i]) {
+			continue;
+		}
+
+		total += prof->ops[i];
+		arr_push(wk->a_scratch, &ops, &(struct vm_op_profile_entry){ .n = prof->ops[i], .op = i });
+
+		for (uint32_t j = 1; j < op_count; ++j) {
+			if (prof->pairs[i][j]) {
+				arr_push(wk->a_scratch,
+					&pairs,
+					&(struct vm_op_profile_entry){ .n = prof->pairs[i][j], .op = i, .next_op = j });
+			}
+		}
+	}
+
+	if (!total) {
+		return;
+	}
+
+	log_plain(log_info, "%" PRIu64 " ops executed\n", total);
+	vm_op_profile_print_entries(wk, &ops, total, "ops");
+	vm_op_profile_print_entries(wk, &pairs, total, "op pairs");
 }
@@ -167,18 +167,40 @@ workspace_init_startup_files(struct workspace *wk)
 		UNREACHABLE;
 	}
 
-	const char *startup_files[] = {
-		"runtime/dependencies.meson",
-		"runtime/toolchains.meson",
-	};
-
-	for (uint32_t i = 0; i < ARRAY_LEN(startup_files); ++i) {
-		if (!workspace_eval_startup_file(wk, startup_files[i])) {
-			LOG_W("script %s failed to load", startup_files[i]);
-		}
+	wk->init_flags |= workspace_init_flag_startup_files;
+}
+
+/*
+ * The runtime scripts that fill in the toolchain registry and the dependency
+ * handlers are evaluated when either is first used, so that commands and
+ * projects which need neither don't pay for parsing and compiling them.
+ */
+static void
+workspace_init_runtime_script(struct workspace *wk, enum workspace_init_flag flag, const char *script)
+{
+	if ((wk->init_flags & flag) || !(wk->init_flags & workspace_init_flag_startup_files)) {
+		return;
 	}
 
-	wk->init_flags |= workspace_init_flag_startup_files;
+	// Set this first, the script registers its entries through the same
+	// paths that trigger loading it.
+	wk->init_flags |= flag;
+
+	if (!workspace_eval_startup_file(wk, script)) {
+		LOG_W("script %s failed to load", script);
+	}
+}
+
+void
+workspace_init_toolchain_runtime(struct workspace *wk)
+{
+	workspace_init_runtime_script(wk, workspace_init_flag_toolchain_runtime, "runtime/toolchains.meson");
+}
+
+void
+workspace_init_dependency_runtime(struct workspace *wk)
+{
+	workspace_init_runtime_script(wk, workspace_init_flag_dependency_runtime, "runtime/dependencies.meson");
 }
 
 void
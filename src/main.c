@@ -31,6 +31,7 @@
 #include "lang/lsp.h"
 #include "lang/object_iterators.h"
 #include "lang/parser.h"
+#include "lang/profile.h"
 #include "lang/serial.h"
 #include "lang/typecheck.h"
 #include "meson_opts.h"
@@ -526,6 +527,8 @@ cmd_eval(struct workspace *wk, uint32_t argc, uint32_t argi, char *const argv[])
 			if (!vm_dbg_dap_setup(wk, opt_ctx.optarg)) {
 				return false;
 			}
+		} else if (opt_match('p', "print a histogram of executed ops")) {
+			wk->vm.op_profile = ar_make(wk->a, struct vm_op_profile);
 		}
 	}
 	opt_end();
@@ -591,6 +594,7 @@ cmd_eval(struct workspace *wk, uint32_t argc, uint32_t argi, char *const argv[])
 
 	ret = true;
 ret:
+	vm_op_profile_print(wk);
 	return ret;
 }
 
@@ -694,6 +698,7 @@ cmd_dump_toolchains(struct workspace *wk, uint32_t argc, uint32_t argi, char *co
 	if (!ga->enabled) {
 		workspace_init_runtime(wk);
 		workspace_init_startup_files(wk);
+		workspace_init_toolchain_runtime(wk);
 
 		comp = make_obj(wk, obj_compiler);
 		compiler = get_obj_compiler(wk, comp);
@@ -1073,6 +1078,11 @@ cmd_setup_common(struct workspace *wk,
 
 			obj_array_push(wk, regen_args, make_str(wk, "-p"));
 			obj_array_push(wk, regen_args, make_str(wk, opt_ctx.optarg));
+		} else if (opt_match('P', "profile setup and write collapsed stacks to <file>", "file")) {
+			// Made absolute since we may chdir to the source dir below.
+			TSTR(path);
+			path_make_absolute(wk, &path, opt_ctx.optarg);
+			vm_profile_init(wk, get_str(wk, tstr_into_str(wk, &path))->s);
 		}
 	}
 	opt_end();
@@ -1198,6 +1208,10 @@ cmd_setup_common(struct workspace *wk,
 
 	res = true;
 ret:
+	if (!vm_profile_write(wk)) {
+		res = false;
+	}
+
 	ctx->build_dir = build_dir ? make_str(wk, build_dir) : 0;
 	ctx->argi = argi;
 	TracyCZoneAutoE;
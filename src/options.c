@@ -380,8 +380,7 @@ coerce_option_override(struct workspace *wk, struct obj_option *opt, obj sval, o
 			return false;
 		}
 
-		*res = make_obj(wk, obj_number);
-		set_obj_number(wk, *res, num);
+		*res = make_number(wk, num);
 		break;
 	}
 	case op_shell_array:
@@ -599,6 +599,7 @@ fs_path_xdg_home(struct workspace *wk, enum fs_path_xdg_type type, enum fs_path_
 		[fs_path_xdg_type_config] = { "XDG_CONFIG_HOME", ".config" },
 		[fs_path_xdg_type_data] = { "XDG_DATA_HOME", ".local/share" },
 		[fs_path_xdg_type_state] = { "XDG_STATE_HOME", ".local/state" },
+		[fs_path_xdg_type_cache] = { "XDG_CACHE_HOME", ".cache" },
 	};
 
 	assert(type < ARRAY_LEN(types));
@@ -18,6 +18,12 @@ timer_read(struct timer *t)
 	return 0.0f;
 }
 
+uint64_t
+timer_read_ns(struct timer *t)
+{
+	return 0;
+}
+
 void
 timer_sleep(uint64_t nanoseconds)
 {
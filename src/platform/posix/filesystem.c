@@ -9,8 +9,12 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#ifdef MUON_HAVE_THREADS
+#include <pthread.h>
+#endif
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -21,8 +25,10 @@
 #include "log.h"
 #include "platform/assert.h"
 #include "platform/filesystem.h"
+#include "platform/mem.h"
 #include "platform/os.h"
 #include "platform/path.h"
+#include "platform/timer.h"
 
 static bool
 fs_lstat(const char *path, struct stat *sb)
@@ -35,17 +41,13 @@ fs_lstat(const char *path, struct stat *sb)
 	return true;
 }
 
-enum fs_mtime_result
-fs_mtime(const char *path, int64_t *mtime)
+static enum fs_mtime_result
+fs_mtime_nolog(const char *path, int64_t *mtime)
 {
 	struct stat st;
 
 	if (stat(path, &st) < 0) {
-		if (errno != ENOENT) {
-			LOG_E("failed stat(%s): %s", path, strerror(errno));
-			return fs_mtime_result_err;
-		}
-		return fs_mtime_result_not_found;
+		return errno == ENOENT ? fs_mtime_result_not_found : fs_mtime_result_err;
 	} else {
 #ifdef __APPLE__
 		*mtime = (int64_t)st.st_mtime * 1000000000 + st.st_mtimensec;
@@ -63,6 +65,195 @@ fs_mtime(const char *path, int64_t *mtime)
 	}
 }
 
+enum fs_mtime_result
+fs_mtime(const char *path, int64_t *mtime)
+{
+	enum fs_mtime_result res;
+
+	if ((res = fs_mtime_nolog(path, mtime)) == fs_mtime_result_err) {
+		LOG_E("failed stat(%s): %s", path, strerror(errno));
+	}
+	return res;
+}
+
+#ifdef MUON_HAVE_THREADS
+/* stat latency rather than cpu time dominates, so use a fixed number of
+ * threads regardless of how many cores there are */
+enum {
+	fs_mtime_pool_threads = 8,
+	fs_mtime_batch_chunk = 64,
+	fs_mtime_batch_min_threaded = 8 * fs_mtime_batch_chunk,
+	/* cached stats are faster than this, and threads only add overhead to
+	 * them */
+	fs_mtime_batch_slow_ns = 4000,
+};
+
+struct fs_mtime_pool {
+	pthread_t threads[fs_mtime_pool_threads - 1];
+	uint32_t nthreads;
+	pthread_mutex_t lock;
+	pthread_cond_t work, done;
+	struct fs_mtime_batch_entry *entries;
+	uint32_t len, next, busy;
+	bool quit;
+};
+
+/* Stat chunks of the current batch until there are none left.  Called with
+ * pool->lock held. */
+static void
+fs_mtime_pool_run(struct fs_mtime_pool *pool)
+{
+	struct fs_mtime_batch_entry *entries;
+	uint32_t i, end;
+
+	while (pool->next < pool->len) {
+		entries = pool->entries;
+		i = pool->next;
+		end = pool->len - i > fs_mtime_batch_chunk ? i + fs_mtime_batch_chunk : pool->len;
+		pool->next = end;
+		++pool->busy;
+		pthread_mutex_unlock(&pool->lock);
+
+		for (; i < end; ++i) {
+			entries[i].res = fs_mtime_nolog(entries[i].path, &entries[i].mtime);
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		--pool->busy;
+	}
+}
+
+static void *
+fs_mtime_pool_worker(void *_pool)
+{
+	struct fs_mtime_pool *pool = _pool;
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->quit) {
+		fs_mtime_pool_run(pool);
+		if (!pool->busy) {
+			pthread_cond_signal(&pool->done);
+		}
+		pthread_cond_wait(&pool->work, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+static struct fs_mtime_pool *
+fs_mtime_pool_create(void)
+{
+	struct fs_mtime_pool *pool = z_calloc(1, sizeof(*pool));
+
+	if (pthread_mutex_init(&pool->lock, 0) != 0) {
+		goto err_mutex;
+	} else if (pthread_cond_init(&pool->work, 0) != 0) {
+		goto err_work;
+	} else if (pthread_cond_init(&pool->done, 0) != 0) {
+		goto err_done;
+	}
+
+	// Any threads that fail to start just leave more work for the others,
+	// including the calling thread.
+	for (; pool->nthreads < ARRAY_LEN(pool->threads); ++pool->nthreads) {
+		if (pthread_create(&pool->threads[pool->nthreads], 0, fs_mtime_pool_worker, pool) != 0) {
+			break;
+		}
+	}
+
+	return pool;
+
+err_done:
+	pthread_cond_destroy(&pool->work);
+err_work:
+	pthread_mutex_destroy(&pool->lock);
+err_mutex:
+	z_free(pool);
+	return 0;
+}
+
+static void
+fs_mtime_pool_batch(struct fs_mtime_pool *pool, struct fs_mtime_batch_entry *entries, uint32_t len)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->entries = entries;
+	pool->len = len;
+	pool->next = 0;
+	pthread_cond_broadcast(&pool->work);
+
+	fs_mtime_pool_run(pool);
+	while (pool->busy) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+
+	pool->entries = 0;
+	pool->len = pool->next = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+#endif
+
+void
+fs_mtime_pool_destroy(struct fs_mtime_pool *pool)
+{
+#ifdef MUON_HAVE_THREADS
+	uint32_t i;
+
+	if (!pool) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->nthreads; ++i) {
+		pthread_join(pool->threads[i], 0);
+	}
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+	z_free(pool);
+#endif
+}
+
+void
+fs_mtime_batch(struct fs_mtime_pool **pool, struct fs_mtime_batch_entry *entries, uint32_t len)
+{
+	uint32_t i = 0;
+
+#ifdef MUON_HAVE_THREADS
+	if (len >= fs_mtime_batch_min_threaded) {
+		// Only hand the rest to the pool if the first chunk shows that
+		// the files aren't cached.
+		struct timer t;
+		timer_start(&t);
+		for (; i < fs_mtime_batch_chunk; ++i) {
+			entries[i].res = fs_mtime_nolog(entries[i].path, &entries[i].mtime);
+		}
+
+		if (timer_read_ns(&t) > fs_mtime_batch_chunk * fs_mtime_batch_slow_ns) {
+			if (!*pool) {
+				*pool = fs_mtime_pool_create();
+			}
+
+			if (*pool) {
+				fs_mtime_pool_batch(*pool, entries + i, len - i);
+				return;
+			}
+		}
+	}
+#else
+	(void)pool;
+#endif
+
+	for (; i < len; ++i) {
+		entries[i].res = fs_mtime_nolog(entries[i].path, &entries[i].mtime);
+	}
+}
+
 bool
 fs_exists(const char *path)
 {
@@ -354,6 +545,17 @@ fs_remove(const char *path)
 	return true;
 }
 
+bool
+fs_rename(const char *old_path, const char *new_path)
+{
+	if (rename(old_path, new_path) != 0) {
+		LOG_E("failed rename(\"%s\", \"%s\"): %s", old_path, new_path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 bool
 fs_make_symlink(const char *target, const char *path, bool force)
 {
@@ -521,10 +723,78 @@ fs_wait_for_input(int fd, uint32_t *bytes_available)
 			return false;
 		}
 
-		if (fds.revents & POLLIN) {
+		// POLLHUP without POLLIN means the other end has closed, let the
+		// subsequent read report eof.
+		if (fds.revents & (POLLIN | POLLHUP)) {
 			break;
 		}
 	}
 
 	return true;
 }
+
+bool
+fs_has_input(int fd)
+{
+	struct pollfd fds = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+
+	return poll(&fds, 1, 0) > 0 && (fds.revents & POLLIN);
+}
+
+bool
+fs_fd_is_regular_file(int fd)
+{
+	struct stat sb;
+	return fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode);
+}
+
+bool
+fs_map_file(const char *path, struct fs_mapped_file *map)
+{
+	struct stat sb;
+	void *data;
+	int fd;
+
+	*map = (struct fs_mapped_file){ .data = "" };
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		LOG_E("failed to open %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	if (fstat(fd, &sb) != 0) {
+		LOG_E("failed fstat(%s): %s", path, strerror(errno));
+		goto err;
+	}
+
+	if (!sb.st_size) {
+		close(fd);
+		return true;
+	}
+
+	if ((data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		LOG_E("failed to map %s: %s", path, strerror(errno));
+		goto err;
+	}
+
+	close(fd);
+	map->data = data;
+	map->len = sb.st_size;
+	return true;
+err:
+	close(fd);
+	return false;
+}
+
+void
+fs_unmap_file(struct fs_mapped_file *map)
+{
+	if (map->len && munmap((void *)map->data, map->len) != 0) {
+		LOG_E("failed to unmap file: %s", strerror(errno));
+	}
+
+	*map = (struct fs_mapped_file){ 0 };
+}
@@ -7,11 +7,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/wait.h>
-#include <time.h>
 #include <unistd.h>
 
 #include "error.h"
@@ -19,6 +20,7 @@
 #include "log.h"
 #include "platform/assert.h"
 #include "platform/filesystem.h"
+#include "platform/mem.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
 
@@ -32,12 +34,135 @@ enum copy_pipe_result {
 	copy_pipe_result_failed,
 };
 
+/*
+ * SIGCHLD self-pipe.  The signal handler writes a byte to the pipe so that
+ * run_cmd_wait_any can poll() on child exits alongside the child output
+ * pipes.
+ */
+static struct {
+	int fds[2];
+	bool initialized, failed;
+} sigchld_pipe;
+
+static void
+sigchld_handler(int signo)
+{
+	int saved_errno = errno;
+	char c = 0;
+	if (write(sigchld_pipe.fds[1], &c, 1) == -1) {
+		// The pipe is full, which is fine since there is already a
+		// pending wakeup.
+	}
+	errno = saved_errno;
+}
+
+static bool
+set_fd_flags(int fd)
+{
+	int flags;
+	if ((flags = fcntl(fd, F_GETFL)) == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+		return false;
+	} else if ((flags = fcntl(fd, F_GETFD)) == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+sigchld_pipe_init(void)
+{
+	if (sigchld_pipe.initialized) {
+		return true;
+	} else if (sigchld_pipe.failed) {
+		return false;
+	}
+
+	if (pipe(sigchld_pipe.fds) == -1) {
+		LOG_W("failed to create SIGCHLD pipe: %s", strerror(errno));
+		goto err;
+	}
+
+	if (!set_fd_flags(sigchld_pipe.fds[0]) || !set_fd_flags(sigchld_pipe.fds[1])) {
+		LOG_W("failed to set SIGCHLD pipe flags: %s", strerror(errno));
+		goto err;
+	}
+
+	struct sigaction act = {
+		.sa_flags = SA_RESTART | SA_NOCLDSTOP,
+		.sa_handler = sigchld_handler,
+	};
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGCHLD, &act, 0) == -1) {
+		LOG_W("failed to install SIGCHLD handler: %s", strerror(errno));
+		goto err;
+	}
+
+	sigchld_pipe.initialized = true;
+	return true;
+err:
+	sigchld_pipe.failed = true;
+	return false;
+}
+
+static void
+sigchld_pipe_drain(void)
+{
+	char buf[64];
+	while (read(sigchld_pipe.fds[0], buf, sizeof(buf)) > 0) {
+	}
+}
+
+void
+run_cmd_wait_any(struct workspace *wk, struct run_cmd_ctx *const *ctxs, uint32_t len, int32_t timeout_ms)
+{
+	uint32_t i, nfds = 0;
+	struct pollfd *fds = z_calloc(len * 2 + 1, sizeof(struct pollfd));
+
+	if (sigchld_pipe_init()) {
+		fds[nfds++] = (struct pollfd){ .fd = sigchld_pipe.fds[0], .events = POLLIN };
+	} else if (timeout_ms < 0 || timeout_ms > 1) {
+		// Without SIGCHLD notifications the only option is to poll
+		// for child exits.
+		timeout_ms = 1;
+	}
+
+	for (i = 0; i < len; ++i) {
+		const struct run_cmd_ctx *ctx = ctxs[i];
+		if (ctx->flags & run_cmd_ctx_flag_dont_capture) {
+			continue;
+		}
+
+		if (ctx->pipefd_out_open[0]) {
+			fds[nfds++] = (struct pollfd){ .fd = ctx->pipefd_out[0], .events = POLLIN };
+		}
+
+		if (ctx->pipefd_err_open[0]) {
+			fds[nfds++] = (struct pollfd){ .fd = ctx->pipefd_err[0], .events = POLLIN };
+		}
+	}
+
+	if (poll(fds, nfds, timeout_ms) == -1 && errno != EINTR) {
+		LOG_W("poll: %s", strerror(errno));
+	}
+
+	if (sigchld_pipe.initialized) {
+		sigchld_pipe_drain();
+	}
+
+	z_free(fds);
+}
+
 static enum copy_pipe_result
-copy_pipe(struct workspace *wk, int pipe, struct tstr *tstr, FILE *tee_out, bool process_is_dead)
+copy_pipe(struct workspace *wk, int pipe, bool *pipe_open, struct tstr *tstr, FILE *tee_out, bool process_is_dead)
 {
 	ssize_t b;
 	char buf[4096];
 
+	if (!*pipe_open) {
+		return copy_pipe_result_finished;
+	}
+
 	while (true) {
 		b = read(pipe, buf, sizeof(buf));
 
@@ -51,6 +176,12 @@ copy_pipe(struct workspace *wk, int pipe, struct tstr *tstr, FILE *tee_out, bool
 				return copy_pipe_result_failed;
 			}
 		} else if (b == 0) {
+			// Close the read end on EOF so that it is no longer
+			// polled by run_cmd_wait_any.
+			if (close(pipe) == -1) {
+				LOG_E("failed to close: %s", strerror(errno));
+			}
+			*pipe_open = false;
 			return copy_pipe_result_finished;
 		}
 
@@ -69,11 +200,17 @@ copy_pipes(struct workspace *wk, struct run_cmd_ctx *ctx, bool process_is_dead)
 
 	bool tee = ctx->flags & run_cmd_ctx_flag_tee;
 
-	if ((res = copy_pipe(wk, ctx->pipefd_out[0], &ctx->out, tee ? stdout : 0, process_is_dead)) == copy_pipe_result_failed) {
+	if ((res = copy_pipe(wk,
+		     ctx->pipefd_out[0],
+		     &ctx->pipefd_out_open[0],
+		     &ctx->out,
+		     tee ? stdout : 0,
+		     process_is_dead))
+		== copy_pipe_result_failed) {
 		return res;
 	}
 
-	switch (copy_pipe(wk, ctx->pipefd_err[0], &ctx->err, tee ? stderr : 0, process_is_dead)) {
+	switch (copy_pipe(wk, ctx->pipefd_err[0], &ctx->pipefd_err_open[0], &ctx->err, tee ? stderr : 0, process_is_dead)) {
 	case copy_pipe_result_waiting: return copy_pipe_result_waiting;
 	case copy_pipe_result_finished: return res;
 	case copy_pipe_result_failed: return copy_pipe_result_failed;
@@ -131,12 +268,9 @@ run_cmd_collect(struct workspace *wk, struct run_cmd_ctx *ctx)
 			if (ctx->flags & run_cmd_ctx_flag_async) {
 				return run_cmd_running;
 			} else {
-				// sleep here for 1ms to give the process some
-				// time to complete
-				struct timespec req = {
-					.tv_nsec = 1000000,
-				};
-				nanosleep(&req, NULL);
+				// block until the process either writes
+				// something or exits
+				run_cmd_wait_any(wk, &ctx, 1, -1);
 			}
 		} else {
 			break;
@@ -199,75 +333,123 @@ open_run_cmd_pipe(int fds[2], bool fds_open[2])
 	return true;
 }
 
-static bool
-run_cmd_internal(struct workspace *wk, struct run_cmd_ctx *ctx, const char *_cmd, char *const *argv, const char *envstr, uint32_t envc)
+/*
+ * Returns environ with the envc key/value pairs in envstr added, replacing
+ * existing variables of the same name.
+ */
+static char *const *
+run_cmd_make_envp(struct workspace *wk, const char *envstr, uint32_t envc)
 {
-	const char *p;
-	TSTR(cmd);
+	const char **envp, *k, *v, *other;
+	uint32_t i, j, n, len = 0;
 
-	if (!fs_find_cmd(wk, &cmd, _cmd)) {
-		L("failed to run command '%s': not found", _cmd);
-		ctx->err_msg = "command not found";
-		return false;
+	if (!envstr) {
+		return environ;
 	}
 
-	{
-		LL("executing %s:", cmd.buf);
-		char *const *ap;
+	for (n = 0; environ[n]; ++n) {
+	}
 
-		for (ap = argv; *ap; ++ap) {
-			log_plain(log_debug, " '%s'", *ap);
+	envp = ar_maken(wk->a_scratch, const char *, n + envc + 1);
+
+	for (i = 0; i < n; ++i) {
+		const char *eq = strchr(environ[i], '=');
+		uint32_t klen = eq ? (uint32_t)(eq - environ[i]) : strlen(environ[i]);
+
+		for (j = 0, k = envstr; j < envc; ++j) {
+			if (strlen(k) == klen && memcmp(k, environ[i], klen) == 0) {
+				break;
+			}
+			k += strlen(k) + 1;
+			k += strlen(k) + 1;
 		}
-		log_plain(log_debug, "\n");
 
-		if (envstr) {
-			const char *k;
-			uint32_t i = 0;
-			LL("env:");
-			p = k = envstr;
-			for (; envc; ++p) {
-				if (!p[0]) {
-					if (!k) {
-						k = p + 1;
-					} else {
-						log_plain(log_debug, " %s='%s'", k, p + 1);
-						k = NULL;
+		if (j == envc) {
+			envp[len++] = environ[i];
+		}
+	}
 
-						if (++i >= envc) {
-							break;
-						}
-					}
-				}
+	for (i = 0, k = envstr; i < envc; ++i, k = v + strlen(v) + 1) {
+		v = k + strlen(k) + 1;
+
+		// Like setenv, a later value for the same key wins.
+		for (j = i + 1, other = v + strlen(v) + 1; j < envc; ++j) {
+			if (strcmp(other, k) == 0) {
+				break;
 			}
+			other += strlen(other) + 1;
+			other += strlen(other) + 1;
+		}
 
-			log_plain(log_debug, "\n");
+		if (j < envc) {
+			continue;
 		}
+
+		uint32_t klen = strlen(k), vlen = strlen(v);
+		char *kv = ar_maken(wk->a_scratch, char, klen + vlen + 2);
+		memcpy(kv, k, klen);
+		kv[klen] = '=';
+		memcpy(kv + klen + 1, v, vlen + 1);
+		envp[len++] = kv;
 	}
 
-	if (!ctx->stdin_path) {
-		ctx->stdin_path = "/dev/null";
+	envp[len] = 0;
+	return (char *const *)envp;
+}
+
+/*
+ * Start the child with posix_spawn.  Unlike fork, this doesn't need to copy
+ * the page tables of muon, which can be large after configuring a big
+ * project.
+ */
+static bool
+run_cmd_spawn(struct workspace *wk, struct run_cmd_ctx *ctx, const char *cmd, char *const *argv, const char *envstr, uint32_t envc)
+{
+	posix_spawn_file_actions_t actions;
+	pid_t pid;
+	int err;
+
+	if ((err = posix_spawn_file_actions_init(&actions)) != 0) {
+		LOG_E("failed to initialize spawn file actions: %s", strerror(err));
+		return false;
 	}
 
-	ctx->input_fd = open(ctx->stdin_path, O_RDONLY);
-	if (ctx->input_fd == -1) {
-		LOG_E("failed to open %s: %s", ctx->stdin_path, strerror(errno));
-		goto err;
+	if ((err = posix_spawn_file_actions_adddup2(&actions, ctx->input_fd, 0)) != 0) {
+		goto actions_err;
 	}
-	ctx->input_fd_open = true;
 
 	if (!(ctx->flags & run_cmd_ctx_flag_dont_capture)) {
-		tstr_init(&ctx->out, 0);
-		tstr_init(&ctx->err, 0);
-
-		if (!open_run_cmd_pipe(ctx->pipefd_out, ctx->pipefd_out_open)) {
-			goto err;
-		} else if (!open_run_cmd_pipe(ctx->pipefd_err, ctx->pipefd_err_open)) {
-			goto err;
+		if ((err = posix_spawn_file_actions_adddup2(&actions, ctx->pipefd_out[1], 1)) != 0
+			|| (err = posix_spawn_file_actions_adddup2(&actions, ctx->pipefd_err[1], 2)) != 0) {
+			goto actions_err;
 		}
 	}
 
+	err = posix_spawn(&pid, cmd, &actions, 0, argv, run_cmd_make_envp(wk, envstr, envc));
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (err != 0) {
+		LOG_E("%s: %s", cmd, strerror(err));
+		ctx->err_msg = "command failed to execute";
+		return false;
+	}
+
+	ctx->pid = pid;
+	return true;
+
+actions_err:
+	LOG_E("failed to set up spawn file actions: %s", strerror(err));
+	posix_spawn_file_actions_destroy(&actions);
+	return false;
+}
+
+static bool
+run_cmd_fork(struct run_cmd_ctx *ctx, const char *cmd, char *const *argv, const char *envstr, uint32_t envc)
+{
+	const char *p;
+
 	if ((ctx->pid = fork()) == -1) {
-		goto err;
+		return false;
 	} else if (ctx->pid == 0 /* child */) {
 		if (ctx->chdir) {
 			if (chdir(ctx->chdir) == -1) {
@@ -321,14 +503,97 @@ run_cmd_internal(struct workspace *wk, struct run_cmd_ctx *ctx, const char *_cmd
 			}
 		}
 
-		if (execve(cmd.buf, (char *const *)argv, environ) == -1) {
-			LOG_E("%s: %s", cmd.buf, strerror(errno));
+		if (execve(cmd, (char *const *)argv, environ) == -1) {
+			LOG_E("%s: %s", cmd, strerror(errno));
 			exit(fail_to_exec_exit_code);
 		}
 
 		abort();
 	}
 
+	return true;
+}
+
+static bool
+run_cmd_internal(struct workspace *wk, struct run_cmd_ctx *ctx, const char *_cmd, char *const *argv, const char *envstr, uint32_t envc)
+{
+	const char *p;
+	TSTR(cmd);
+
+	if (!fs_find_cmd(wk, &cmd, _cmd)) {
+		L("failed to run command '%s': not found", _cmd);
+		ctx->err_msg = "command not found";
+		return false;
+	}
+
+	{
+		LL("executing %s:", cmd.buf);
+		char *const *ap;
+
+		for (ap = argv; *ap; ++ap) {
+			log_plain(log_debug, " '%s'", *ap);
+		}
+		log_plain(log_debug, "\n");
+
+		if (envstr) {
+			const char *k;
+			uint32_t i = 0;
+			LL("env:");
+			p = k = envstr;
+			for (; envc; ++p) {
+				if (!p[0]) {
+					if (!k) {
+						k = p + 1;
+					} else {
+						log_plain(log_debug, " %s='%s'", k, p + 1);
+						k = NULL;
+
+						if (++i >= envc) {
+							break;
+						}
+					}
+				}
+			}
+
+			log_plain(log_debug, "\n");
+		}
+	}
+
+	if (!ctx->stdin_path) {
+		ctx->stdin_path = "/dev/null";
+	}
+
+	ctx->input_fd = open(ctx->stdin_path, O_RDONLY);
+	if (ctx->input_fd == -1) {
+		LOG_E("failed to open %s: %s", ctx->stdin_path, strerror(errno));
+		goto err;
+	}
+	ctx->input_fd_open = true;
+
+	if (!(ctx->flags & run_cmd_ctx_flag_dont_capture)) {
+		tstr_init(&ctx->out, 0);
+		tstr_init(&ctx->err, 0);
+
+		if (!open_run_cmd_pipe(ctx->pipefd_out, ctx->pipefd_out_open)) {
+			goto err;
+		} else if (!open_run_cmd_pipe(ctx->pipefd_err, ctx->pipefd_err_open)) {
+			goto err;
+		}
+	}
+
+	// The SIGCHLD handler must be installed before the child is created so
+	// that its exit can't be missed.
+	sigchld_pipe_init();
+
+	if (ctx->chdir) {
+		// posix_spawn can't portably change the child's working directory
+		if (!run_cmd_fork(ctx, cmd.buf, argv, envstr, envc)) {
+			goto err;
+		}
+	} else if (!run_cmd_spawn(wk, ctx, cmd.buf, argv, envstr, envc)) {
+		goto err;
+	}
+
 	/* parent */
 	if (ctx->pipefd_err_open[1] && close(ctx->pipefd_err[1]) == -1) {
 		LOG_E("failed to close: %s", strerror(errno));
@@ -55,6 +55,30 @@ timer_read(struct timer *t)
 #endif
 }
 
+uint64_t
+timer_read_ns(struct timer *t)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec end;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &end) == -1) {
+		LOG_E("clock_gettime: %s", strerror(errno));
+		return 0;
+	}
+
+	return (uint64_t)(end.tv_sec - t->start.tv_sec) * 1000000000ull + end.tv_nsec - t->start.tv_nsec;
+#else
+	struct timeval end;
+
+	if (gettimeofday(&end, NULL) == -1) {
+		LOG_E("gettimeofday: %s", strerror(errno));
+		return 0;
+	}
+
+	return ((uint64_t)(end.tv_sec - t->start.tv_sec) * 1000000ull + end.tv_usec - t->start.tv_usec) * 1000ull;
+#endif
+}
+
 void
 timer_sleep(uint64_t nanoseconds)
 {
@@ -624,6 +624,24 @@ fs_mtime(const char *path, int64_t *mtime)
 	return fs_mtime_result_ok;
 }
 
+void
+fs_mtime_batch(struct fs_mtime_pool **pool, struct fs_mtime_batch_entry *entries, uint32_t len)
+{
+	uint32_t i;
+
+	(void)pool;
+
+	for (i = 0; i < len; ++i) {
+		entries[i].res = fs_mtime(entries[i].path, &entries[i].mtime);
+	}
+}
+
+void
+fs_mtime_pool_destroy(struct fs_mtime_pool *pool)
+{
+	(void)pool;
+}
+
 bool
 fs_remove(const char *path)
 {
@@ -644,6 +662,17 @@ fs_remove(const char *path)
 	return true;
 }
 
+bool
+fs_rename(const char *old_path, const char *new_path)
+{
+	if (!MoveFileExA(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
+		LOG_E("failed MoveFileEx(\"%s\", \"%s\"): %s", old_path, new_path, win32_error());
+		return false;
+	}
+
+	return true;
+}
+
 FILE *
 fs_make_tmp_file(const char *name, const char *suffix, char *buf, uint32_t len)
 {
@@ -704,3 +733,91 @@ fs_wait_for_input(int fd, uint32_t *bytes_available)
 
 	return true;
 }
+
+bool
+fs_has_input(int fd)
+{
+	intptr_t _h = _get_osfhandle(fd);
+	if (_h == -2 || (HANDLE)_h == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	HANDLE h = (HANDLE)_h;
+
+	DWORD dwBytesAvailable;
+	if (GetFileType(h) != FILE_TYPE_PIPE || !PeekNamedPipe(h, NULL, 0, NULL, &dwBytesAvailable, NULL)) {
+		return false;
+	}
+
+	return dwBytesAvailable > 0;
+}
+
+bool
+fs_fd_is_regular_file(int fd)
+{
+	intptr_t _h = _get_osfhandle(fd);
+	if (_h == -2 || (HANDLE)_h == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	return GetFileType((HANDLE)_h) == FILE_TYPE_DISK;
+}
+
+bool
+fs_map_file(const char *path, struct fs_mapped_file *map)
+{
+	HANDLE h, fm;
+	LARGE_INTEGER size;
+	void *data;
+
+	*map = (struct fs_mapped_file){ .data = "" };
+
+	h = CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (h == INVALID_HANDLE_VALUE) {
+		LOG_E("failed to open %s: %s", path, win32_error());
+		return false;
+	}
+
+	if (!GetFileSizeEx(h, &size)) {
+		LOG_E("failed to get size of %s: %s", path, win32_error());
+		goto close_file;
+	}
+
+	if (!size.QuadPart) {
+		CloseHandle(h);
+		return true;
+	}
+
+	fm = CreateFileMapping(h, NULL, PAGE_READONLY, 0UL, 0UL, NULL);
+	if (!fm) {
+		LOG_E("failed to map %s: %s", path, win32_error());
+		goto close_file;
+	}
+
+	data = MapViewOfFile(fm, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		LOG_E("failed to view mapping of %s: %s", path, win32_error());
+		CloseHandle(fm);
+		goto close_file;
+	}
+
+	CloseHandle(h);
+	map->data = data;
+	map->len = size.QuadPart;
+	map->handle = fm;
+	return true;
+
+close_file:
+	CloseHandle(h);
+	return false;
+}
+
+void
+fs_unmap_file(struct fs_mapped_file *map)
+{
+	if (map->len) {
+		UnmapViewOfFile(map->data);
+		CloseHandle(map->handle);
+	}
+
+	*map = (struct fs_mapped_file){ 0 };
+}
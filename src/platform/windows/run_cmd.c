@@ -231,6 +231,42 @@ run_cmd_collect(struct workspace *wk, struct run_cmd_ctx *ctx)
 	return run_cmd_finished;
 }
 
+void
+run_cmd_wait_any(struct workspace *wk, struct run_cmd_ctx *const *ctxs, uint32_t len, int32_t timeout_ms)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	uint32_t i, n = 0;
+
+	for (i = 0; i < len && n < ARRAY_LEN(handles); ++i) {
+		if (ctxs[i]->process && ctxs[i]->process != INVALID_HANDLE_VALUE) {
+			handles[n++] = ctxs[i]->process;
+		}
+	}
+
+	// Captured output is drained through per-command completion ports
+	// which can't be waited on alongside process handles, so keep the
+	// wait short while any command is capturing output.
+	bool capturing = false;
+	for (i = 0; i < len; ++i) {
+		if (!(ctxs[i]->flags & run_cmd_ctx_flag_dont_capture)) {
+			capturing = true;
+			break;
+		}
+	}
+
+	DWORD timeout = timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms;
+	if (capturing && (timeout == INFINITE || timeout > 1)) {
+		timeout = 1;
+	}
+
+	if (!n) {
+		Sleep(timeout == INFINITE ? 1 : timeout);
+		return;
+	}
+
+	WaitForMultipleObjects(n, handles, FALSE, timeout);
+}
+
 static bool
 open_pipes(struct run_cmd_ctx *ctx, struct win_pipe_inst *pipe, const char *name)
 {
@@ -24,6 +24,16 @@ timer_read(struct timer *t)
 	return (float)(end.QuadPart - t->start.QuadPart) / (float)t->freq.QuadPart;
 }
 
+uint64_t
+timer_read_ns(struct timer *t)
+{
+	LARGE_INTEGER end;
+
+	QueryPerformanceCounter(&end);
+	uint64_t ticks = end.QuadPart - t->start.QuadPart, freq = t->freq.QuadPart;
+	return (ticks / freq) * 1000000000ull + (ticks % freq) * 1000000000ull / freq;
+}
+
 void
 timer_sleep(uint64_t nanoseconds)
 {
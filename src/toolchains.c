@@ -28,11 +28,67 @@
 #include "machines.h"
 #include "options.h"
 #include "platform/assert.h"
+#include "platform/filesystem.h"
+#include "platform/os.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
 #include "sha_256.h"
 #include "toolchains.h"
 
+static bool user_compiler_check_cache_enabled(struct workspace *wk);
+
+/*
+ * Hashes everything that identifies the tool being run beyond its arguments:
+ * the resolved path and mtime of argv0 and, for compilers, the configured
+ * sys_root.  This keeps cached results valid when the cache outlives the
+ * build directory.  The result is memoized per argv0 and machine.
+ */
+static void
+compiler_check_cache_key_ident(struct workspace *wk, const struct compiler_check_cache_key *key, uint8_t sha[32])
+{
+	TSTR(id);
+	if (key->argc) {
+		tstr_pushs(wk, &id, key->argstr);
+	}
+	if (key->comp) {
+		tstr_pushf(wk, &id, "\n%d", key->comp->machine);
+	}
+
+	obj memo;
+	if (obj_dict_index_strn(wk, wk->user_compiler_check_cache.idents, id.buf, id.len, &memo)) {
+		memcpy(sha, get_str(wk, memo)->s, 32);
+		return;
+	}
+
+	TSTR(ident);
+
+	if (key->argc && *key->argstr) {
+		TSTR(exe);
+		if (fs_find_cmd(wk, &exe, key->argstr)) {
+			tstr_pushs(wk, &ident, exe.buf);
+
+			int64_t mtime;
+			if (fs_mtime(exe.buf, &mtime) == fs_mtime_result_ok) {
+				tstr_pushf(wk, &ident, "\n%" PRId64, mtime);
+			}
+		} else {
+			tstr_pushs(wk, &ident, key->argstr);
+		}
+	}
+
+	if (key->comp) {
+		obj sys_root;
+		if (obj_dict_index_str(wk, wk->machine_properties[key->comp->machine], "sys_root", &sys_root)
+			&& get_obj_type(wk, sys_root) == obj_string) {
+			tstr_pushf(wk, &ident, "\nsys_root:%s", get_cstr(wk, sys_root));
+		}
+	}
+
+	calc_sha_256(sha, ident.buf, ident.len);
+
+	obj_dict_set(wk, wk->user_compiler_check_cache.idents, tstr_into_str(wk, &id), make_strn(wk, (const char *)sha, 32));
+}
+
 obj
 compiler_check_cache_key(struct workspace *wk, const struct compiler_check_cache_key *key)
 {
@@ -55,12 +111,34 @@ compiler_check_cache_key(struct workspace *wk, const struct compiler_check_cache
 		sha_idx_argstr = 0,
 		sha_idx_ver = sha_idx_argstr + 32,
 		sha_idx_src = sha_idx_ver + 32,
-		sha_data_len = sha_idx_src + 32
+		sha_idx_ident = sha_idx_src + 32,
+		sha_idx_src_contents = sha_idx_ident + 32,
+		sha_data_len = sha_idx_src_contents + 32
 	};
 
 	uint8_t sha_data[sha_data_len] = { 0 };
 
-	calc_sha_256(&sha_data[sha_idx_argstr], key->argstr, argstr_len);
+	if (user_compiler_check_cache_enabled(wk)) {
+		// Arguments that point into the build directory, e.g. the path to
+		// the check's source file, are normalized so that keys are
+		// identical across build directories.
+		TSTR(argstr);
+		uint32_t i, build_root_len = wk->build_root ? strlen(wk->build_root) : 0;
+		for (i = 0; i < argstr_len;) {
+			if (build_root_len && argstr_len - i >= build_root_len
+				&& memcmp(&key->argstr[i], wk->build_root, build_root_len) == 0) {
+				tstr_pushs(wk, &argstr, "@BUILD_ROOT@");
+				i += build_root_len;
+			} else {
+				tstr_push(wk, &argstr, key->argstr[i]);
+				++i;
+			}
+		}
+
+		calc_sha_256(&sha_data[sha_idx_argstr], argstr.buf, argstr.len);
+	} else {
+		calc_sha_256(&sha_data[sha_idx_argstr], key->argstr, argstr_len);
+	}
 	if (key->comp && key->comp->ver[toolchain_component_compiler]) {
 		const struct str *ver = get_str(wk, key->comp->ver[toolchain_component_compiler]);
 		calc_sha_256(&sha_data[sha_idx_ver], ver->s, ver->len);
@@ -68,6 +146,17 @@ compiler_check_cache_key(struct workspace *wk, const struct compiler_check_cache
 	if (key->src) {
 		calc_sha_256(&sha_data[sha_idx_src], key->src, strlen(key->src));
 	}
+	if (user_compiler_check_cache_enabled(wk)) {
+		compiler_check_cache_key_ident(wk, key, &sha_data[sha_idx_ident]);
+
+		// A source file may be edited without its path changing, which
+		// matters once results outlive the build directory.
+		struct fs_mapped_file map;
+		if (key->src_is_path && fs_map_file(key->src, &map)) {
+			calc_sha_256(&sha_data[sha_idx_src_contents], map.data, map.len);
+			fs_unmap_file(&map);
+		}
+	}
 
 	uint8_t sha[32];
 	calc_sha_256(sha, sha_data, sha_data_len);
@@ -82,19 +171,397 @@ compiler_check_cache_key(struct workspace *wk, const struct compiler_check_cache
 	return make_strn(wk, (const char *)sha, 32);
 }
 
+/*
+ * User-level compiler check cache
+ *
+ * When the option muon.user_compiler_check_cache is enabled, compiler check
+ * results are additionally stored in $XDG_CACHE_HOME/muon so that they can be
+ * shared between build directories.
+ *
+ * The cache file is a sequence of self-delimiting records:
+ *
+ *   u32 magic, u32 payload length, u32 payload checksum,
+ *   payload: 32 byte key, u8 success, encoded value
+ *
+ * New records are only ever appended with a single write to a file opened in
+ * append mode, so concurrent setups can share the file without locking.
+ * Records that are truncated or fail their checksum are ignored.  When the
+ * file grows beyond user_compiler_check_cache_max_size it is compacted to
+ * the most recently written half by writing a new file and renaming it over
+ * the old one.  Records appended by other processes while compacting are
+ * copied over before the rename, which is only done once the file has stopped
+ * growing.
+ *
+ * Loaded records are kept apart from the build directory's cache, and a key is
+ * only copied into it when this build uses it.
+ */
+
+enum {
+	user_compiler_check_cache_magic = 0x6363756d, // "mucc"
+	user_compiler_check_cache_max_size = 16 * 1024 * 1024,
+};
+
+enum user_compiler_check_cache_tag {
+	user_compiler_check_cache_tag_null = 'z',
+	user_compiler_check_cache_tag_bool = 'b',
+	user_compiler_check_cache_tag_number = 'n',
+	user_compiler_check_cache_tag_string = 's',
+	user_compiler_check_cache_tag_array = 'a',
+};
+
+static uint32_t
+user_compiler_check_cache_checksum(const uint8_t *buf, uint32_t len)
+{
+	uint32_t i, h = 2166136261u;
+	for (i = 0; i < len; ++i) {
+		h = (h ^ buf[i]) * 16777619u;
+	}
+	return h;
+}
+
+static void
+user_compiler_check_cache_push_u32(struct workspace *wk, struct tstr *buf, uint32_t v)
+{
+	tstr_pushn(wk, buf, (const char *)&v, sizeof(v));
+}
+
+static bool
+user_compiler_check_cache_encode(struct workspace *wk, struct tstr *buf, obj v)
+{
+	if (!v) {
+		tstr_push(wk, buf, user_compiler_check_cache_tag_null);
+		return true;
+	}
+
+	switch (get_obj_type(wk, v)) {
+	case obj_bool:
+		tstr_push(wk, buf, user_compiler_check_cache_tag_bool);
+		tstr_push(wk, buf, get_obj_bool(wk, v));
+		return true;
+	case obj_number: {
+		int64_t n = get_obj_number(wk, v);
+		tstr_push(wk, buf, user_compiler_check_cache_tag_number);
+		tstr_pushn(wk, buf, (const char *)&n, sizeof(n));
+		return true;
+	}
+	case obj_string: {
+		const struct str *str = get_str(wk, v);
+		tstr_push(wk, buf, user_compiler_check_cache_tag_string);
+		user_compiler_check_cache_push_u32(wk, buf, str->len);
+		tstr_pushn(wk, buf, str->s, str->len);
+		return true;
+	}
+	case obj_array: {
+		tstr_push(wk, buf, user_compiler_check_cache_tag_array);
+		user_compiler_check_cache_push_u32(wk, buf, get_obj_array(wk, v)->len);
+
+		obj e;
+		obj_array_for(wk, v, e) {
+			if (!user_compiler_check_cache_encode(wk, buf, e)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	default: return false;
+	}
+}
+
+struct user_compiler_check_cache_reader {
+	const uint8_t *buf;
+	uint32_t len, i;
+};
+
+static bool
+user_compiler_check_cache_read(struct user_compiler_check_cache_reader *r, void *dest, uint32_t len)
+{
+	if (len > r->len - r->i) {
+		return false;
+	}
+
+	memcpy(dest, &r->buf[r->i], len);
+	r->i += len;
+	return true;
+}
+
+static bool
+user_compiler_check_cache_decode(struct workspace *wk, struct user_compiler_check_cache_reader *r, obj *res)
+{
+	uint8_t tag;
+	if (!user_compiler_check_cache_read(r, &tag, 1)) {
+		return false;
+	}
+
+	switch ((enum user_compiler_check_cache_tag)tag) {
+	case user_compiler_check_cache_tag_null: *res = 0; return true;
+	case user_compiler_check_cache_tag_bool: {
+		uint8_t b;
+		if (!user_compiler_check_cache_read(r, &b, 1)) {
+			return false;
+		}
+		*res = make_obj_bool(wk, b);
+		return true;
+	}
+	case user_compiler_check_cache_tag_number: {
+		int64_t n;
+		if (!user_compiler_check_cache_read(r, &n, sizeof(n))) {
+			return false;
+		}
+		*res = make_number(wk, n);
+		return true;
+	}
+	case user_compiler_check_cache_tag_string: {
+		uint32_t len;
+		if (!user_compiler_check_cache_read(r, &len, sizeof(len)) || len > r->len - r->i) {
+			return false;
+		}
+		*res = make_strn(wk, (const char *)&r->buf[r->i], len);
+		r->i += len;
+		return true;
+	}
+	case user_compiler_check_cache_tag_array: {
+		uint32_t i, len;
+		if (!user_compiler_check_cache_read(r, &len, sizeof(len))) {
+			return false;
+		}
+
+		*res = make_obj(wk, obj_array);
+		for (i = 0; i < len; ++i) {
+			obj e;
+			if (!user_compiler_check_cache_decode(wk, r, &e)) {
+				return false;
+			}
+			obj_array_push(wk, *res, e);
+		}
+		return true;
+	}
+	}
+
+	return false;
+}
+
+struct user_compiler_check_cache_record {
+	uint32_t off, len;
+	obj key;
+};
+
+static void
+user_compiler_check_cache_compact(struct workspace *wk, const struct source *src, struct arr *records)
+{
+	// Keep the newest records, walking backwards so that only the last
+	// write of each key is kept.
+	obj seen = make_obj(wk, obj_dict);
+	uint32_t i, kept_size = 0;
+	struct arr kept;
+	arr_init(wk->a_scratch, &kept, records->len, uint32_t);
+
+	for (i = records->len; i > 0; --i) {
+		struct user_compiler_check_cache_record *rec = arr_get(records, i - 1);
+		obj _;
+		if (obj_dict_index(wk, seen, rec->key, &_)) {
+			continue;
+		} else if (kept_size + rec->len > user_compiler_check_cache_max_size / 2) {
+			break;
+		}
+
+		obj_dict_set(wk, seen, rec->key, obj_bool_true);
+		kept_size += rec->len;
+		uint32_t idx = i - 1;
+		arr_push(wk->a_scratch, &kept, &idx);
+	}
+
+	TSTR(buf);
+	for (i = kept.len; i > 0; --i) {
+		struct user_compiler_check_cache_record *rec
+			= arr_get(records, *(uint32_t *)arr_get(&kept, i - 1));
+		tstr_pushn(wk, &buf, &src->src[rec->off], rec->len);
+	}
+
+	TSTR(tmp);
+	tstr_pushf(wk, &tmp, "%s.%d.tmp", wk->user_compiler_check_cache.path, os_get_pid());
+
+	// Other processes may have appended records since the file was read.
+	// Copy them over and only rename once the file has stopped growing.
+	// Giving up just means compaction is retried by the next setup.
+	uint64_t copied = src->len;
+	for (i = 0; i < 4; ++i) {
+		FILE *f;
+		uint64_t size;
+		if (!(f = fs_fopen(wk->user_compiler_check_cache.path, "rb"))) {
+			break;
+		} else if (!fs_fsize(f, &size) || size < copied || fseek(f, copied, SEEK_SET) != 0) {
+			// The file shrank, someone else compacted it.
+			fs_fclose(f);
+			break;
+		}
+
+		if (size > copied) {
+			uint32_t len = size - copied;
+			tstr_grow(wk, &buf, len);
+			if (!fs_fread(&buf.buf[buf.len], len, f)) {
+				fs_fclose(f);
+				break;
+			}
+			buf.len += len;
+			copied = size;
+		}
+		fs_fclose(f);
+
+		if (!fs_write_entire_file(tmp.buf, (const uint8_t *)buf.buf, buf.len)) {
+			return;
+		}
+
+		struct stat sb;
+		if (!fs_stat(wk->user_compiler_check_cache.path, &sb) || (uint64_t)sb.st_size != copied) {
+			continue;
+		}
+
+		if (!fs_rename(tmp.buf, wk->user_compiler_check_cache.path)) {
+			break;
+		}
+
+		L("compacted user compiler check cache from %" PRIu64 " to %d bytes", copied, buf.len);
+		return;
+	}
+
+	fs_remove(tmp.buf);
+}
+
+static void
+user_compiler_check_cache_load(struct workspace *wk)
+{
+	struct source src = { 0 };
+	if (!fs_file_exists(wk->user_compiler_check_cache.path)) {
+		return;
+	} else if (!fs_read_entire_file(wk->a_scratch, wk->user_compiler_check_cache.path, &src)) {
+		return;
+	}
+
+	struct arr records;
+	arr_init(wk->a_scratch, &records, 64, struct user_compiler_check_cache_record);
+
+	struct user_compiler_check_cache_reader r = { .buf = (const uint8_t *)src.src, .len = src.len };
+	while (r.i < r.len) {
+		uint32_t start = r.i, header[3];
+		if (!user_compiler_check_cache_read(&r, header, sizeof(header))) {
+			break;
+		}
+
+		// A record that is torn or corrupt is skipped by resynchronizing
+		// on the next occurrence of the magic number.
+		if (header[0] != user_compiler_check_cache_magic || header[1] > r.len - r.i
+			|| user_compiler_check_cache_checksum(&r.buf[r.i], header[1]) != header[2]) {
+			r.i = start + 1;
+			continue;
+		}
+
+		struct user_compiler_check_cache_reader payload = { .buf = &r.buf[r.i], .len = header[1] };
+		r.i += header[1];
+
+		char key[32];
+		uint8_t success;
+		obj value;
+
+		if (!user_compiler_check_cache_read(&payload, key, sizeof(key))
+			|| !user_compiler_check_cache_read(&payload, &success, 1)
+			|| !user_compiler_check_cache_decode(wk, &payload, &value)) {
+			continue;
+		}
+
+		obj k = make_strn(wk, key, sizeof(key));
+
+		obj arr = make_obj(wk, obj_array);
+		obj_array_push(wk, arr, make_obj_bool(wk, success));
+		obj_array_push(wk, arr, value);
+		obj_dict_set(wk, wk->user_compiler_check_cache.entries, k, arr);
+
+		arr_push(wk->a_scratch,
+			&records,
+			&(struct user_compiler_check_cache_record){ .off = start, .len = r.i - start, .key = k });
+	}
+
+	if (src.len > user_compiler_check_cache_max_size) {
+		user_compiler_check_cache_compact(wk, &src, &records);
+	}
+}
+
+static bool
+user_compiler_check_cache_enabled(struct workspace *wk)
+{
+	if (wk->user_compiler_check_cache.initialized) {
+		return !!wk->user_compiler_check_cache.path;
+	}
+
+	wk->user_compiler_check_cache.initialized = true;
+
+	obj opt;
+	if (!wk->global_opts || !get_option(wk, 0, &STR("muon.user_compiler_check_cache"), &opt)
+		|| !get_obj_bool(wk, get_obj_option(wk, opt)->val)) {
+		return false;
+	}
+
+	TSTR(path);
+	if (!fs_path_xdg_home(wk, fs_path_xdg_type_cache, fs_path_xdg_flag_mkdir, &path)) {
+		LOG_W("unable to create user cache directory, the user compiler check cache is disabled");
+		return false;
+	}
+
+	path_push(wk, &path, "compiler_check_cache");
+	wk->user_compiler_check_cache.path = get_cstr(wk, tstr_into_str(wk, &path));
+	wk->user_compiler_check_cache.idents = make_obj(wk, obj_dict);
+	wk->user_compiler_check_cache.entries = make_obj(wk, obj_dict);
+
+	user_compiler_check_cache_load(wk);
+	return true;
+}
+
+static void
+user_compiler_check_cache_append(struct workspace *wk, obj key, const struct compiler_check_cache_value *val)
+{
+	TSTR(payload);
+	const struct str *k = get_str(wk, key);
+	assert(k->len == 32);
+	tstr_pushn(wk, &payload, k->s, k->len);
+	tstr_push(wk, &payload, val->success);
+	if (!user_compiler_check_cache_encode(wk, &payload, val->value)) {
+		return;
+	}
+
+	TSTR(buf);
+	user_compiler_check_cache_push_u32(wk, &buf, user_compiler_check_cache_magic);
+	user_compiler_check_cache_push_u32(wk, &buf, payload.len);
+	user_compiler_check_cache_push_u32(
+		wk, &buf, user_compiler_check_cache_checksum((const uint8_t *)payload.buf, payload.len));
+	tstr_pushn(wk, &buf, payload.buf, payload.len);
+
+	FILE *f;
+	if (!(f = fs_fopen(wk->user_compiler_check_cache.path, "ab"))) {
+		return;
+	}
+
+	// Make sure the record is written with a single write()
+	setvbuf(f, 0, _IONBF, 0);
+	fs_fwrite(buf.buf, buf.len, f);
+	fs_fclose(f);
+}
+
 bool
 compiler_check_cache_get(struct workspace *wk, obj key, struct compiler_check_cache_value *val)
 {
 	obj arr;
-	if (obj_dict_index(wk, wk->compiler_check_cache, key, &arr)) {
-		obj cache_res;
-		cache_res = obj_array_index(wk, arr, 0);
-		val->success = get_obj_bool(wk, cache_res);
-		val->value = obj_array_index(wk, arr, 1);
-		return true;
-	} else {
-		return false;
+	if (!obj_dict_index(wk, wk->compiler_check_cache, key, &arr)) {
+		if (!user_compiler_check_cache_enabled(wk)
+			|| !obj_dict_index(wk, wk->user_compiler_check_cache.entries, key, &arr)) {
+			return false;
+		}
+
+		// Only keys used by this build are persisted in its cache.
+		obj_dict_set(wk, wk->compiler_check_cache, key, arr);
 	}
+
+	val->success = get_obj_bool(wk, obj_array_index(wk, arr, 0));
+	val->value = obj_array_index(wk, arr, 1);
+	return true;
 }
 
 void
@@ -116,11 +583,17 @@ compiler_check_cache_set(struct workspace *wk, obj key, const struct compiler_ch
 
 		obj_dict_set(wk, wk->compiler_check_cache, key, arr);
 	}
+
+	if (user_compiler_check_cache_enabled(wk)) {
+		user_compiler_check_cache_append(wk, key, val);
+	}
 }
 
 bool
 toolchain_component_type_from_s(struct workspace *wk, enum toolchain_component comp, const char *name, uint32_t *res)
 {
+	workspace_init_toolchain_runtime(wk);
+
 	obj o;
 	if (obj_dict_index_str(wk, wk->toolchain_registry.ids[comp], name, &o)) {
 		*res = get_obj_number(wk, o);
@@ -386,8 +859,7 @@ run_cmd_arr(struct workspace *wk, struct run_cmd_ctx *cmd_ctx, obj cmd_arr, cons
 	cache_val.value = make_obj(wk, obj_array);
 
 	obj status;
-	status = make_obj(wk, obj_number);
-	set_obj_number(wk, status, cmd_ctx->status);
+	status = make_number(wk, cmd_ctx->status);
 	obj_array_push(wk, cache_val.value, status);
 	obj_array_push(wk, cache_val.value, make_strn(wk, cmd_ctx->out.buf, cmd_ctx->out.len));
 	obj_array_push(wk, cache_val.value, make_strn(wk, cmd_ctx->err.buf, cmd_ctx->err.len));
@@ -480,6 +952,8 @@ toolchain_component_detect(struct workspace *wk,
 {
 	L("> detecting component %s", toolchain_component_to_s(component));
 
+	workspace_init_toolchain_runtime(wk);
+
 	struct obj_compiler *compiler = get_obj_compiler(wk, comp);
 	const struct arr *registry = &wk->toolchain_registry.components[component];
 
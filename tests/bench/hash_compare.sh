@@ -0,0 +1,50 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+# Compare the hash table in src/datastructures/hash.c at a git revision with
+# the one in the working tree using hash_driver.c.
+#
+# usage: tests/bench/hash_compare.sh <revision> [cc flags...]
+
+set -eu
+
+if [ $# -lt 1 ]; then
+	echo "usage: $0 <revision> [cc flags...]" >&2
+	exit 1
+fi
+
+rev="$1"
+shift
+
+if [ $# -eq 0 ]; then
+	set -- -O2
+fi
+
+root="$(git rev-parse --show-toplevel)"
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+git -C "$root" show "$rev:src/datastructures/hash.c" >"$tmp/hash_old.c"
+
+build_() {
+	"${CC:-cc}" "$@" -std=c99 -D_POSIX_C_SOURCE=200809L -I"$root/include" \
+		"$root/tests/bench/hash_driver.c" \
+		"$root/src/arena.c" \
+		"$root/src/datastructures/arr.c" \
+		"$root/src/datastructures/bucket_arr.c" \
+		"$root/src/datastructures/seg_list.c" \
+		"$root/src/platform/assert.c" \
+		"$root/src/platform/mem.c"
+}
+
+build_ "$@" -o "$tmp/old" "$tmp/hash_old.c"
+build_ "$@" -o "$tmp/new" "$root/src/datastructures/hash.c"
+
+# Alternate between the two so that both see the same machine load.
+for _ in 1 2 3; do
+	echo "$rev:"
+	"$tmp/old"
+	echo "working tree:"
+	"$tmp/new"
+done
@@ -0,0 +1,150 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * A standalone benchmark for src/datastructures/hash.c.  It is built by
+ * hash_compare.sh against two versions of hash.c so that changes to the hash
+ * table can be measured without the interpreter overhead that dominates
+ * hash.meson.
+ */
+
+#include "compat.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "buf_size.h"
+#include "datastructures/hash.h"
+#include "error.h"
+#include "log.h"
+
+/* The hash table's dependencies only log on fatal errors. */
+
+void
+log_print(bool nl, enum log_level lvl, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	if (nl) {
+		fputc('\n', stderr);
+	}
+}
+
+MUON_NORETURN void
+error_unrecoverable(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	abort();
+}
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t
+bench_str(uint32_t keys, uint32_t lookups, const char *prefix)
+{
+	struct arena a;
+	arena_init(&a);
+
+	char *buf = ar_alloc(&a, keys, 64, 1);
+	uint32_t i;
+	for (i = 0; i < keys; ++i) {
+		snprintf(&buf[i * 64], 64, "%s%" PRIu32, prefix, i);
+	}
+
+	uint64_t start = now_ns(), found = 0;
+
+	struct hash h;
+	hash_init_str(&a, &h, 16);
+	for (i = 0; i < keys; ++i) {
+		hash_set_strn(&a, &h, &buf[i * 64], strlen(&buf[i * 64]), i);
+	}
+
+	for (i = 0; i < lookups; ++i) {
+		const char *k = &buf[(i % keys) * 64];
+		uint64_t *v = hash_get_strn(&h, k, strlen(k));
+		found += v && *v == i % keys;
+	}
+
+	uint64_t elapsed = now_ns() - start;
+	ar_destroy(&a);
+	return found == lookups ? elapsed : 0;
+}
+
+static uint64_t
+bench_u32(uint32_t keys, uint32_t lookups)
+{
+	struct arena a;
+	arena_init(&a);
+
+	uint64_t start = now_ns(), found = 0;
+
+	struct hash h;
+	hash_init(&a, &h, 16, uint32_t);
+	uint32_t i;
+	for (i = 0; i < keys; ++i) {
+		uint32_t k = i * 2654435761u;
+		hash_set(&a, &h, &k, i);
+	}
+
+	for (i = 0; i < lookups; ++i) {
+		uint32_t k = (i % keys) * 2654435761u;
+		uint64_t *v = hash_get(&h, &k);
+		found += v && *v == i % keys;
+	}
+
+	uint64_t elapsed = now_ns() - start;
+	ar_destroy(&a);
+	return found == lookups ? elapsed : 0;
+}
+
+int
+main(void)
+{
+	const struct {
+		const char *name;
+		uint32_t keys, lookups;
+		const char *prefix;
+	} cases[] = {
+		{ "200k string keys, 2M lookups", 200000, 2000000, "a/fairly/long/path/prefix/" },
+		{ "200k u32 keys, 2M lookups", 200000, 2000000, 0 },
+		{ "40 short string keys, 10M lookups", 40, 10000000, "k" },
+	};
+
+	uint32_t i, run;
+	for (i = 0; i < ARRAY_LEN(cases); ++i) {
+		uint64_t best = 0;
+		for (run = 0; run < 5; ++run) {
+			uint64_t t = cases[i].prefix ? bench_str(cases[i].keys, cases[i].lookups, cases[i].prefix) :
+						       bench_u32(cases[i].keys, cases[i].lookups);
+			if (!t) {
+				fprintf(stderr, "%s: lookup failed\n", cases[i].name);
+				return 1;
+			} else if (!best || t < best) {
+				best = t;
+			}
+		}
+
+		printf("%s: %" PRIu64 "ms\n", cases[i].name, best / 1000000);
+	}
+
+	return 0;
+}